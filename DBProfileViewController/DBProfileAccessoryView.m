@@ -178,9 +178,14 @@
 }
 
 - (void)applyLayoutAttributes:(DBProfileAccessoryViewLayoutAttributes *)layoutAttributes {
-    self.hidden = layoutAttributes.hidden;
-    self.alpha = layoutAttributes.alpha;
-    self.transform = layoutAttributes.transform;
+    // Only values that differ from the applied ones are written, since every write invalidates the layer
+    if (self.hidden != layoutAttributes.hidden) self.hidden = layoutAttributes.hidden;
+    if (self.alpha != layoutAttributes.alpha) self.alpha = layoutAttributes.alpha;
+    if (!CGAffineTransformEqualToTransform(self.transform, layoutAttributes.transform)) self.transform = layoutAttributes.transform;
+}
+
+- (id)scrollDependentLayoutInputs {
+    return nil;
 }
 
 #pragma mark - UIGestureRecognizerDelegate
@@ -0,0 +1,35 @@
+//
+//  DBProfileBackdropBlurView.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <FXBlurView/FXBlurView.h>
+#import "DBProfileBlurAlgorithm.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBackdropBlurView` class is an `FXBlurView` that blurs the views behind it with the same kernels as `DBProfileBlurView`
+ *  instead of vImage, and recycles its working memory through the same buffer pool.
+ *
+ *  Dynamic views are updated from the display link rather than a timer. Every view due by the next frame starts its update at once, up to one
+ *  per processor, and the display link stops while no view is due. Use the class methods of this class rather than those of `FXBlurView` to
+ *  enable or disable updates, so that both schedulers follow them.
+ */
+@interface DBProfileBackdropBlurView : FXBlurView
+
+/**
+ *  The algorithm used to blur the views behind the view. Every algorithm blurs about as much for the same `blurRadius` and `iterations`.
+ *
+ *  See `DBProfileBlurAlgorithm` for the cost and quality of each algorithm.
+ *
+ *  Defaults to `DBProfileBlurAlgorithmBox`.
+ */
+@property (nonatomic) DBProfileBlurAlgorithm blurAlgorithm;
+
+@end
+
+NS_ASSUME_NONNULL_END
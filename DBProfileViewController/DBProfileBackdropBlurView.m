@@ -0,0 +1,284 @@
+//
+//  DBProfileBackdropBlurView.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBackdropBlurView.h"
+#import "DBProfileBackdropBlurView_Private.h"
+#import "DBProfileBlurScheduler.h"
+#import "DBProfileBlurBufferPool.h"
+#import "UIImage+DBProfileViewController.h"
+
+// Band images own the pool buffer they were rendered into and return it to the pool when they are released
+static void DBProfileBackdropBlurRecycleImageBuffer(void *info, const void *data, size_t size) {
+    [[DBProfileBlurBufferPool sharedPool] recycleBuffer:(void *)data size:(size_t)info];
+}
+
+@interface DBProfileBackdropBlurView ()
+
+@property (nonatomic, nullable) NSArray *lastBlurParameters;
+@property (nonatomic, nullable) NSData *lastSnapshotRowDigests;
+@property (nonatomic, nullable) UIImage *lastBlurredSnapshot;
+
+@end
+
+@implementation DBProfileBackdropBlurView
+
++ (void)setBlurEnabled:(BOOL)blurEnabled {
+    [super setBlurEnabled:blurEnabled];
+    [DBProfileBlurScheduler sharedScheduler].blurEnabled = blurEnabled;
+}
+
++ (void)setUpdatesEnabled {
+    [super setUpdatesEnabled];
+    [[DBProfileBlurScheduler sharedScheduler] setUpdatesEnabled];
+}
+
++ (void)setUpdatesDisabled {
+    [super setUpdatesDisabled];
+    [[DBProfileBlurScheduler sharedScheduler] setUpdatesDisabled];
+}
+
+- (instancetype)initWithFrame:(CGRect)frame {
+    self = [super initWithFrame:frame];
+    if (self) {
+        _dueIndex = NSNotFound;
+    }
+    return self;
+}
+
+- (instancetype)initWithCoder:(NSCoder *)aDecoder {
+    self = [super initWithCoder:aDecoder];
+    if (self) {
+        _dueIndex = NSNotFound;
+    }
+    return self;
+}
+
+- (void)setBlurAlgorithm:(DBProfileBlurAlgorithm)blurAlgorithm {
+    _blurAlgorithm = blurAlgorithm;
+    [self setNeedsDisplay];
+}
+
+- (void)setHidden:(BOOL)hidden {
+    [super setHidden:hidden];
+    [self schedule];
+}
+
+// Dynamic views are updated by the display link of `DBProfileBlurScheduler` instead of the scheduler of `FXBlurView`, and hidden views
+// leave it so they never keep the display link running
+- (void)schedule {
+    if (self.window && !self.hidden && self.dynamic && self.blurEnabled) {
+        [[DBProfileBlurScheduler sharedScheduler] addView:self];
+    }
+    else {
+        [[DBProfileBlurScheduler sharedScheduler] removeView:self];
+    }
+}
+
+#pragma mark - Snapshots
+
+- (CGFloat)snapshotScale {
+    CGFloat scale = 0.5;
+    if (self.iterations) {
+        CGFloat blockSize = 12.0 / self.iterations;
+        CGFloat blurRadius = [[[self blurPresentationLayer] valueForKey:@"blurRadius"] doubleValue];
+        scale = blockSize / MAX(blockSize * 2.0, blurRadius);
+        scale = 1.0 / floor(1.0 / scale);
+    }
+    return scale;
+}
+
+- (CGRect)snapshotRect {
+    CALayer *blurLayer = [self blurPresentationLayer];
+    CGRect rect = [blurLayer convertRect:blurLayer.bounds toLayer:[self underlyingLayer]];
+    
+    // Prevents edge artefacts when the blurred image is scaled to fill the view, like FXBlurView does
+    if (self.contentMode == UIViewContentModeScaleToFill || self.contentMode == UIViewContentModeScaleAspectFill ||
+        self.contentMode == UIViewContentModeScaleAspectFit || self.contentMode == UIViewContentModeRedraw) {
+        CGFloat scale = [self snapshotScale];
+        rect.size.width = floor(rect.size.width * scale) / scale;
+        rect.size.height = floor(rect.size.height * scale) / scale;
+    }
+    return rect;
+}
+
+- (id)snapshotKey {
+    // The layers hidden for a snapshot depend on where the view sits among the sublayers of the underlying layer
+    CALayer *underlyingLayer = [self underlyingLayer];
+    CALayer *layer = self.layer;
+    while (layer.superlayer && layer.superlayer != underlyingLayer) {
+        layer = layer.superlayer;
+    }
+    NSUInteger index = [underlyingLayer.sublayers indexOfObject:layer];
+    if (!underlyingLayer || index == NSNotFound) return nil;
+    return @[[NSValue valueWithNonretainedObject:underlyingLayer], @(index), @([self snapshotScale]), @([self needsDrawViewHierarchy])];
+}
+
+- (UIImage *)snapshotOfUnderlyingViewInRect:(CGRect)rect scale:(CGFloat)scale {
+    UIGraphicsBeginImageContextWithOptions(rect.size, NO, scale);
+    CGContextRef context = UIGraphicsGetCurrentContext();
+    if (!context) return nil;
+    
+    CGContextTranslateCTM(context, -rect.origin.x, -rect.origin.y);
+    NSArray *hiddenLayers = [self prepareUnderlyingViewForSnapshot];
+    if ([self needsDrawViewHierarchy]) {
+        UIView *underlyingView = self.underlyingView;
+        [underlyingView drawViewHierarchyInRect:underlyingView.bounds afterScreenUpdates:YES];
+    }
+    else {
+        [[self underlyingLayer] renderInContext:context];
+    }
+    [self restoreSuperviewAfterSnapshot:hiddenLayers];
+    
+    // The rows are digested while the pixels are still in the context, so comparing the snapshot with the last one copies nothing
+    NSData *rowDigests = [UIImage db_rowDigestsOfBitmapContext:context];
+    UIImage *snapshot = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    snapshot.db_rowDigests = rowDigests;
+    return snapshot;
+}
+
+- (void)updateWithSnapshot:(UIImage *)snapshot completion:(void (^)(void))completion {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        UIImage *blurredImage = [self blurredSnapshot:snapshot radius:self.blurRadius];
+        dispatch_sync(dispatch_get_main_queue(), ^{
+            [self setLayerContents:blurredImage];
+            if (completion) completion();
+        });
+    });
+}
+
+#pragma mark - Blurring
+
+- (void)clearImage {
+    @synchronized (self) {
+        self.lastBlurredSnapshot = nil;
+    }
+    [super clearImage];
+}
+
+// An unchanged snapshot leaves the layer showing the blur it already has
+- (void)setLayerContents:(UIImage *)image {
+    if (self.layer.contents == (__bridge id)image.CGImage) return;
+    [super setLayerContents:image];
+}
+
+// Snapshots are compared with the last one row by row, so an unchanged backdrop is not blurred again and a changed band is blurred on its own
+- (UIImage *)blurredSnapshot:(UIImage *)snapshot radius:(CGFloat)blurRadius {
+    CGImageRef imageRef = snapshot.CGImage;
+    if (!imageRef || CGImageGetBitsPerPixel(imageRef) != 32 || CGImageGetBitsPerComponent(imageRef) != 8 || !(CGImageGetBitmapInfo(imageRef) & kCGBitmapAlphaInfoMask)) {
+        return [snapshot db_blurredImageWithRadius:blurRadius iterations:self.iterations algorithm:self.blurAlgorithm tintColor:self.tintColor];
+    }
+    
+    // Snapshots taken by the view carry the digests of their rows, other snapshots are copied out of their image to be digested
+    CFDataRef dataSource = NULL;
+    DBProfileBlurBuffer source = {NULL, CGImageGetWidth(imageRef), CGImageGetHeight(imageRef), CGImageGetBytesPerRow(imageRef), DBProfileBlurPixelFormat32};
+    NSData *rowDigests = snapshot.db_rowDigests;
+    if (rowDigests.length != source.height * sizeof(uint64_t)) {
+        dataSource = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+        source.data = (uint8_t *)CFDataGetBytePtr(dataSource);
+        NSMutableData *computedRowDigests = [NSMutableData dataWithLength:source.height * sizeof(uint64_t)];
+        DBProfileBlurRowDigests(&source, computedRowDigests.mutableBytes);
+        rowDigests = computedRowDigests;
+    }
+    NSArray *parameters = @[@(blurRadius), @(self.iterations), @(self.blurAlgorithm), self.tintColor ?: [NSNull null], @(snapshot.scale), @(source.width)];
+    
+    UIImage *previousImage = nil;
+    NSData *previousRowDigests = nil;
+    @synchronized (self) {
+        if ([parameters isEqualToArray:self.lastBlurParameters] && self.lastSnapshotRowDigests.length == rowDigests.length) {
+            previousImage = self.lastBlurredSnapshot;
+            previousRowDigests = self.lastSnapshotRowDigests;
+        }
+    }
+    
+    UIImage *blurredImage = nil;
+    if (previousImage) {
+        size_t firstRow, numberOfRows;
+        if (!DBProfileBlurChangedRows(rowDigests.bytes, previousRowDigests.bytes, source.height, &firstRow, &numberOfRows)) {
+            blurredImage = previousImage;
+        }
+        else {
+            // Only a changed band needs the pixels of the snapshot
+            if (!dataSource) {
+                dataSource = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+                source.data = (uint8_t *)CFDataGetBytePtr(dataSource);
+            }
+            blurredImage = [self blurredImage:previousImage source:&source radius:blurRadius scale:snapshot.scale changedRows:NSMakeRange(firstRow, numberOfRows)];
+        }
+    }
+    if (dataSource) CFRelease(dataSource);
+    
+    blurredImage = blurredImage ?: [snapshot db_blurredImageWithRadius:blurRadius iterations:self.iterations algorithm:self.blurAlgorithm tintColor:self.tintColor];
+    @synchronized (self) {
+        self.lastBlurParameters = parameters;
+        self.lastSnapshotRowDigests = rowDigests;
+        self.lastBlurredSnapshot = blurredImage;
+    }
+    return blurredImage;
+}
+
+// Blurs only the changed rows of `source` and the halo they reach into a copy of the last result, or returns nil if the whole snapshot must be
+// blurred again. Only box blurs reach a known number of rows, and the rows they write are the same a blur of the whole snapshot would write
+- (nullable UIImage *)blurredImage:(UIImage *)blurredImage source:(const DBProfileBlurBuffer *)source radius:(CGFloat)blurRadius scale:(CGFloat)scale changedRows:(NSRange)changedRows {
+    NSUInteger iterations = self.iterations;
+    uint32_t boxSize = (uint32_t)(blurRadius * scale);
+    if (self.blurAlgorithm != DBProfileBlurAlgorithmBox || iterations == 0 || boxSize <= 1) return nil;
+    
+    // Every changed row reaches half a box further with each iteration, and rows past that halo are left as they were
+    size_t halo = iterations * (boxSize / 2);
+    size_t firstRow = changedRows.location > halo ? changedRows.location - halo : 0;
+    size_t lastRow = MIN(NSMaxRange(changedRows) + halo, source->height);
+    if (firstRow == 0 && lastRow == source->height) return nil;
+    
+    CGImageRef imageRef = blurredImage.CGImage;
+    if (!imageRef || CGImageGetWidth(imageRef) != source->width || CGImageGetHeight(imageRef) != source->height) return nil;
+    
+    // Start from a copy of the last result, since its pixels may still be on screen
+    DBProfileBlurBuffer buffer = *source;
+    buffer.rowBytes = CGImageGetBytesPerRow(imageRef);
+    size_t bytes = buffer.rowBytes * buffer.height;
+    CFDataRef previousData = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    if (!previousData || (size_t)CFDataGetLength(previousData) < bytes) {
+        if (previousData) CFRelease(previousData);
+        return nil;
+    }
+    DBProfileBlurBufferPool *pool = [DBProfileBlurBufferPool sharedPool];
+    buffer.data = [pool bufferWithSize:bytes];
+    CFDataGetBytes(previousData, CFRangeMake(0, (CFIndex)bytes), buffer.data);
+    CFRelease(previousData);
+    
+    // Stream only the band through the boxes
+    uint32_t *boxSizes = malloc(iterations * sizeof(uint32_t));
+    for (NSUInteger i = 0; i < iterations; i++) boxSizes[i] = boxSize;
+    size_t stripHeight = DBProfileBlurStreamStripHeight(buffer.width, buffer.height, buffer.format, boxSizes, iterations, 0, pool.workingBytesLimit ?: SIZE_MAX);
+    stripHeight = MIN(stripHeight, lastRow - firstRow);
+    size_t windowSize = DBProfileBlurStreamWindowSize(buffer.width, buffer.height, buffer.format, boxSizes, iterations, 0, stripHeight);
+    void *window = [pool bufferWithSize:windowSize];
+    DBProfileBlurStreamBoxesRows(source, &buffer, window, boxSizes, iterations, 0, stripHeight, firstRow, lastRow - firstRow);
+    [pool recycleBuffer:window size:windowSize];
+    free(boxSizes);
+    
+    // Tint only the band, the rest of the copy is already tinted
+    UIColor *tintColor = self.tintColor;
+    if (tintColor && CGColorGetAlpha(tintColor.CGColor) > 0.0f) {
+        CGContextRef ctx = CGBitmapContextCreate(buffer.data, buffer.width, buffer.height, 8, buffer.rowBytes, CGImageGetColorSpace(imageRef), CGImageGetBitmapInfo(imageRef));
+        CGContextSetFillColorWithColor(ctx, [tintColor colorWithAlphaComponent:0.25].CGColor);
+        CGContextSetBlendMode(ctx, kCGBlendModePlusLighter);
+        CGContextFillRect(ctx, CGRectMake(0, buffer.height - lastRow, buffer.width, lastRow - firstRow));
+        CGContextRelease(ctx);
+    }
+    
+    CGDataProviderRef provider = CGDataProviderCreateWithData((void *)(uintptr_t)bytes, buffer.data, bytes, DBProfileBackdropBlurRecycleImageBuffer);
+    CGImageRef bandedImageRef = CGImageCreate(buffer.width, buffer.height, 8, 32, buffer.rowBytes, CGImageGetColorSpace(imageRef), CGImageGetBitmapInfo(imageRef), provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    UIImage *image = [UIImage imageWithCGImage:bandedImageRef scale:blurredImage.scale orientation:blurredImage.imageOrientation];
+    CGImageRelease(bandedImageRef);
+    return image;
+}
+
+@end
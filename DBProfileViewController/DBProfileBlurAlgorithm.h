@@ -0,0 +1,38 @@
+//
+//  DBProfileBlurAlgorithm.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#pragma once
+
+/**
+ *  The algorithms that a `DBProfileBlurView` can blur its stages with.
+ *
+ *  Costs are those of the performance tests of `DBProfileBlurKernelTests`, which blur a zero-filled 1242 x 480 buffer, the size of a cover
+ *  photo on a 5.5" phone, at variance 256, the variance of the largest stage of a default blur view. They are relative to the box blur, which
+ *  runs vector kernels on devices while the other algorithms run portable scalar code, so they are upper bounds there. The same tests assert
+ *  that every algorithm is within 1 level, as a root mean square error in 8-bit levels, of an exact Gaussian at sigma 6 away from the edges.
+ */
+typedef enum {
+    /**
+     *  Box convolutions, the reference for cost. Blur views use `iterations` equal boxes of their blur radius, and a blur asked for a variance
+     *  alone uses three boxes sized to match a Gaussian of that variance.
+     */
+    DBProfileBlurAlgorithmBox,
+    /**
+     *  Stack blur, whose triangular kernel is smoother than a single box. About 2x the cost of the box blur.
+     */
+    DBProfileBlurAlgorithmStack,
+    /**
+     *  Dual Kawase passes, which do most of their work on buffers a quarter of the size of the one before. On the CPU the final upsample
+     *  to full size dominates, so it costs about 8x the box blur. It treats the edges differently from the other algorithms.
+     */
+    DBProfileBlurAlgorithmDualKawase,
+    /**
+     *  The recursive Gaussian of Young and van Vliet in floating point. About 2.5x the cost of the box blur whatever the variance.
+     */
+    DBProfileBlurAlgorithmRecursiveGaussian,
+} DBProfileBlurAlgorithm;
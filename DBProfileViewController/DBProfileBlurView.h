@@ -7,18 +7,80 @@
 //
 
 #import "DBProfileAccessoryView.h"
+#import "DBProfileBlurAlgorithm.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ *  How a `DBProfileBlurView` spaces the blur radii of its stages between 0 and `maxBlurRadius`.
+ */
+typedef NS_ENUM(NSInteger, DBProfileBlurStageSpacing) {
+    /**
+     *  Stages are evenly spaced by blur radius.
+     */
+    DBProfileBlurStageSpacingLinear,
+    /**
+     *  Stages are evenly spaced by how different they look, so they are close together at small blur radii and far apart at large ones.
+     *
+     *  The eye judges a change of blur relative to the blur already there, so a step of 1 point from a sharp image is far more visible
+     *  than the same step at a radius of 19 points. This spacing makes every step equally visible, which is the smallest the largest
+     *  step can be for a number of stages. 8 perceptual stages step less visibly than 20 linear ones up to a radius of 20 points.
+     */
+    DBProfileBlurStageSpacingPerceptual,
+};
+
+/**
+ *  The engines that can render the stages of a `DBProfileBlurView`.
+ */
+typedef NS_ENUM(NSInteger, DBProfileBlurStageRenderer) {
+    /**
+     *  Blurs each stage from the previous stage with one box convolution.
+     */
+    DBProfileBlurStageRendererProgressive,
+    /**
+     *  Builds one summed-area table of the image and evaluates every stage from it as an average of three boxes.
+     *
+     *  Every stage costs the same whatever its blur radius, and stages do not depend on each other.
+     */
+    DBProfileBlurStageRendererSummedAreaTable,
+};
+
 /**
  *  The `DBProfileBlurView` class is an accessory view that displays an image that can be blurred within a specified number of stages.
  *
- *  This class is intended to be used to blur an image in stages while a user is scrolling a scroll view.
+ *  This class is intended to be used to blur an image in stages while a user is scrolling a scroll view. Stages are rendered the first
+ *  time the view is scrolled, and only over the part of the image on screen at that time, such as the band a collapsed header leaves
+ *  below the navigation bar. They are rendered again if more of the image comes on screen.
  * 
  *  You should not use this class directly instead see `DBProfileCoverPhotoView` or create your own subclass.
  */
 @interface DBProfileBlurView : DBProfileAccessoryView
 
+/**
+ *  Whether the stages rendered by every blur view are also kept in files in the app's caches directory.
+ *
+ *  Stages kept on disk are mapped back into memory without being blurred or decoded again, so a profile shown again after a relaunch
+ *  shows its whole blur transition at once. The files are limited to 50 MB, the least recently used are removed first.
+ *
+ *  Defaults to NO.
+ */
++ (BOOL)isDiskCacheEnabled;
+
+/**
+ *  Sets whether the stages rendered by every blur view are also kept in files in the app's caches directory.
+ */
++ (void)setDiskCacheEnabled:(BOOL)diskCacheEnabled;
+
+/**
+ *  The number of render jobs of all blur views waiting to run. Each view has at most one job waiting.
+ */
++ (NSUInteger)renderQueueDepth;
+
+/**
+ *  The number of render jobs that were replaced by a newer job for the same view before they started.
+ */
++ (NSUInteger)numberOfCoalescedRenderJobs;
+
 /**
  *  The image view that displays the blurred images.
  */
@@ -48,10 +110,17 @@ NS_ASSUME_NONNULL_BEGIN
 /**
  *  The number of stages to use when blurring images.
  *
- *  Defaults to 20.
+ *  Defaults to 8, which with `DBProfileBlurStageSpacingPerceptual` steps less visibly than 20 evenly spaced stages.
  */
 @property (nonatomic) NSUInteger numberOfStages;
 
+/**
+ *  How the blur radii of the stages are spaced. The blur grows with `percentScrolled` the same way whatever the spacing.
+ *
+ *  Defaults to `DBProfileBlurStageSpacingPerceptual`.
+ */
+@property (nonatomic) DBProfileBlurStageSpacing stageSpacing;
+
 /**
  *  The max blur radius to use when blurring images.
  *
@@ -59,6 +128,80 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) CGFloat maxBlurRadius;
 
+/**
+ *  The maximum number of bytes of blurred stage bitmaps to keep for the image, or 0 for no limit.
+ *
+ *  When the stages do not fit, heavily blurred stages are stored at a lower resolution first and then fewer stages are used.
+ *
+ *  Defaults to 0.
+ */
+@property (nonatomic) NSUInteger memoryBudget;
+
+/**
+ *  The number of bytes of bitmaps held by the blurred stages of the current image, which are stored together in a single bitmap.
+ *
+ *  The bitmap is allocated when the stages start rendering, so this is set before `hasFullFidelity` becomes YES. While stages are rendered
+ *  again over more of the image, the stages they replace are still shown and counted until then.
+ */
+@property (nonatomic, readonly) NSUInteger stageMemoryFootprint;
+
+/**
+ *  Whether heavily blurred stages are computed and stored at 1/2, 1/4 or 1/8 of the image resolution.
+ *
+ *  Downsampled stages carry no visible detail beyond their blur and are scaled back up by the image view, which cuts both compute and memory on large images.
+ *
+ *  Defaults to NO.
+ */
+@property (nonatomic) BOOL shouldDownsampleStages;
+
+/**
+ *  The engine used to render the blurred stages.
+ *
+ *  `DBProfileBlurStageRendererSummedAreaTable` renders every stage at the same cost whatever `maxBlurRadius` is.
+ *
+ *  Defaults to `DBProfileBlurStageRendererProgressive`.
+ */
+@property (nonatomic) DBProfileBlurStageRenderer stageRenderer;
+
+/**
+ *  The algorithm used to blur the stages when they are rendered by `DBProfileBlurStageRendererProgressive`.
+ *
+ *  `DBProfileBlurAlgorithmRecursiveGaussian` renders every stage at the same cost whatever `maxBlurRadius` is. See `DBProfileBlurAlgorithm`
+ *  for the cost and quality of each algorithm.
+ *
+ *  Defaults to `DBProfileBlurAlgorithmBox`.
+ */
+@property (nonatomic) DBProfileBlurAlgorithm blurAlgorithm;
+
+/**
+ *  The largest number of threads that render a single blurred stage. The result does not depend on the number of threads.
+ *
+ *  Defaults to the number of active processors. Set this to 1 to render every stage on a single thread.
+ */
+@property (nonatomic) NSUInteger numberOfWorkers;
+
+/**
+ *  Whether a preview of every stage is shown while the stages of a new image are rendered.
+ *
+ *  Previews are blurred at 1/8 of the image resolution within a few milliseconds, so the header is blurred as soon as it is scrolled,
+ *  and each stage replaces its preview once it has been rendered at full quality. Stages rendered again over more of the image, such as
+ *  the band of a collapsed header that is pulled down, show the stages they replace instead of previews.
+ *
+ *  Defaults to YES.
+ */
+@property (nonatomic) BOOL shouldPreviewStages;
+
+/**
+ *  Whether every stage of the current image has been rendered at full quality.
+ */
+@property (nonatomic, readonly, getter=hasFullFidelity) BOOL fullFidelity;
+
+/**
+ *  The block called on the main queue each time every stage of the current image has been rendered at full quality, including after
+ *  the stages are rendered again over more of the image.
+ */
+@property (nonatomic, copy, nullable) void (^fullFidelityHandler)(DBProfileBlurView *blurView);
+
 /**
  *  The image representing stage 0.
  */
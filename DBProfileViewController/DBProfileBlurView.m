@@ -7,78 +7,58 @@
 //
 
 #import "DBProfileBlurView.h"
+#import "DBProfileAccessoryView_Private.h"
 #import "DBProfileHeaderViewLayoutAttributes.h"
-#import <FXBlurView/FXBlurView.h>
+#import "DBProfileHeaderViewLayoutAttributes_Private.h"
+#import "DBProfileBlurStageGenerator.h"
+#import "DBProfileBlurStagePlanner.h"
+#import "DBProfileBlurStageCache.h"
+#import "DBProfileBlurStageDiskCache.h"
+#import "DBProfileBlurJobQueue.h"
 
-@interface DBProfileBlurStageCacheKey : NSObject
+@interface DBProfileBlurView ()
 
-@property (nonatomic, strong) UIImage *image;
-@property (nonatomic, strong) UIColor *tintColor;
-@property (nonatomic, assign) NSUInteger stage;
+@property (nonatomic) UIImageView *interpolatedImageView;
+@property (nonatomic) UIView *tintOverlayView;
+@property (nonatomic) NSUInteger iterations;
+@property (nonatomic) NSInteger stage;
+@property (nonatomic, nullable) DBProfileBlurStagePlan *plan;
+@property (nonatomic, nullable) DBProfileBlurStageAtlas *atlas;
+@property (nonatomic, nullable) DBProfileBlurStageAtlas *previousAtlas;
+@property (nonatomic, nullable) DBProfileBlurSourceImage *sourceImage;
+@property (nonatomic) NSUInteger stageMemoryFootprint;
+@property (nonatomic, nullable) DBProfileBlurJobToken *renderToken;
+@property (nonatomic) CGRect renderedRect;
+@property (nonatomic) CGRect collapsedBounds;
+@property (nonatomic, copy, nullable) NSArray<UIImage *> *previewImages;
+@property (nonatomic) BOOL fullFidelity;
+
+- (void)renderStages;
 
 @end
 
-@implementation DBProfileBlurStageCacheKey
+@implementation DBProfileBlurView
 
-- (instancetype)initWithImage:(UIImage *)image tintColor:(UIColor *)tintColor stage:(NSUInteger)stage
++ (BOOL)isDiskCacheEnabled
 {
-    self = [super init];
-    if (self) {
-        _image = image;
-        _tintColor = tintColor;
-        _stage = stage;
-    }
-    return self;
+    return [DBProfileBlurStageCache sharedCache].diskCache != nil;
 }
 
-- (BOOL)isEqual:(id)object {
-    if ([self class] != [object class]) {
-        return NO;
-    }
-    __typeof(self) castObject = object;
-    return ([_image isEqual:castObject.image]
-            && [_tintColor isEqual:castObject.tintColor]
-            && _stage == castObject.stage);
++ (void)setDiskCacheEnabled:(BOOL)diskCacheEnabled
+{
+    [DBProfileBlurStageCache sharedCache].diskCache = diskCacheEnabled ? [DBProfileBlurStageDiskCache defaultDiskCache] : nil;
 }
 
-@end
-
-@interface DBProfileBlurStageCache : NSCache
-@end
-
-@implementation DBProfileBlurStageCache
-
-- (UIImage *)blurredImageForImage:(UIImage *)image tintColor:(UIColor *)tintColor stage:(NSUInteger)stage
++ (NSUInteger)renderQueueDepth
 {
-    DBProfileBlurStageCacheKey *key = [[DBProfileBlurStageCacheKey alloc] initWithImage:image
-                                                                              tintColor:tintColor
-                                                                                  stage:stage];
-    return [self objectForKey:key];
+    return [DBProfileBlurJobQueue sharedQueue].queueDepth;
 }
 
-- (void)setBlurredImage:(UIImage *)blurredImage forImage:(UIImage *)image tintColor:(UIColor *)tintColor stage:(NSUInteger)stage
++ (NSUInteger)numberOfCoalescedRenderJobs
 {
-    DBProfileBlurStageCacheKey *key = [[DBProfileBlurStageCacheKey alloc] initWithImage:image
-                                                                              tintColor:tintColor
-                                                                                  stage:stage];
-    [self setObject:blurredImage forKey:key];
+    return [DBProfileBlurJobQueue sharedQueue].numberOfCoalescedJobs;
 }
 
-@end
-
-@interface DBProfileBlurView ()
-
-@property (nonatomic) UIImageView *interpolatedImageView;
-@property (nonatomic) DBProfileBlurStageCache *cache;
-@property (nonatomic) NSUInteger iterations;
-@property (nonatomic) NSInteger stage;
-
-- (void)updateAsync:(BOOL)async completion:(void (^)())completion;
-
-@end
-
-@implementation DBProfileBlurView
-
 - (instancetype)init
 {
     self = [super init];
@@ -90,8 +70,13 @@
         self.blurEnabled = YES;
         self.iterations = 5;
         self.maxBlurRadius = 20.0;
-        self.numberOfStages = 20;
+        self.numberOfStages = 8;
+        self.stageSpacing = DBProfileBlurStageSpacingPerceptual;
+        self.numberOfWorkers = [NSProcessInfo processInfo].activeProcessorCount;
         self.shouldInterpolateStages = YES;
+        self.shouldPreviewStages = YES;
+        self.collapsedBounds = CGRectNull;
+        self.renderedRect = CGRectNull;
         
         _imageView = [[UIImageView alloc] init];
         self.imageView.contentMode = UIViewContentModeScaleAspectFill;
@@ -105,32 +90,17 @@
         self.interpolatedImageView.clipsToBounds = YES;
         [self.contentView addSubview:_interpolatedImageView];
 
-        [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
-                                                          object:nil
-                                                           queue:nil
-                                                      usingBlock:^(NSNotification * _Nonnull note) {
-                                                          // The cache is automatically emptied when the app receives a memory warning so we need to refill the cache so the blur effect still works
-                                                          [self updateAsync:YES completion:nil];
-                                                      }];
-        
-        [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidBecomeActiveNotification
-                                                          object:nil
-                                                           queue:nil
-                                                      usingBlock:^(NSNotification * _Nonnull note) {
-                                                          // The cache is automatically emptied when the app enters the background so we need to refill the cache when the app becomes active
-                                                          [self updateAsync:YES completion:nil];
-                                                      }];
-        
-        self.cache = [[DBProfileBlurStageCache alloc] init];
+        // The tint is composited over the stages when they are shown, so every tint color reads the same stages and none are redrawn
+        _tintOverlayView = [[UIView alloc] init];
+        self.tintOverlayView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
+        self.tintOverlayView.userInteractionEnabled = NO;
+        self.tintOverlayView.alpha = 0.0;
+        [self.contentView addSubview:_tintOverlayView];
+        [self updateTintOverlayView];
     }
     return self;
 }
 
-- (void)dealloc
-{
-    [[NSNotificationCenter defaultCenter] removeObserver:self];
-}
-
 - (void)setStage:(NSInteger)stage {
     _stage = stage;
     
@@ -142,35 +112,171 @@
     }
 }
 
+- (void)setAtlas:(DBProfileBlurStageAtlas *)atlas
+{
+    _atlas = atlas;
+    
+    // The slab of the atlas is allocated up front, so the stages hold all of their memory as soon as they start rendering
+    self.stageMemoryFootprint = atlas.byteCount + self.previousAtlas.byteCount;
+}
+
+- (void)setPreviousAtlas:(DBProfileBlurStageAtlas *)previousAtlas
+{
+    _previousAtlas = previousAtlas;
+    self.stageMemoryFootprint = self.atlas.byteCount + previousAtlas.byteCount;
+}
+
 - (void)setPercentScrolled:(CGFloat)percentScrolled
 {
     _percentScrolled = percentScrolled;
     
     if (!self.isBlurEnabled) return;
     
-    self.stage = round(percentScrolled * self.numberOfStages);
+    // Stages blurred over less of the image than is now on screen, such as the band of a collapsed header that is then stretched, are
+    // rendered again over both parts
+    CGRect visibleRect = [self stageImageRect];
+    if (self.plan && !CGRectContainsRect(self.renderedRect, visibleRect)) {
+        CGRect renderedRect = CGRectUnion(self.renderedRect, visibleRect);
+        NSArray<UIImage *> *previewImages = self.previewImages;
+        DBProfileBlurStageAtlas *previousAtlas = self.atlas.isComplete ? self.atlas : self.previousAtlas;
+        [self invalidateStages];
+        self.renderedRect = renderedRect;
+        
+        // Previews cover the whole image and the stages already rendered cover the rows that were on screen, so both are shown until the
+        // larger stages are rendered, the same way a collapsed header pulled down keeps its band instead of falling back to the initial image
+        self.previewImages = previewImages;
+        self.previousAtlas = previousAtlas;
+    }
+    
+    // Stages are only rendered once they are needed, starting with the stages around the current offset
+    [self renderStagesIfNeeded];
     
+    CGFloat stage = [self stageForPercentScrolled:percentScrolled];
+    self.stage = round(stage);
 
     // We will use a second image view to interpolate the blur between stages to create a smoother transition
     if (self.shouldInterpolateStages) {
         UIImage *blurredImage = [self blurredImageForStage:self.stage + 1];
         if (blurredImage) _interpolatedImageView.image = blurredImage;
-        _interpolatedImageView.alpha = (percentScrolled * self.numberOfStages) - self.stage;
+        _interpolatedImageView.alpha = stage - self.stage;
     }
+    
+    // The tint fades in with the first stage, the same way the stage fades in over the initial image
+    CGFloat tintedStage = self.shouldInterpolateStages ? stage : self.stage;
+    self.tintOverlayView.alpha = self.plan ? MIN(MAX(tintedStage, 0.0), 1.0) : 0.0;
+}
+
+- (void)setBlurEnabled:(BOOL)blurEnabled
+{
+    _blurEnabled = blurEnabled;
+    
+    // Stop any work in flight, the stages are rendered again if blurring is enabled later
+    if (!blurEnabled) [self invalidateStages];
 }
 
 - (void)setInitialImage:(UIImage *)initialImage {
     _initialImage = initialImage;
     _imageView.image = initialImage;
-    [self updateAsync:YES completion:nil];
+    self.sourceImage = nil;
+    [self invalidateStages];
+    [self renderStagesIfNeeded];
 }
 
 - (void)tintColorDidChange
 {
     [super tintColorDidChange];
     
-    // We need to update the cached images to use the new tint color for blurring
-    [self updateAsync:YES completion:nil];
+    // Stages are rendered without the tint, so only the overlay changes
+    [self updateTintOverlayView];
+}
+
+- (void)updateTintOverlayView
+{
+    // Stages were tinted with a quarter of the tint color, which the overlay keeps
+    BOOL isTinted = CGColorGetAlpha(self.tintColor.CGColor) > 0.0f;
+    self.tintOverlayView.backgroundColor = isTinted ? [self.tintColor colorWithAlphaComponent:0.25] : nil;
+    self.tintOverlayView.hidden = !isTinted;
+}
+
+- (void)didMoveToWindow
+{
+    [super didMoveToWindow];
+    
+    // Views that are off screen keep their jobs, but let the views on screen render first
+    [[DBProfileBlurJobQueue sharedQueue] setJobsDeferred:(self.window == nil) forOwner:self];
+}
+
+- (void)didMoveToSuperview
+{
+    [super didMoveToSuperview];
+    
+    // A view removed from its superview has left for good, so its jobs are cancelled and its stages are rendered again if it comes back
+    if (!self.superview) [self invalidateStages];
+}
+
+- (void)invalidateStages
+{
+    // Cancelling the job stops any stages still being rendered for the previous image, and drops the job if it has not started yet
+    [[DBProfileBlurJobQueue sharedQueue] cancelJobsForOwner:self];
+    self.renderToken = nil;
+    self.plan = nil;
+    self.atlas = nil;
+    self.previousAtlas = nil;
+    self.renderedRect = CGRectNull;
+    self.previewImages = nil;
+    self.fullFidelity = NO;
+    self.tintOverlayView.alpha = 0.0;
+}
+
+- (void)renderStagesIfNeeded
+{
+    // A plan exists from the moment stages start rendering until they are invalidated. Stage 0 shows the initial image, so nothing is
+    // needed until the view is scrolled, unless the layout says which part of the image the collapsed header leaves on screen
+    if (!self.isBlurEnabled || self.plan || ![self shouldUpdate]) return;
+    if (self.percentScrolled <= 0.0 && CGRectIsNull(self.collapsedBounds)) return;
+    [self renderStages];
+}
+
+- (CGRect)visibleImageRect
+{
+    UIWindow *window = self.window;
+    if (!window) return CGRectMake(0.0, 0.0, 1.0, 1.0);
+    
+    UIImageView *imageView = self.imageView;
+    CGRect visibleBounds = CGRectIntersection(imageView.bounds, [imageView convertRect:window.bounds fromView:window]);
+    visibleBounds = CGRectIntersection(visibleBounds, [imageView convertRect:self.bounds fromView:self]);
+    return [self imageRectForBounds:visibleBounds];
+}
+
+- (CGRect)stageImageRect
+{
+    // The stages are shown while the header collapses, so they cover what the collapsed header leaves on screen, and once the view is
+    // scrolled whatever else of the image is on screen, such as the whole of a stretched header
+    CGRect collapsedRect = CGRectIsNull(self.collapsedBounds) ? CGRectNull : [self imageRectForBounds:[self.imageView convertRect:self.collapsedBounds fromView:self]];
+    if (!CGRectIsNull(collapsedRect) && self.percentScrolled <= 0.0) return collapsedRect;
+    return CGRectUnion(collapsedRect, [self visibleImageRect]);
+}
+
+- (CGRect)imageRectForBounds:(CGRect)visibleBounds
+{
+    CGRect imageRect = CGRectMake(0.0, 0.0, 1.0, 1.0);
+    UIImageView *imageView = self.imageView;
+    CGSize imageSize = self.initialImage.size;
+    if (imageSize.width <= 0.0 || imageSize.height <= 0.0 || CGRectIsEmpty(imageView.bounds)) return imageRect;
+    
+    visibleBounds = CGRectIntersection(visibleBounds, imageView.bounds);
+    if (CGRectIsEmpty(visibleBounds)) return imageRect;
+    
+    // The image view fills its bounds with the image and crops the rest, and the rect is rounded out to sixteenths of the image so small
+    // moves of the view keep the same stages
+    CGRect bounds = imageView.bounds;
+    CGFloat scale = MAX(CGRectGetWidth(bounds) / imageSize.width, CGRectGetHeight(bounds) / imageSize.height);
+    CGRect imageFrame = CGRectMake(CGRectGetMidX(bounds) - imageSize.width * scale / 2.0, CGRectGetMidY(bounds) - imageSize.height * scale / 2.0, imageSize.width * scale, imageSize.height * scale);
+    CGFloat minX = floor((CGRectGetMinX(visibleBounds) - CGRectGetMinX(imageFrame)) / CGRectGetWidth(imageFrame) * 16.0) / 16.0;
+    CGFloat minY = floor((CGRectGetMinY(visibleBounds) - CGRectGetMinY(imageFrame)) / CGRectGetHeight(imageFrame) * 16.0) / 16.0;
+    CGFloat maxX = ceil((CGRectGetMaxX(visibleBounds) - CGRectGetMinX(imageFrame)) / CGRectGetWidth(imageFrame) * 16.0) / 16.0;
+    CGFloat maxY = ceil((CGRectGetMaxY(visibleBounds) - CGRectGetMinY(imageFrame)) / CGRectGetHeight(imageFrame) * 16.0) / 16.0;
+    return CGRectIntersection(CGRectMake(minX, minY, maxX - minX, maxY - minY), imageRect);
 }
 
 - (BOOL)shouldUpdate
@@ -178,66 +284,225 @@
     return self.initialImage != nil;
 }
 
-- (CGFloat)blurRadiusForStage:(NSInteger)stage
+- (CGFloat)stageForPercentScrolled:(CGFloat)percentScrolled
+{
+    // The plan knows where its stages are, and the memory budget may leave fewer of them than requested
+    return self.plan ? [self.plan stageForPercentScrolled:percentScrolled] : percentScrolled * self.numberOfStages;
+}
+
+- (UIImage *)blurredImageForStage:(NSInteger)stage
+{
+    if (!self.plan || stage <= 0 || stage > (NSInteger)self.plan.numberOfStages) return nil;
+    
+    // Stages are read from the atlas by index while scrolling, until they are rendered the stages of a smaller rect or their previews stand in
+    UIImage *blurredImage = [self.atlas imageForStage:stage];
+    if (!blurredImage && stage < (NSInteger)self.previousAtlas.numberOfStages) blurredImage = [self.previousAtlas imageForStage:stage];
+    if (!blurredImage && stage < (NSInteger)self.previewImages.count) blurredImage = self.previewImages[stage];
+    return blurredImage;
+}
+
+// The helpers below run inside render jobs on a background queue, so they read the parameters the generator was configured with on the main
+// queue and never the properties of the view
+
+- (DBProfileBlurStageCacheKey *)cacheKeyForStage:(NSUInteger)stage plan:(DBProfileBlurStagePlan *)plan generator:(DBProfileBlurStageGenerator *)generator visibleRect:(CGRect)visibleRect
+{
+    return [[DBProfileBlurStageCacheKey alloc] initWithImageDigest:generator.imageDigest
+                                                        blurRadius:[plan.blurRadii[stage] doubleValue]
+                                                        iterations:generator.iterations
+                                                      pyramidLevel:[plan.pyramidLevels[stage] unsignedIntegerValue]
+                                                     blurAlgorithm:generator.blurAlgorithm
+                                                       visibleRect:visibleRect];
+}
+
+- (NSArray<DBProfileBlurStageCacheKey *> *)cacheKeysForPlan:(DBProfileBlurStagePlan *)plan generator:(DBProfileBlurStageGenerator *)generator visibleRect:(CGRect)visibleRect
+{
+    NSMutableArray<DBProfileBlurStageCacheKey *> *keys = [NSMutableArray arrayWithCapacity:plan.blurRadii.count];
+    for (NSUInteger stage = 0; stage < plan.blurRadii.count; stage++) {
+        [keys addObject:[self cacheKeyForStage:stage plan:plan generator:generator visibleRect:visibleRect]];
+    }
+    return keys;
+}
+
+- (DBProfileBlurStageAtlas *)cachedAtlasForPlan:(DBProfileBlurStagePlan *)plan generator:(DBProfileBlurStageGenerator *)generator visibleRect:(CGRect)visibleRect
+{
+    // An atlas blurred over the whole image by any view serves every part of it
+    DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+    NSArray<DBProfileBlurStageCacheKey *> *keys = [self cacheKeysForPlan:plan generator:generator visibleRect:visibleRect];
+    DBProfileBlurStageAtlas *atlas = [cache atlasForKeys:keys];
+    if (atlas || keys.lastObject.isComplete) return atlas;
+    return [cache atlasForKeys:[self cacheKeysForPlan:plan generator:generator visibleRect:CGRectMake(0.0, 0.0, 1.0, 1.0)]];
+}
+
+- (UIImage *)cachedImageForStage:(NSUInteger)stage plan:(DBProfileBlurStagePlan *)plan generator:(DBProfileBlurStageGenerator *)generator visibleRect:(CGRect)visibleRect
 {
-    return stage * (self.maxBlurRadius / self.numberOfStages);
+    // A whole stage blurred by any view serves every part of it
+    DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+    DBProfileBlurStageCacheKey *key = [self cacheKeyForStage:stage plan:plan generator:generator visibleRect:visibleRect];
+    UIImage *image = [cache imageForKey:key];
+    if (image || key.isComplete) return image;
+    return [cache imageForKey:[self cacheKeyForStage:stage plan:plan generator:generator visibleRect:CGRectMake(0.0, 0.0, 1.0, 1.0)]];
+}
+
+- (DBProfileBlurAlgorithm)stageBlurAlgorithm
+{
+    // The summed-area table renderer only blurs with boxes, so its stages match the box stages of the progressive renderer
+    return self.stageRenderer == DBProfileBlurStageRendererProgressive ? self.blurAlgorithm : DBProfileBlurAlgorithmBox;
+}
+
+- (NSIndexSet *)priorityStagesForPlan:(DBProfileBlurStagePlan *)plan
+{
+    // The current stage, the stage interpolated towards and the stage before it
+    NSInteger currentStage = round([plan stageForPercentScrolled:self.percentScrolled]);
+    NSMutableIndexSet *stages = [NSMutableIndexSet indexSet];
+    for (NSInteger stage = currentStage - 1; stage <= currentStage + 1; stage++) {
+        if (stage > 0 && stage <= (NSInteger)plan.numberOfStages) [stages addIndex:stage];
+    }
+    return stages;
 }
 
-- (UIImage *)blurredImageForStage:(CGFloat)stage
+- (BOOL)isCurrentRenderToken:(DBProfileBlurJobToken *)token
 {
-    return [self.cache blurredImageForImage:self.initialImage
-                                  tintColor:self.tintColor
-                                      stage:stage];
+    return token == self.renderToken && !token.isCancelled;
 }
 
-- (void)updateAsync:(BOOL)async completion:(void (^)())completion
+- (void)renderStages
 {
     if ([self shouldUpdate]) {
         
-        [self.cache removeAllObjects];
-
+        // Everything the job needs from the view is read here on the main queue, the plan and the generator are not changed once it is enqueued
         UIImage *initialImage = self.initialImage;
         
-        void (^block)() = ^void(){
-            for (NSInteger stage = 0; stage <= self.numberOfStages; stage++) {
-                UIImage *blurredImage = [initialImage blurredImageWithRadius:[self blurRadiusForStage:stage]
-                                                                  iterations:self.iterations
-                                                                   tintColor:self.tintColor];
-                
-                [self.cache setBlurredImage:blurredImage
-                                   forImage:initialImage
-                                  tintColor:self.tintColor
-                                      stage:stage];
-            }
-        };
+        DBProfileBlurStagePlanner *planner = [[DBProfileBlurStagePlanner alloc] initWithImage:initialImage];
+        planner.numberOfStages = self.numberOfStages;
+        planner.stageSpacing = self.stageSpacing;
+        planner.maxBlurRadius = self.maxBlurRadius;
+        planner.iterations = self.iterations;
+        planner.memoryBudget = self.memoryBudget;
+        planner.allowsDownsampling = self.shouldDownsampleStages;
+        DBProfileBlurStagePlan *plan = [planner plan];
+        self.plan = plan;
+        
+        // The initial image is decoded once, every later render of its stages reads the same pixels
+        if (!self.sourceImage) self.sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:initialImage];
+        DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithSourceImage:self.sourceImage];
+        generator.iterations = self.iterations;
+        generator.renderer = self.stageRenderer;
+        generator.blurAlgorithm = [self stageBlurAlgorithm];
+        generator.numberOfWorkers = self.numberOfWorkers;
+        generator.pyramidLevels = plan.pyramidLevels;
+        
+        // Only the part of the image on screen is blurred, it grows if more of the image comes on screen later
+        CGRect visibleRect = CGRectUnion(self.renderedRect, [self stageImageRect]);
+        self.renderedRect = visibleRect;
+        generator.visibleRect = visibleRect;
         
-        if (async) {
-            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-                block();
-                dispatch_sync(dispatch_get_main_queue(), ^{
-                    if (completion) completion();
+        NSIndexSet *currentStages = [self priorityStagesForPlan:plan];
+        BOOL needsPreviews = self.shouldPreviewStages && !self.previewImages && !self.previousAtlas;
+        DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+        
+        // Jobs of different views run side by side, and a newer job for this view cancels or replaces this one
+        // The job does not keep the view alive, a view that is released cancels its job and any job left behind returns early
+        __weak DBProfileBlurView *weakSelf = self;
+        self.renderToken = [[DBProfileBlurJobQueue sharedQueue] enqueueJobForOwner:self usingBlock:^(DBProfileBlurJobToken *token) {
+            // The digest of the generator is computed once per image and lets every view showing the same pixels share its stages
+            NSArray<DBProfileBlurStageCacheKey *> *keys = [weakSelf cacheKeysForPlan:plan generator:generator visibleRect:visibleRect];
+            if (!keys) return;
+            
+            // Stages rendered before for the same plan by any view are shown from their atlas as they are
+            NSMutableIndexSet *skippedStages = [NSMutableIndexSet indexSetWithIndex:0];
+            DBProfileBlurStageAtlas *atlas = [weakSelf cachedAtlasForPlan:plan generator:generator visibleRect:visibleRect];
+            BOOL rendersAtlas = (atlas == nil);
+            if (atlas) {
+                [skippedStages addIndexesInRange:NSMakeRange(0, plan.blurRadii.count)];
+            }
+            else {
+                // Otherwise every stage is rendered into a new atlas, except for stages any view has blurred before, which the atlas shows as they are,
+                // so stages mapped from the disk tier are never copied. Stage 0 always shows the initial image, so it is never rendered
+                NSMutableDictionary<NSNumber *, UIImage *> *cachedImages = [NSMutableDictionary dictionary];
+                for (NSUInteger stage = 1; stage < plan.blurRadii.count; stage++) {
+                    UIImage *cachedImage = [weakSelf cachedImageForStage:stage plan:plan generator:generator visibleRect:visibleRect];
+                    if (cachedImage) cachedImages[@(stage)] = cachedImage;
+                }
+                atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:generator.sourceImage pyramidLevels:plan.pyramidLevels stageImages:cachedImages];
+                for (NSUInteger stage = 1; stage < plan.blurRadii.count; stage++) {
+                    if ([atlas imageForStage:stage]) [skippedStages addIndex:stage];
+                }
+            }
+            generator.atlas = atlas;
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                DBProfileBlurView *strongSelf = weakSelf;
+                if ([strongSelf isCurrentRenderToken:token]) strongSelf.atlas = atlas;
+            });
+            
+            // Previews of every stage are shown within a few milliseconds, while the stages are rendered at full quality
+            if (needsPreviews && skippedStages.count < plan.blurRadii.count && !token.isCancelled) {
+                NSArray<UIImage *> *previewImages = [generator previewImagesWithBlurRadii:plan.blurRadii];
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    DBProfileBlurView *strongSelf = weakSelf;
+                    if ([strongSelf isCurrentRenderToken:token]) {
+                        strongSelf.previewImages = previewImages;
+                        [strongSelf setPercentScrolled:strongSelf.percentScrolled];
+                    }
                 });
+            }
+            
+            NSMutableIndexSet *priorityStages = [currentStages mutableCopy];
+            [priorityStages removeIndexes:skippedStages];
+            [skippedStages addIndexes:priorityStages];
+            
+            // The stages around the current offset are rendered directly so the header is blurred as soon as possible
+            [priorityStages enumerateIndexesUsingBlock:^(NSUInteger stage, BOOL *stop) {
+                if (token.isCancelled || !weakSelf) {
+                    *stop = YES;
+                    return;
+                }
+                [generator imageForStage:stage blurRadius:[plan.blurRadii[stage] doubleValue]];
+            }];
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                DBProfileBlurView *strongSelf = weakSelf;
+                if ([strongSelf isCurrentRenderToken:token]) [strongSelf setPercentScrolled:strongSelf.percentScrolled];
             });
-        }
-        else {
-            block();
-            if (completion) completion();
-        }
-    }
-    else if (completion) {
-        completion();
+            
+            // Each remaining stage is blurred from the previous one, which costs one box convolution per stage instead of `iterations`
+            [generator generateStagesWithBlurRadii:plan.blurRadii skippingStages:skippedStages usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+                if (token.isCancelled || !weakSelf) *stop = YES;
+            }];
+            
+            // Only complete atlases are shared, the stages of a cancelled job are dropped with it
+            if (rendersAtlas && !token.isCancelled) [cache setAtlas:atlas forKeys:keys];
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                DBProfileBlurView *strongSelf = weakSelf;
+                if ([strongSelf isCurrentRenderToken:token]) {
+                    strongSelf.previewImages = nil;
+                    strongSelf.previousAtlas = nil;
+                    strongSelf.fullFidelity = YES;
+                    [strongSelf setPercentScrolled:strongSelf.percentScrolled];
+                    if (strongSelf.fullFidelityHandler) strongSelf.fullFidelityHandler(strongSelf);
+                }
+            });
+        }];
     }
 }
 
 - (void)applyLayoutAttributes:(DBProfileHeaderViewLayoutAttributes *)layoutAttributes
 {
     [super applyLayoutAttributes:layoutAttributes];
+    self.collapsedBounds = layoutAttributes.collapsedBounds;
     
-    if (layoutAttributes.headerStyle == DBProfileHeaderStyleDefault) {
+    if (layoutAttributes.headerStyle == DBProfileHeaderStyleDefault && self.isBlurEnabled) {
         self.blurEnabled = NO;
     }
     
     [self setPercentScrolled:layoutAttributes.percentTransitioned];
 }
 
+- (id)scrollDependentLayoutInputs
+{
+    // The stages are rendered over the part of the image on screen, which is rounded out so it only changes when the view moves far enough
+    return self.isBlurEnabled ? [NSValue valueWithCGRect:[self visibleImageRect]] : nil;
+}
+
 @end
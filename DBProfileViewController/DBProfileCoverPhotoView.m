@@ -76,7 +76,7 @@
 - (void)applyLayoutAttributes:(DBProfileHeaderViewLayoutAttributes *)layoutAttributes {
     [super applyLayoutAttributes:layoutAttributes];
     
-    if (layoutAttributes.headerStyle == DBProfileHeaderStyleDefault) {
+    if (layoutAttributes.headerStyle == DBProfileHeaderStyleDefault && self.shouldApplyTint) {
         self.shouldApplyTint = NO;
     }
 }
@@ -30,6 +30,7 @@
     if (self) {
         self.headerStyle = DBProfileHeaderStyleNavigation;
         self.scrollEffects = DBProfileHeaderScrollEffectStretch;
+        self.collapsedBounds = CGRectNull;
     }
     return self;
 }
@@ -61,6 +62,7 @@
     copy.navigationConstraint = self.navigationConstraint;
     copy.topLayoutGuideConstraint = self.topLayoutGuideConstraint;
     copy.topSuperviewConstraint = self.topSuperviewConstraint;
+    copy.collapsedBounds = self.collapsedBounds;
 
     return copy;
 }
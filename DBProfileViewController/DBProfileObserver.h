@@ -6,7 +6,7 @@
 //  Copyright (c) 2015 Devon Boyer. All rights reserved.
 //
 
-#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -36,10 +36,35 @@ NS_ASSUME_NONNULL_BEGIN
 @end
 
 
+/**
+ *  The `DBProfileScrollViewObserver` class tells its delegate when the content offset of a scroll view changes, at most once per display frame.
+ *
+ *  Changes made while the scroll view is tracking, dragging or decelerating are merged and delivered once, after gesture recognizers and display
+ *  links have moved the scroll view and before Core Animation commits the frame, so the frame is laid out for its last offset only. Other changes,
+ *  such as offsets set by the profile view controller itself, are delivered immediately together with any merged change, so they take effect
+ *  inside the animations of the caller.
+ *
+ *  An observer is meant to live as long as the scroll view it observes. Pausing it stops delivery without removing the observation.
+ */
 @interface DBProfileScrollViewObserver : DBProfileObserver
 
 - (instancetype)initWithTargetView:(UIScrollView *)scrollView delegate:(id <DBProfileScrollViewObserverDelegate>)delegate;
 
+/**
+ *  The observed scroll view.
+ */
+@property (nonatomic, readonly) UIScrollView *scrollView;
+
+/**
+ *  Whether changes of the content offset are ignored. Setting this to `YES` drops a merged change that has not been delivered yet.
+ */
+@property (nonatomic, getter=isPaused) BOOL paused;
+
+/**
+ *  Delivers a merged change now rather than at the end of the frame. Does nothing if no change is pending.
+ */
+- (void)flush;
+
 @end
 
 NS_ASSUME_NONNULL_END
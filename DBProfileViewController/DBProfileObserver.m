@@ -61,10 +61,41 @@
 
 @end
 
+@interface DBProfileScrollViewObserver ()
+
+@property (nonatomic) BOOL needsDelivery;
+
+@end
+
 @implementation DBProfileScrollViewObserver
 
 static void *_DBProfileScrollViewObserverContext = &_DBProfileScrollViewObserverContext;
 
+// Core Animation commits the frame from a run loop observer of order 2000000, so merged changes are delivered just before it
+static const CFIndex DBProfileScrollViewObserverRunLoopOrder = 1999000;
+
+static NSHashTable *DBProfileScrollViewObserverPendingObservers(void) {
+    static NSHashTable *pendingObservers;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pendingObservers = [NSHashTable weakObjectsHashTable];
+
+        // A single observer on the main run loop serves every scroll view, and does nothing in frames without merged changes
+        CFRunLoopObserverRef runLoopObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true,
+                                                                                  DBProfileScrollViewObserverRunLoopOrder, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+            if (pendingObservers.count == 0) return;
+            NSArray<DBProfileScrollViewObserver *> *observers = pendingObservers.allObjects;
+            [pendingObservers removeAllObjects];
+            for (DBProfileScrollViewObserver *scrollViewObserver in observers) {
+                [scrollViewObserver flush];
+            }
+        });
+        CFRunLoopAddObserver(CFRunLoopGetMain(), runLoopObserver, kCFRunLoopCommonModes);
+        CFRelease(runLoopObserver);
+    });
+    return pendingObservers;
+}
+
 - (instancetype)initWithTargetView:(UIScrollView *)scrollView delegate:(id <DBProfileScrollViewObserverDelegate>)delegate {
     return [super initWithTarget:scrollView
                         keyPaths:@[@"contentOffset"]
@@ -73,4 +104,42 @@ static void *_DBProfileScrollViewObserverContext = &_DBProfileScrollViewObserver
                          context:_DBProfileScrollViewObserverContext];
 }
 
+- (UIScrollView *)scrollView {
+    return self.target;
+}
+
+- (void)setPaused:(BOOL)paused {
+    _paused = paused;
+    if (paused && self.needsDelivery) {
+        self.needsDelivery = NO;
+        [DBProfileScrollViewObserverPendingObservers() removeObject:self];
+    }
+}
+
+- (void)flush {
+    if (!self.needsDelivery) return;
+    self.needsDelivery = NO;
+    [DBProfileScrollViewObserverPendingObservers() removeObject:self];
+    [self.delegate observedScrollViewDidScroll:self.scrollView];
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath
+                      ofObject:(id)object
+                        change:(NSDictionary *)change
+                       context:(void *)context {
+    NSAssert(context == self.context, @"Unexpected KVO");
+    if (self.isPaused) return;
+
+    if (!self.needsDelivery) {
+        self.needsDelivery = YES;
+        [DBProfileScrollViewObserverPendingObservers() addObject:self];
+    }
+
+    // Scrolling moves the offset several times per frame during fast flings, while offsets set in code must take effect right away
+    UIScrollView *scrollView = self.scrollView;
+    if (!scrollView.isTracking && !scrollView.isDragging && !scrollView.isDecelerating) {
+        [self flush];
+    }
+}
+
 @end
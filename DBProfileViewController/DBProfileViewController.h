@@ -21,6 +21,7 @@
 #import <DBProfileViewController/DBProfileAvatarViewLayoutAttributes.h>
 #import <DBProfileViewController/DBProfileAccessoryView.h>
 #import <DBProfileViewController/DBProfileAvatarView.h>
+#import <DBProfileViewController/DBProfileBackdropBlurView.h>
 #import <DBProfileViewController/DBProfileBlurView.h>
 #import <DBProfileViewController/DBProfileCoverPhotoView.h>
 #import <DBProfileViewController/DBProfileHeaderOverlayView.h>
@@ -50,8 +50,9 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
 // Data
 @property (nonatomic) DBProfileContentOffsetCache *contentOffsetCache;
 @property (nonatomic) NSMutableArray<DBProfileContentController *> *contentControllers;
-@property (nonatomic) NSMutableDictionary<NSString *, DBProfileObserver *> *scrollViewObservers;
+@property (nonatomic) NSMutableDictionary<NSString *, DBProfileScrollViewObserver *> *scrollViewObservers;
 @property (nonatomic) NSMutableArray<DBProfileAccessoryViewModel *> *accessoryViewModels;
+@property (nonatomic) NSMutableDictionary<NSString *, NSArray *> *appliedLayoutInputs;
 
 @property (nonatomic) Class segmentedControlClass;
 @property (nonatomic) UIView *containerView;
@@ -278,6 +279,13 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
     return _scrollViewObservers;
 }
 
+- (NSMutableDictionary *)appliedLayoutInputs {
+    if (!_appliedLayoutInputs) {
+        _appliedLayoutInputs = [NSMutableDictionary dictionary];
+    }
+    return _appliedLayoutInputs;
+}
+
 - (void)setDetailView:(__kindof UIView *)detailView {
     _detailView = detailView;
     
@@ -393,21 +401,19 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
 - (void)showContentControllerAtIndex:(NSInteger)controllerIndex {
     if (![self.contentControllers count]) return;
     
-    // Hide the currently displayed content controller and remove scroll view observer
+    // Hide the currently displayed content controller and pause its scroll view observer
     DBProfileContentController *hideContentController = self.displayedContentController;
     if (hideContentController) {
-        [self removeContentController:hideContentController];
         NSString *key = [self.contentOffsetCache keyForContentControllerAtIndex:_indexForDisplayedContentController];
-        if ([self.scrollViewObservers valueForKey:key]) {
-            [self.scrollViewObservers removeObjectForKey:key];
-        }
+        self.scrollViewObservers[key].paused = YES;
+        [self removeContentController:hideContentController];
     }
     
     self.indexForDisplayedContentController = controllerIndex;
 
     [self.segmentedControl setSelectedSegmentIndex:controllerIndex];
     
-    // Display the desired content controller and add scroll view observer
+    // Display the desired content controller and resume its scroll view observer, which lives until the content controllers are reloaded
     DBProfileContentController *displayContentController = self.displayedContentController;
     
     if (displayContentController) {
@@ -416,9 +422,13 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         [self setDisplayedContentController:displayContentController animated:YES];
 
         NSString *key = [self.contentOffsetCache keyForContentControllerAtIndex:controllerIndex];
-        DBProfileScrollViewObserver *observer = [[DBProfileScrollViewObserver alloc] initWithTargetView:displayContentController.contentScrollView delegate:self];
-        [observer startObserving];
-        self.scrollViewObservers[key] = observer;
+        UIScrollView *scrollView = displayContentController.contentScrollView;
+        DBProfileScrollViewObserver *observer = self.scrollViewObservers[key];
+        if (observer.scrollView != scrollView) {
+            observer = [[DBProfileScrollViewObserver alloc] initWithTargetView:scrollView delegate:self];
+            self.scrollViewObservers[key] = observer;
+        }
+        observer.paused = NO;
     }
     
     [self updateViewConstraints];
@@ -957,7 +967,65 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
 #pragma mark - DBProfileLayoutAttributesConfiguration
 
 - (BOOL)shouldInvalidateLayoutAttributesForAccessoryViewOfKind:(NSString *)accessoryViewKind forBoundsChange:(CGRect)newBounds {
-    return accessoryViewKind == DBProfileAccessoryKindHeader || accessoryViewKind == DBProfileAccessoryKindAvatar;
+    if (accessoryViewKind != DBProfileAccessoryKindHeader && accessoryViewKind != DBProfileAccessoryKindAvatar) return NO;
+    
+    // Layout attributes are only configured again when an input they were last configured from has changed
+    NSArray *layoutInputs = [self layoutInputsForAccessoryViewOfKind:accessoryViewKind];
+    return !layoutInputs || ![layoutInputs isEqualToArray:self.appliedLayoutInputs[accessoryViewKind]];
+}
+
+- (NSArray *)layoutInputsForAccessoryViewOfKind:(NSString *)accessoryViewKind {
+    CGPoint contentOffset = self.contentOffsetForDisplayedContentController;
+    DBProfileAccessoryView *accessoryView = [self accessoryViewOfKind:accessoryViewKind];
+    CGSize referenceSize = [self referenceSizeForAccessoryViewOfKind:accessoryViewKind];
+    id scrollDependentLayoutInputs = [accessoryView scrollDependentLayoutInputs] ?: [NSNull null];
+    
+    if ([accessoryViewKind isEqualToString:DBProfileAccessoryKindHeader]) {
+        DBProfileHeaderViewLayoutAttributes *layoutAttributes = [self layoutAttributesForAccessoryViewOfKind:accessoryViewKind];
+        
+        // The header stretches and transitions from the top of the content upwards and transitions past the title view, so the offset itself is
+        // only an input outside of that range. In between, only the side of the navigation bar the header is on changes its output.
+        CGFloat titleViewOffset = [self _titleViewOffset];
+        BOOL tracksContentOffset = contentOffset.y <= 0 || contentOffset.y > titleViewOffset;
+        BOOL belowNavigationBar = contentOffset.y < CGRectGetHeight(accessoryView.frame) - layoutAttributes.navigationConstraint.constant;
+        
+        return @[tracksContentOffset ? @(contentOffset.y) : [NSNull null],
+                 @(belowNavigationBar),
+                 @(CGRectGetHeight(accessoryView.frame)),
+                 @(titleViewOffset),
+                 @(CGRectGetMaxY(self.overlayView.frame)),
+                 @(self.automaticallyAdjustsScrollViewInsets ? [self.topLayoutGuide length] : -1),
+                 [NSValue valueWithCGSize:referenceSize],
+                 @(layoutAttributes.headerStyle),
+                 @(layoutAttributes.scrollEffects),
+                 @(layoutAttributes.hasInstalledConstraints),
+                 @(self.traitCollection.verticalSizeClass),
+                 @(self.isUpdating),
+                 scrollDependentLayoutInputs];
+    }
+    else if ([accessoryViewKind isEqualToString:DBProfileAccessoryKindAvatar]) {
+        DBProfileAvatarViewLayoutAttributes *layoutAttributes = [self layoutAttributesForAccessoryViewOfKind:accessoryViewKind];
+        DBProfileHeaderViewLayoutAttributes *headerViewLayoutAttributes = [self layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+        
+        // The avatar is at rest above the top of the content and fully shrunk past the header, so the offset itself is only an input in between
+        CGFloat headerOffset = [self _headerViewOffset];
+        if (headerViewLayoutAttributes.headerStyle == DBProfileHeaderStyleNavigation) {
+            headerOffset -= CGRectGetMaxY(self.overlayView.frame);
+        }
+        id offsetInput = @(contentOffset.y);
+        if (headerOffset > 0 && contentOffset.y <= 0) offsetInput = @"rest";
+        else if (headerOffset > 0 && contentOffset.y >= headerOffset) offsetInput = @"shrunk";
+        
+        return @[offsetInput,
+                 @(headerOffset),
+                 [NSValue valueWithUIEdgeInsets:layoutAttributes.edgeInsets],
+                 @(layoutAttributes.avatarAlignment),
+                 [NSValue valueWithCGSize:referenceSize],
+                 @(layoutAttributes.hasInstalledConstraints),
+                 @(self.isUpdating),
+                 scrollDependentLayoutInputs];
+    }
+    return nil;
 }
 
 - (void)configureLayoutAttributes:(__kindof DBProfileAccessoryViewLayoutAttributes *)layoutAttributes forAccessoryViewOfKind:(NSString *)accessoryViewKind {
@@ -969,6 +1037,10 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         [self configureHeaderViewLayoutAttributes:layoutAttributes];
     }
     
+    [self updateFrontToBackOrderingOfAccessoryViews];
+}
+
+- (void)updateFrontToBackOrderingOfAccessoryViews {
     UIView *superview = self.displayedContentController.contentScrollView;
     
     // Reorganize the front-to-back ordering of accessory views using the zIndex layout attribute
@@ -976,7 +1048,18 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         return lhs.layoutAttributes.zIndex > rhs.layoutAttributes.zIndex;
     }];
     
-    UIView *topSubview = [superview.subviews lastObject]; // scroll indicators
+    NSArray<UIView *> *subviews = superview.subviews;
+    UIView *topSubview = [subviews lastObject]; // scroll indicators
+    
+    // Subviews are only moved when the accessory views are not already the frontmost subviews in order, just behind the scroll indicators
+    NSUInteger index = subviews.count;
+    if (index > 0 && ![topSubview isKindOfClass:[DBProfileAccessoryView class]]) index--;
+    BOOL ordered = index >= sortedViewModels.count;
+    for (DBProfileAccessoryViewModel *viewModel in [sortedViewModels reverseObjectEnumerator]) {
+        if (!ordered) break;
+        ordered = subviews[--index] == viewModel.accessoryView;
+    }
+    if (ordered) return;
     
     for (DBProfileAccessoryViewModel *viewModel in sortedViewModels) {
         [superview bringSubviewToFront:viewModel.accessoryView];
@@ -1003,10 +1086,19 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
     CGSize referenceSize = [self referenceSizeForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
     
     if (contentOffset.y < 0 && layoutAttributes.scrollEffects & DBProfileHeaderScrollEffectStretch) {
-        layoutAttributes.heightConstraint.constant = referenceSize.height - contentOffset.y;
+        DBProfileSetConstraintConstant(layoutAttributes.heightConstraint, referenceSize.height - contentOffset.y);
     }
     else {
-        layoutAttributes.heightConstraint.constant = referenceSize.height;
+        DBProfileSetConstraintConstant(layoutAttributes.heightConstraint, referenceSize.height);
+    }
+    
+    // A navigation header collapses until only its bottom is left under the top of the view
+    if (layoutAttributes.headerStyle == DBProfileHeaderStyleNavigation) {
+        CGFloat navigationBarHeight = DBProfileDesiredNavigationBarHeightForTraitCollection(self.traitCollection);
+        layoutAttributes.collapsedBounds = CGRectMake(0, referenceSize.height - navigationBarHeight, CGRectGetWidth(headerView.bounds), navigationBarHeight);
+    }
+    else {
+        layoutAttributes.collapsedBounds = CGRectNull;
     }
     
     // Calculate percent transitioned
@@ -1019,16 +1111,14 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
     // Configure constraint-based layout attributes
     if (layoutAttributes.hasInstalledConstraints) {
         
-        layoutAttributes.navigationConstraint.constant = DBProfileDesiredNavigationBarHeightForTraitCollection(self.traitCollection);
+        DBProfileSetConstraintConstant(layoutAttributes.navigationConstraint, DBProfileDesiredNavigationBarHeightForTraitCollection(self.traitCollection));
         
         switch (layoutAttributes.headerStyle) {
             case DBProfileHeaderStyleNavigation:
-                [NSLayoutConstraint activateConstraints:@[layoutAttributes.navigationConstraint, layoutAttributes.topSuperviewConstraint]];
-                [NSLayoutConstraint deactivateConstraints:@[layoutAttributes.topLayoutGuideConstraint]];
+                DBProfileActivateConstraints(@[layoutAttributes.navigationConstraint, layoutAttributes.topSuperviewConstraint], @[layoutAttributes.topLayoutGuideConstraint]);
                 break;
             default:
-                [NSLayoutConstraint activateConstraints:@[layoutAttributes.topLayoutGuideConstraint]];
-                [NSLayoutConstraint deactivateConstraints:@[layoutAttributes.navigationConstraint, layoutAttributes.topSuperviewConstraint]];
+                DBProfileActivateConstraints(@[layoutAttributes.topLayoutGuideConstraint], @[layoutAttributes.navigationConstraint, layoutAttributes.topSuperviewConstraint]);
                 break;
         }
     }
@@ -1066,16 +1156,13 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         
         switch (layoutAttributes.avatarAlignment) {
             case DBProfileAvatarAlignmentLeft:
-                [NSLayoutConstraint activateConstraints:@[layoutAttributes.leftConstraint]];
-                [NSLayoutConstraint deactivateConstraints:@[layoutAttributes.rightConstraint, layoutAttributes.centerXConstraint]];
+                DBProfileActivateConstraints(@[layoutAttributes.leftConstraint], @[layoutAttributes.rightConstraint, layoutAttributes.centerXConstraint]);
                 break;
             case DBProfileAvatarAlignmentRight:
-                [NSLayoutConstraint activateConstraints:@[layoutAttributes.rightConstraint]];
-                [NSLayoutConstraint deactivateConstraints:@[layoutAttributes.leftConstraint, layoutAttributes.centerXConstraint]];
+                DBProfileActivateConstraints(@[layoutAttributes.rightConstraint], @[layoutAttributes.leftConstraint, layoutAttributes.centerXConstraint]);
                 break;
             case DBProfileAvatarAlignmentCenter:
-                [NSLayoutConstraint activateConstraints:@[layoutAttributes.centerXConstraint]];
-                [NSLayoutConstraint deactivateConstraints:@[layoutAttributes.leftConstraint, layoutAttributes.rightConstraint]];
+                DBProfileActivateConstraints(@[layoutAttributes.centerXConstraint], @[layoutAttributes.leftConstraint, layoutAttributes.rightConstraint]);
                 break;
             default:
                 break;
@@ -1083,10 +1170,10 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         
         CGSize referenceSize = [self referenceSizeForAccessoryViewOfKind:DBProfileAccessoryKindAvatar];
         
-        layoutAttributes.widthConstraint.constant = MAX(referenceSize.width, referenceSize.height);
-        layoutAttributes.leftConstraint.constant = layoutAttributes.edgeInsets.left - layoutAttributes.edgeInsets.right;
-        layoutAttributes.rightConstraint.constant = -(layoutAttributes.edgeInsets.left - layoutAttributes.edgeInsets.right);
-        layoutAttributes.topConstraint.constant = layoutAttributes.edgeInsets.top - layoutAttributes.edgeInsets.bottom;
+        DBProfileSetConstraintConstant(layoutAttributes.widthConstraint, MAX(referenceSize.width, referenceSize.height));
+        DBProfileSetConstraintConstant(layoutAttributes.leftConstraint, layoutAttributes.edgeInsets.left - layoutAttributes.edgeInsets.right);
+        DBProfileSetConstraintConstant(layoutAttributes.rightConstraint, -(layoutAttributes.edgeInsets.left - layoutAttributes.edgeInsets.right));
+        DBProfileSetConstraintConstant(layoutAttributes.topConstraint, layoutAttributes.edgeInsets.top - layoutAttributes.edgeInsets.bottom);
     }
 }
 
@@ -1095,6 +1182,11 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
     
     DBProfileAccessoryViewLayoutAttributes *layoutAttributes = [self layoutAttributesForAccessoryViewOfKind:accessoryViewKind];
     
+    // Remember the inputs the layout attributes are configured from, so scrolling only configures them again once an input changes
+    NSArray *layoutInputs = [self layoutInputsForAccessoryViewOfKind:accessoryViewKind];
+    if (layoutInputs) self.appliedLayoutInputs[accessoryViewKind] = layoutInputs;
+    else [self.appliedLayoutInputs removeObjectForKey:accessoryViewKind];
+    
     // The layout attributes have been marked as invalid and must be re-configured and applied to the associated accessory view.
     [self configureLayoutAttributes:layoutAttributes forAccessoryViewOfKind:accessoryViewKind];
     
@@ -1121,6 +1213,9 @@ static const CGFloat DBProfileViewControllerPullToRefreshTriggerDistance = 80.0;
         }
     }
     
+    // Subviews added by the scroll view while scrolling must stay behind the accessory views, even when no accessory view was invalidated
+    [self updateFrontToBackOrderingOfAccessoryViews];
+    
     [self updateTitleViewWithContentOffset:contentOffset];
     [self handlePullToRefreshWithScrollView:scrollView];
 }
@@ -26,6 +26,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, copy) NSString *representedAccessoryKind;
 
+/**
+ *  The state of the accessory view, other than its layout attributes, that changes how the layout attributes apply to it while its scroll view scrolls,
+ *  such as the part of it that is on screen. Layout attributes are applied again when it changes. Defaults to nil.
+ */
+- (nullable id)scrollDependentLayoutInputs;
+
 @end
 
 NS_ASSUME_NONNULL_END
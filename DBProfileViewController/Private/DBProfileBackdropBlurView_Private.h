@@ -0,0 +1,69 @@
+//
+//  DBProfileBackdropBlurView_Private.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBackdropBlurView.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+// FXBlurView implements these methods but does not declare them
+@interface FXBlurView (DBProfileBackdropBlurView)
+
+- (BOOL)shouldUpdate;
+- (void)schedule;
+- (CALayer *)underlyingLayer;
+- (CALayer *)blurPresentationLayer;
+- (BOOL)needsDrawViewHierarchy;
+- (NSArray *)prepareUnderlyingViewForSnapshot;
+- (void)restoreSuperviewAfterSnapshot:(NSArray *)hiddenLayers;
+- (UIImage *)blurredSnapshot:(UIImage *)snapshot radius:(CGFloat)blurRadius;
+- (void)setLayerContents:(UIImage *)image;
+
+@end
+
+@interface DBProfileBackdropBlurView ()
+
+/**
+ *  The time the next update of the view is due at, in the timebase of `CACurrentMediaTime`.
+ */
+@property (nonatomic) CFTimeInterval dueTime;
+
+/**
+ *  The index of the view in the due-time heap of the `DBProfileBlurScheduler`, or `NSNotFound` while the view is not due.
+ */
+@property (nonatomic) NSUInteger dueIndex;
+
+/**
+ *  The scale the views behind the view are snapshotted at, which shrinks as the blur radius grows.
+ */
+- (CGFloat)snapshotScale;
+
+/**
+ *  The rect of the underlying layer the view snapshots, rounded to whole pixels at `snapshotScale`.
+ */
+- (CGRect)snapshotRect;
+
+/**
+ *  Views with equal keys hide the same layers of the same underlying layer for a snapshot at the same scale, so one snapshot of the union of
+ *  their rects holds the snapshot of each of them. Nil while the view is not inside its underlying view.
+ */
+- (nullable id)snapshotKey;
+
+/**
+ *  Snapshots the specified rect of the underlying layer at the specified scale, with the view and the layers in front of it hidden.
+ */
+- (nullable UIImage *)snapshotOfUnderlyingViewInRect:(CGRect)rect scale:(CGFloat)scale;
+
+/**
+ *  Blurs a snapshot of `snapshotRect` taken for the view on a background queue and displays it, the same way `updateAsynchronously:completion:`
+ *  does with a snapshot it takes itself. The completion is called on the main queue.
+ */
+- (void)updateWithSnapshot:(UIImage *)snapshot completion:(nullable void (^)(void))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,81 @@
+//
+//  DBProfileBlurBufferPool.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurBufferPool` class recycles the working memory of blurs, so that blurring many stages or refreshing a blur view does not
+ *  allocate and fault in several megabytes of fresh memory every time.
+ *
+ *  Sizes are rounded up to size classes at most 25% apart, so buffers for images of similar sizes can be reused for each other. Idle buffers
+ *  beyond `idleBytesLimit` are freed, and every idle buffer is freed when the app receives a memory warning.
+ *
+ *  All methods are safe to call from any thread.
+ */
+@interface DBProfileBlurBufferPool : NSObject
+
+/**
+ *  The pool shared by the blur stage generator, the blur image category and `DBProfileBackdropBlurView`.
+ */
++ (instancetype)sharedPool;
+
+/**
+ *  The largest number of bytes of idle buffers to keep for reuse.
+ *
+ *  Defaults to 32 MB.
+ */
+@property (nonatomic) NSUInteger idleBytesLimit;
+
+/**
+ *  The largest number of bytes of working memory a single blur holds at once, besides the pixels of the image and of the result, or 0 for
+ *  no limit.
+ *
+ *  Images whose working buffers would not fit, such as uncropped cover photos of 12 megapixels or more, are blurred in strips of rows
+ *  sized to this budget instead of in full-size buffers. Strips are never shorter than the halo of rows their blur reads around them.
+ *
+ *  Defaults to 32 MB.
+ */
+@property (nonatomic) NSUInteger workingBytesLimit;
+
+/**
+ *  The number of bytes of idle buffers kept for reuse.
+ */
+@property (nonatomic, readonly) NSUInteger idleBytes;
+
+/**
+ *  The number of buffers requested from the pool.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfRequests;
+
+/**
+ *  The number of requests served with a recycled buffer, which is the number of allocations the pool saved.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfReuses;
+
+/**
+ *  Returns an uninitialized buffer of at least `size` bytes, recycled if possible.
+ *
+ *  @return NULL if the memory could not be allocated.
+ */
+- (nullable void *)bufferWithSize:(size_t)size;
+
+/**
+ *  Returns a buffer to the pool. `size` must be the size it was requested with.
+ */
+- (void)recycleBuffer:(nullable void *)buffer size:(size_t)size;
+
+/**
+ *  Frees every idle buffer.
+ */
+- (void)trim;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,165 @@
+//
+//  DBProfileBlurBufferPool.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurBufferPool.h"
+
+// Four classes per doubling keeps the memory wasted by rounding below 25%
+static size_t DBProfileBlurBufferPoolSizeClass(size_t size) {
+    if (size <= 4096) return 4096;
+    size_t octave = 4096;
+    while (octave * 2 < size) octave *= 2;
+    size_t step = octave / 4;
+    return (size + step - 1) / step * step;
+}
+
+@interface DBProfileBlurBufferPool ()
+
+@property (nonatomic) NSMutableDictionary<NSNumber *, NSMutableArray<NSValue *> *> *idleBuffers;
+@property (nonatomic) NSUInteger idleBytes;
+@property (nonatomic) NSUInteger numberOfRequests;
+@property (nonatomic) NSUInteger numberOfReuses;
+
+@end
+
+@implementation DBProfileBlurBufferPool
+
++ (instancetype)sharedPool {
+    static DBProfileBlurBufferPool *sharedPool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[self alloc] init];
+        [[NSNotificationCenter defaultCenter] addObserver:sharedPool
+                                                 selector:@selector(trim)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+    });
+    return sharedPool;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _idleBytesLimit = 32 * 1024 * 1024;
+        _workingBytesLimit = 32 * 1024 * 1024;
+        self.idleBuffers = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self trim];
+}
+
+- (NSUInteger)idleBytesLimit {
+    @synchronized (self) {
+        return _idleBytesLimit;
+    }
+}
+
+- (void)setIdleBytesLimit:(NSUInteger)idleBytesLimit {
+    @synchronized (self) {
+        _idleBytesLimit = idleBytesLimit;
+        [self freeIdleBuffersToFitSize:0];
+    }
+}
+
+- (NSUInteger)workingBytesLimit {
+    @synchronized (self) {
+        return _workingBytesLimit;
+    }
+}
+
+- (void)setWorkingBytesLimit:(NSUInteger)workingBytesLimit {
+    @synchronized (self) {
+        _workingBytesLimit = workingBytesLimit;
+    }
+}
+
+- (NSUInteger)idleBytes {
+    @synchronized (self) {
+        return _idleBytes;
+    }
+}
+
+- (NSUInteger)numberOfRequests {
+    @synchronized (self) {
+        return _numberOfRequests;
+    }
+}
+
+- (NSUInteger)numberOfReuses {
+    @synchronized (self) {
+        return _numberOfReuses;
+    }
+}
+
+- (void *)bufferWithSize:(size_t)size {
+    size_t sizeClass = DBProfileBlurBufferPoolSizeClass(size);
+
+    @synchronized (self) {
+        _numberOfRequests++;
+
+        NSMutableArray<NSValue *> *buffers = self.idleBuffers[@(sizeClass)];
+        if (buffers.count) {
+            void *buffer = buffers.lastObject.pointerValue;
+            [buffers removeLastObject];
+            if (!buffers.count) [self.idleBuffers removeObjectForKey:@(sizeClass)];
+            _idleBytes -= sizeClass;
+            _numberOfReuses++;
+            return buffer;
+        }
+    }
+    return malloc(sizeClass);
+}
+
+- (void)recycleBuffer:(void *)buffer size:(size_t)size {
+    if (!buffer) return;
+    size_t sizeClass = DBProfileBlurBufferPoolSizeClass(size);
+
+    @synchronized (self) {
+        if (sizeClass > _idleBytesLimit) {
+            free(buffer);
+            return;
+        }
+        [self freeIdleBuffersToFitSize:sizeClass];
+
+        NSMutableArray<NSValue *> *buffers = self.idleBuffers[@(sizeClass)];
+        if (!buffers) {
+            buffers = [NSMutableArray array];
+            self.idleBuffers[@(sizeClass)] = buffers;
+        }
+        [buffers addObject:[NSValue valueWithPointer:buffer]];
+        _idleBytes += sizeClass;
+    }
+}
+
+- (void)trim {
+    @synchronized (self) {
+        for (NSMutableArray<NSValue *> *buffers in self.idleBuffers.allValues) {
+            for (NSValue *buffer in buffers) free(buffer.pointerValue);
+        }
+        [self.idleBuffers removeAllObjects];
+        _idleBytes = 0;
+    }
+}
+
+- (void)freeIdleBuffersToFitSize:(size_t)size {
+    // The largest buffers go first, they are the most expensive to keep and the least likely to fit the next request
+    while (_idleBytes > 0 && _idleBytes + size > _idleBytesLimit) {
+        NSNumber *largestSizeClass = [self.idleBuffers.allKeys valueForKeyPath:@"@max.self"];
+        NSMutableArray<NSValue *> *buffers = self.idleBuffers[largestSizeClass];
+        free(buffers.lastObject.pointerValue);
+        [buffers removeLastObject];
+        if (!buffers.count) [self.idleBuffers removeObjectForKey:largestSizeClass];
+        _idleBytes -= largestSizeClass.unsignedIntegerValue;
+    }
+}
+
+@end
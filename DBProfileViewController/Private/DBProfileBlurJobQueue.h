@@ -0,0 +1,92 @@
+//
+//  DBProfileBlurJobQueue.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurJobToken` class identifies one job of a `DBProfileBlurJobQueue`.
+ *
+ *  A token is cancelled as soon as a newer job is submitted for the same owner. Jobs should check `isCancelled` between stages and return early.
+ */
+@interface DBProfileBlurJobToken : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The number of jobs submitted for the owner of the job, including this one.
+ */
+@property (nonatomic, readonly) NSUInteger generation;
+
+/**
+ *  Whether the job has been cancelled or replaced by a newer job.
+ */
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/**
+ *  Cancels the job. A job that has not started yet never runs.
+ */
+- (void)cancel;
+
+@end
+
+/**
+ *  The `DBProfileBlurJobQueue` class runs blur jobs off the main thread, up to `maxConcurrentJobs` at a time.
+ *
+ *  Every owner has at most one job that matters, the latest one. Submitting a job cancels the owner's running job and replaces its pending job,
+ *  so a burst of requests for the same owner results in a single job. Jobs of deferred owners, such as views that are off screen, run after
+ *  every other pending job.
+ */
+@interface DBProfileBlurJobQueue : NSObject
+
+/**
+ *  The queue shared by all blur views.
+ */
++ (instancetype)sharedQueue;
+
+/**
+ *  Submits a job for the specified owner. The owner is not retained.
+ *
+ *  @param owner The object the job renders for, typically a view.
+ *  @param block The job, called on a background queue with its token.
+ *
+ *  @return The token of the job.
+ */
+- (DBProfileBlurJobToken *)enqueueJobForOwner:(id)owner usingBlock:(void (^)(DBProfileBlurJobToken *token))block;
+
+/**
+ *  Cancels the running and pending jobs of the specified owner.
+ */
+- (void)cancelJobsForOwner:(id)owner;
+
+/**
+ *  Sets whether the jobs of the specified owner wait until no other job is pending. The owner is not retained.
+ *
+ *  A running job is not interrupted, the owner's next job is queued behind the jobs of owners that are not deferred.
+ */
+- (void)setJobsDeferred:(BOOL)deferred forOwner:(id)owner;
+
+/**
+ *  The maximum number of jobs that run at the same time. The default value is 2, or 1 on a single core device.
+ */
+@property (nonatomic) NSUInteger maxConcurrentJobs;
+
+/**
+ *  The number of jobs waiting to run.
+ */
+@property (nonatomic, readonly) NSUInteger queueDepth;
+
+/**
+ *  The number of jobs that were replaced by a newer job for the same owner before they started.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfCoalescedJobs;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,205 @@
+//
+//  DBProfileBlurJobQueue.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurJobQueue.h"
+
+@interface DBProfileBlurJobToken ()
+
+@property (atomic, getter=isCancelled) BOOL cancelled;
+
+- (instancetype)initWithGeneration:(NSUInteger)generation NS_DESIGNATED_INITIALIZER;
+
+@end
+
+@implementation DBProfileBlurJobToken
+
+- (instancetype)initWithGeneration:(NSUInteger)generation {
+    self = [super init];
+    if (self) {
+        _generation = generation;
+    }
+    return self;
+}
+
+- (void)cancel {
+    self.cancelled = YES;
+}
+
+@end
+
+@interface DBProfileBlurJob : NSObject
+
+@property (nonatomic, weak) id owner;
+@property (nonatomic) DBProfileBlurJobToken *token;
+@property (nonatomic, copy) void (^block)(DBProfileBlurJobToken *token);
+
+@end
+
+@implementation DBProfileBlurJob
+@end
+
+@interface DBProfileBlurJobQueue ()
+
+@property (nonatomic) dispatch_queue_t workQueue;
+@property (nonatomic) NSMutableArray<DBProfileBlurJob *> *pendingJobs;
+@property (nonatomic) NSMapTable<id, DBProfileBlurJobToken *> *latestTokens;
+@property (nonatomic) NSHashTable *deferredOwners;
+@property (nonatomic) NSUInteger numberOfRunningWorkers;
+@property (nonatomic) NSUInteger numberOfCoalescedJobs;
+
+@end
+
+@implementation DBProfileBlurJobQueue
+
++ (instancetype)sharedQueue {
+    static DBProfileBlurJobQueue *sharedQueue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedQueue = [[self alloc] init];
+    });
+    return sharedQueue;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        self.workQueue = dispatch_queue_create("com.devonboyer.DBProfileViewController.blurJobQueue", DISPATCH_QUEUE_CONCURRENT);
+        dispatch_set_target_queue(self.workQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        self.pendingJobs = [NSMutableArray array];
+        self.latestTokens = [NSMapTable weakToStrongObjectsMapTable];
+        self.deferredOwners = [NSHashTable weakObjectsHashTable];
+        
+        // Every job already splits its stages across the cores, so a second job mostly keeps one view from waiting behind another
+        _maxConcurrentJobs = MAX(MIN([NSProcessInfo processInfo].activeProcessorCount, 2), 1);
+    }
+    return self;
+}
+
+- (NSUInteger)queueDepth {
+    @synchronized (self) {
+        return self.pendingJobs.count;
+    }
+}
+
+- (NSUInteger)maxConcurrentJobs {
+    @synchronized (self) {
+        return _maxConcurrentJobs;
+    }
+}
+
+- (void)setMaxConcurrentJobs:(NSUInteger)maxConcurrentJobs {
+    @synchronized (self) {
+        _maxConcurrentJobs = MAX(maxConcurrentJobs, 1);
+        [self startWorkersIfNeeded];
+    }
+}
+
+- (NSUInteger)numberOfCoalescedJobs {
+    @synchronized (self) {
+        return _numberOfCoalescedJobs;
+    }
+}
+
+- (DBProfileBlurJobToken *)nextTokenForOwner:(id)owner {
+    DBProfileBlurJobToken *previousToken = [self.latestTokens objectForKey:owner];
+    [previousToken cancel];
+
+    DBProfileBlurJobToken *token = [[DBProfileBlurJobToken alloc] initWithGeneration:previousToken.generation + 1];
+    [self.latestTokens setObject:token forKey:owner];
+    return token;
+}
+
+- (NSUInteger)indexOfPendingJobForOwner:(id)owner {
+    return [self.pendingJobs indexOfObjectPassingTest:^BOOL(DBProfileBlurJob *job, NSUInteger idx, BOOL *stop) {
+        return job.owner == owner;
+    }];
+}
+
+- (DBProfileBlurJobToken *)enqueueJobForOwner:(id)owner usingBlock:(void (^)(DBProfileBlurJobToken *))block {
+    NSParameterAssert(owner);
+    NSParameterAssert(block);
+
+    DBProfileBlurJob *job = [[DBProfileBlurJob alloc] init];
+    job.owner = owner;
+    job.block = block;
+
+    @synchronized (self) {
+        job.token = [self nextTokenForOwner:owner];
+
+        // A job that has not started yet is replaced in place, so the owner keeps its turn and the queue does not grow
+        NSUInteger index = [self indexOfPendingJobForOwner:owner];
+        if (index != NSNotFound) {
+            [self.pendingJobs replaceObjectAtIndex:index withObject:job];
+            _numberOfCoalescedJobs++;
+            return job.token;
+        }
+        [self.pendingJobs addObject:job];
+        [self startWorkersIfNeeded];
+    }
+    return job.token;
+}
+
+- (void)cancelJobsForOwner:(id)owner {
+    @synchronized (self) {
+        [[self.latestTokens objectForKey:owner] cancel];
+        NSUInteger index = [self indexOfPendingJobForOwner:owner];
+        if (index != NSNotFound) [self.pendingJobs removeObjectAtIndex:index];
+    }
+}
+
+- (void)setJobsDeferred:(BOOL)deferred forOwner:(id)owner {
+    NSParameterAssert(owner);
+    @synchronized (self) {
+        if (deferred) {
+            [self.deferredOwners addObject:owner];
+        }
+        else {
+            [self.deferredOwners removeObject:owner];
+        }
+    }
+}
+
+- (void)startWorkersIfNeeded {
+    // Called while synchronized on self. A worker keeps running jobs until none are pending, so there are never more workers than jobs
+    while (self.numberOfRunningWorkers < _maxConcurrentJobs && self.numberOfRunningWorkers < self.pendingJobs.count) {
+        self.numberOfRunningWorkers++;
+        dispatch_async(self.workQueue, ^{
+            [self runJobs];
+        });
+    }
+}
+
+- (DBProfileBlurJob *)dequeueNextJob {
+    @synchronized (self) {
+        // Jobs of owners that are not on screen only run once no other job is waiting
+        NSUInteger index = [self.pendingJobs indexOfObjectPassingTest:^BOOL(DBProfileBlurJob *job, NSUInteger idx, BOOL *stop) {
+            return ![self.deferredOwners containsObject:job.owner];
+        }];
+        if (index == NSNotFound && self.pendingJobs.count > 0) index = 0;
+        
+        if (index == NSNotFound) {
+            self.numberOfRunningWorkers--;
+            return nil;
+        }
+        DBProfileBlurJob *job = self.pendingJobs[index];
+        [self.pendingJobs removeObjectAtIndex:index];
+        return job;
+    }
+}
+
+- (void)runJobs {
+    DBProfileBlurJob *job;
+    while ((job = [self dequeueNextJob])) {
+        if (job.token.isCancelled) continue;
+        @autoreleasepool {
+            job.block(job.token);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,1518 @@
+//
+//  DBProfileBlurKernel.c
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#include "DBProfileBlurKernel.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DBPROFILE_BLUR_SSE2 1
+#endif
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#include <immintrin.h>
+#define DBPROFILE_BLUR_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DBPROFILE_BLUR_NEON 1
+#endif
+
+// Every instruction set must produce identical pixels, so the multiply and add used to scale sums must never be fused.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+// Kernels shared by several pixel formats are written once with the number of channels as a parameter. Every format calls its own instance
+// with a constant, so each instance is compiled for its layout the way a template would be.
+#define DBPROFILE_BLUR_SPECIALIZED static inline __attribute__((always_inline))
+
+// Sums are converted to floats, which are only exact up to 2^24.
+static const uint32_t DBProfileBlurMaximumBoxSize = 65535;
+
+typedef void (*DBProfileBlurSlideRowsFunction)(uint32_t *sums, uint8_t *out, const uint8_t *add, const uint8_t *sub, size_t count, float scale);
+typedef void (*DBProfileBlurSlideRowFunction)(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale);
+
+// MARK: - Scalar
+
+static inline uint8_t DBProfileBlurScaleSum(uint32_t sum, float scale) {
+    float value = (float)sum * scale;
+    value = value + 0.5f;
+    return (uint8_t)value;
+}
+
+static void DBProfileBlurSlideRowsScalar(uint32_t *sums, uint8_t *out, const uint8_t *add, const uint8_t *sub, size_t count, float scale) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = DBProfileBlurScaleSum(sums[i], scale);
+        sums[i] += add[i];
+        sums[i] -= sub[i];
+    }
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurSlideRowChannels(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale, const size_t channels) {
+    uint32_t sums[4] = { 0, 0, 0, 0 };
+    for (uint32_t i = 1; i <= boxSize; i++) {
+        for (size_t c = 0; c < channels; c++) sums[c] += extended[i * channels + c];
+    }
+
+    const uint8_t *add = extended + (boxSize + 1) * channels;
+    const uint8_t *sub = extended + channels;
+    for (size_t x = 0; x < width; x++) {
+        for (size_t c = 0; c < channels; c++) {
+            out[c] = DBProfileBlurScaleSum(sums[c], scale);
+            sums[c] += add[c];
+            sums[c] -= sub[c];
+        }
+        out += channels;
+        add += channels;
+        sub += channels;
+    }
+}
+
+static void DBProfileBlurSlideRowScalar(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale) {
+    DBProfileBlurSlideRowChannels(out, extended, width, boxSize, scale, 4);
+}
+
+// A single channel leaves nothing to vectorize across, so grayscale rows always slide in scalar code
+static void DBProfileBlurSlideRowGray8(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale) {
+    DBProfileBlurSlideRowChannels(out, extended, width, boxSize, scale, 1);
+}
+
+// MARK: - SSE2
+
+#if DBPROFILE_BLUR_SSE2
+
+static inline __m128i DBProfileBlurScaleSSE2(__m128i sums, __m128 scale, __m128 half) {
+    __m128 value = _mm_cvtepi32_ps(sums);
+    value = _mm_mul_ps(value, scale);
+    value = _mm_add_ps(value, half);
+    return _mm_cvttps_epi32(value);
+}
+
+static inline __m128i DBProfileBlurLoadPixelSSE2(const uint8_t *pixel) {
+    int32_t value;
+    memcpy(&value, pixel, sizeof(value));
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+}
+
+static void DBProfileBlurSlideRowsSSE2(uint32_t *sums, uint8_t *out, const uint8_t *add, const uint8_t *sub, size_t count, float scale) {
+    const __m128 scaleVector = _mm_set1_ps(scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i s0 = _mm_load_si128((const __m128i *)(sums + i));
+        __m128i s1 = _mm_load_si128((const __m128i *)(sums + i + 4));
+        __m128i s2 = _mm_load_si128((const __m128i *)(sums + i + 8));
+        __m128i s3 = _mm_load_si128((const __m128i *)(sums + i + 12));
+
+        __m128i lo = _mm_packs_epi32(DBProfileBlurScaleSSE2(s0, scaleVector, half), DBProfileBlurScaleSSE2(s1, scaleVector, half));
+        __m128i hi = _mm_packs_epi32(DBProfileBlurScaleSSE2(s2, scaleVector, half), DBProfileBlurScaleSSE2(s3, scaleVector, half));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+
+        __m128i a = _mm_loadu_si128((const __m128i *)(add + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(sub + i));
+        __m128i alo = _mm_unpacklo_epi8(a, zero), ahi = _mm_unpackhi_epi8(a, zero);
+        __m128i blo = _mm_unpacklo_epi8(b, zero), bhi = _mm_unpackhi_epi8(b, zero);
+
+        s0 = _mm_sub_epi32(_mm_add_epi32(s0, _mm_unpacklo_epi16(alo, zero)), _mm_unpacklo_epi16(blo, zero));
+        s1 = _mm_sub_epi32(_mm_add_epi32(s1, _mm_unpackhi_epi16(alo, zero)), _mm_unpackhi_epi16(blo, zero));
+        s2 = _mm_sub_epi32(_mm_add_epi32(s2, _mm_unpacklo_epi16(ahi, zero)), _mm_unpacklo_epi16(bhi, zero));
+        s3 = _mm_sub_epi32(_mm_add_epi32(s3, _mm_unpackhi_epi16(ahi, zero)), _mm_unpackhi_epi16(bhi, zero));
+
+        _mm_store_si128((__m128i *)(sums + i), s0);
+        _mm_store_si128((__m128i *)(sums + i + 4), s1);
+        _mm_store_si128((__m128i *)(sums + i + 8), s2);
+        _mm_store_si128((__m128i *)(sums + i + 12), s3);
+    }
+
+    DBProfileBlurSlideRowsScalar(sums + i, out + i, add + i, sub + i, count - i, scale);
+}
+
+static void DBProfileBlurSlideRowSSE2(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale) {
+    const __m128 scaleVector = _mm_set1_ps(scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    __m128i sums = _mm_setzero_si128();
+    for (uint32_t i = 1; i <= boxSize; i++) {
+        sums = _mm_add_epi32(sums, DBProfileBlurLoadPixelSSE2(extended + i * 4));
+    }
+
+    const uint8_t *add = extended + (boxSize + 1) * 4;
+    const uint8_t *sub = extended + 4;
+    for (size_t x = 0; x < width; x++) {
+        __m128i value = DBProfileBlurScaleSSE2(sums, scaleVector, half);
+        value = _mm_packs_epi32(value, value);
+        int32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(value, value));
+        memcpy(out, &pixel, sizeof(pixel));
+
+        sums = _mm_sub_epi32(_mm_add_epi32(sums, DBProfileBlurLoadPixelSSE2(add)), DBProfileBlurLoadPixelSSE2(sub));
+        out += 4;
+        add += 4;
+        sub += 4;
+    }
+}
+
+#endif
+
+// MARK: - AVX2
+
+#if DBPROFILE_BLUR_AVX2
+
+__attribute__((target("avx2")))
+static void DBProfileBlurSlideRowsAVX2(uint32_t *sums, uint8_t *out, const uint8_t *add, const uint8_t *sub, size_t count, float scale) {
+    const __m256 scaleVector = _mm256_set1_ps(scale);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i s[4], o[4];
+        for (size_t k = 0; k < 4; k++) {
+            s[k] = _mm256_load_si256((const __m256i *)(sums + i + k * 8));
+            __m256 value = _mm256_cvtepi32_ps(s[k]);
+            value = _mm256_mul_ps(value, scaleVector);
+            value = _mm256_add_ps(value, half);
+            o[k] = _mm256_cvttps_epi32(value);
+        }
+
+        // Packing works within 128-bit lanes, so the packed pixels must be put back in order
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(o[0], o[1]), _mm256_packs_epi32(o[2], o[3]));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_permutevar8x32_epi32(packed, order));
+
+        for (size_t k = 0; k < 4; k++) {
+            __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(add + i + k * 8)));
+            __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(sub + i + k * 8)));
+            _mm256_store_si256((__m256i *)(sums + i + k * 8), _mm256_sub_epi32(_mm256_add_epi32(s[k], a), b));
+        }
+    }
+
+    DBProfileBlurSlideRowsScalar(sums + i, out + i, add + i, sub + i, count - i, scale);
+}
+
+static bool DBProfileBlurCPUSupportsAVX2(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    bool osxsave = (ecx & (1u << 27)) != 0;
+    bool avx = (ecx & (1u << 28)) != 0;
+    if (!osxsave || !avx) return false;
+
+    // The OS must save the YMM registers on a context switch
+    uint32_t xcr0, xcr0High;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+    if ((xcr0 & 0x6) != 0x6) return false;
+
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+    return (ebx & (1u << 5)) != 0;
+}
+
+#endif
+
+// MARK: - NEON
+
+#if DBPROFILE_BLUR_NEON
+
+static inline uint32x4_t DBProfileBlurScaleNEON(uint32x4_t sums, float32x4_t scale, float32x4_t half) {
+    float32x4_t value = vcvtq_f32_u32(sums);
+    value = vmulq_f32(value, scale);
+    value = vaddq_f32(value, half);
+    return vcvtq_u32_f32(value);
+}
+
+static inline uint32x4_t DBProfileBlurLoadPixelNEON(const uint8_t *pixel) {
+    uint32_t value;
+    memcpy(&value, pixel, sizeof(value));
+    return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(value)))));
+}
+
+static void DBProfileBlurSlideRowsNEON(uint32_t *sums, uint8_t *out, const uint8_t *add, const uint8_t *sub, size_t count, float scale) {
+    const float32x4_t scaleVector = vdupq_n_f32(scale);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint32x4_t s0 = vld1q_u32(sums + i);
+        uint32x4_t s1 = vld1q_u32(sums + i + 4);
+        uint32x4_t s2 = vld1q_u32(sums + i + 8);
+        uint32x4_t s3 = vld1q_u32(sums + i + 12);
+
+        uint16x8_t lo = vcombine_u16(vmovn_u32(DBProfileBlurScaleNEON(s0, scaleVector, half)), vmovn_u32(DBProfileBlurScaleNEON(s1, scaleVector, half)));
+        uint16x8_t hi = vcombine_u16(vmovn_u32(DBProfileBlurScaleNEON(s2, scaleVector, half)), vmovn_u32(DBProfileBlurScaleNEON(s3, scaleVector, half)));
+        vst1q_u8(out + i, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+
+        uint8x16_t a = vld1q_u8(add + i);
+        uint8x16_t b = vld1q_u8(sub + i);
+        uint16x8_t alo = vmovl_u8(vget_low_u8(a)), ahi = vmovl_u8(vget_high_u8(a));
+        uint16x8_t blo = vmovl_u8(vget_low_u8(b)), bhi = vmovl_u8(vget_high_u8(b));
+
+        vst1q_u32(sums + i, vsubw_u16(vaddw_u16(s0, vget_low_u16(alo)), vget_low_u16(blo)));
+        vst1q_u32(sums + i + 4, vsubw_u16(vaddw_u16(s1, vget_high_u16(alo)), vget_high_u16(blo)));
+        vst1q_u32(sums + i + 8, vsubw_u16(vaddw_u16(s2, vget_low_u16(ahi)), vget_low_u16(bhi)));
+        vst1q_u32(sums + i + 12, vsubw_u16(vaddw_u16(s3, vget_high_u16(ahi)), vget_high_u16(bhi)));
+    }
+
+    DBProfileBlurSlideRowsScalar(sums + i, out + i, add + i, sub + i, count - i, scale);
+}
+
+static void DBProfileBlurSlideRowNEON(uint8_t *out, const uint8_t *extended, size_t width, uint32_t boxSize, float scale) {
+    const float32x4_t scaleVector = vdupq_n_f32(scale);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+
+    uint32x4_t sums = vdupq_n_u32(0);
+    for (uint32_t i = 1; i <= boxSize; i++) {
+        sums = vaddq_u32(sums, DBProfileBlurLoadPixelNEON(extended + i * 4));
+    }
+
+    const uint8_t *add = extended + (boxSize + 1) * 4;
+    const uint8_t *sub = extended + 4;
+    for (size_t x = 0; x < width; x++) {
+        uint16x4_t value = vmovn_u32(DBProfileBlurScaleNEON(sums, scaleVector, half));
+        uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(value, value))), 0);
+        memcpy(out, &pixel, sizeof(pixel));
+
+        sums = vsubq_u32(vaddq_u32(sums, DBProfileBlurLoadPixelNEON(add)), DBProfileBlurLoadPixelNEON(sub));
+        out += 4;
+        add += 4;
+        sub += 4;
+    }
+}
+
+#endif
+
+// MARK: - Dispatch
+
+static DBProfileBlurInstructionSet DBProfileBlurSelectedInstructionSet = DBProfileBlurInstructionSetScalar;
+static pthread_once_t DBProfileBlurSelectedInstructionSetOnce = PTHREAD_ONCE_INIT;
+
+bool DBProfileBlurInstructionSetIsSupported(DBProfileBlurInstructionSet instructionSet) {
+    switch (instructionSet) {
+        case DBProfileBlurInstructionSetScalar:
+            return true;
+        case DBProfileBlurInstructionSetSSE2:
+#if DBPROFILE_BLUR_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case DBProfileBlurInstructionSetAVX2:
+#if DBPROFILE_BLUR_AVX2 && DBPROFILE_BLUR_SSE2
+            return DBProfileBlurCPUSupportsAVX2();
+#else
+            return false;
+#endif
+        case DBProfileBlurInstructionSetNEON:
+#if DBPROFILE_BLUR_NEON
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+static void DBProfileBlurSelectInstructionSet(void) {
+    DBProfileBlurInstructionSet preferred[] = { DBProfileBlurInstructionSetAVX2, DBProfileBlurInstructionSetNEON, DBProfileBlurInstructionSetSSE2 };
+    for (size_t i = 0; i < sizeof(preferred) / sizeof(preferred[0]); i++) {
+        if (DBProfileBlurInstructionSetIsSupported(preferred[i])) {
+            DBProfileBlurSelectedInstructionSet = preferred[i];
+            return;
+        }
+    }
+}
+
+DBProfileBlurInstructionSet DBProfileBlurGetInstructionSet(void) {
+    // Resolved once, so strips blurred on worker threads never read it while it is written
+    pthread_once(&DBProfileBlurSelectedInstructionSetOnce, DBProfileBlurSelectInstructionSet);
+    return DBProfileBlurSelectedInstructionSet;
+}
+
+static DBProfileBlurSlideRowsFunction DBProfileBlurSlideRowsForInstructionSet(DBProfileBlurInstructionSet instructionSet) {
+    switch (instructionSet) {
+#if DBPROFILE_BLUR_AVX2 && DBPROFILE_BLUR_SSE2
+        case DBProfileBlurInstructionSetAVX2:
+            return DBProfileBlurSlideRowsAVX2;
+#endif
+#if DBPROFILE_BLUR_SSE2
+        case DBProfileBlurInstructionSetSSE2:
+            return DBProfileBlurSlideRowsSSE2;
+#endif
+#if DBPROFILE_BLUR_NEON
+        case DBProfileBlurInstructionSetNEON:
+            return DBProfileBlurSlideRowsNEON;
+#endif
+        default:
+            return DBProfileBlurSlideRowsScalar;
+    }
+}
+
+static DBProfileBlurSlideRowFunction DBProfileBlurSlideRowForInstructionSet(DBProfileBlurInstructionSet instructionSet, DBProfileBlurPixelFormat format) {
+    if (format == DBProfileBlurPixelFormatGray8) return DBProfileBlurSlideRowGray8;
+    switch (instructionSet) {
+#if DBPROFILE_BLUR_SSE2
+        // A single pixel fits in a 128-bit register, so AVX2 has nothing to add to the horizontal pass
+        case DBProfileBlurInstructionSetAVX2:
+        case DBProfileBlurInstructionSetSSE2:
+            return DBProfileBlurSlideRowSSE2;
+#endif
+#if DBPROFILE_BLUR_NEON
+        case DBProfileBlurInstructionSetNEON:
+            return DBProfileBlurSlideRowNEON;
+#endif
+        default:
+            return DBProfileBlurSlideRowScalar;
+    }
+}
+
+// MARK: - Convolution
+
+size_t DBProfileBlurPixelFormatBytesPerPixel(DBProfileBlurPixelFormat format) {
+    switch (format) {
+        case DBProfileBlurPixelFormatGray8:
+            return 1;
+        case DBProfileBlurPixelFormat32:
+            return 4;
+    }
+    return 4;
+}
+
+static uint32_t DBProfileBlurNormalizedBoxSize(uint32_t boxSize) {
+    if (boxSize > DBProfileBlurMaximumBoxSize) boxSize = DBProfileBlurMaximumBoxSize;
+    return boxSize | 1;
+}
+
+size_t DBProfileBlurTempBufferSize(size_t width, uint32_t boxSize) {
+    boxSize = DBProfileBlurNormalizedBoxSize(boxSize);
+    size_t sumsSize = width * 4 * sizeof(uint32_t);
+    size_t extendedRowSize = (width + boxSize + 1) * 4;
+    return 31 + sumsSize + extendedRowSize;
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurExtendRowChannels(uint8_t *extended, const uint8_t *row, size_t width, uint32_t padding, const size_t channels) {
+    uint8_t *cursor = extended;
+    for (uint32_t i = 0; i < padding; i++, cursor += channels) memcpy(cursor, row, channels);
+    memcpy(cursor, row, width * channels);
+    cursor += width * channels;
+    for (uint32_t i = 0; i < padding; i++, cursor += channels) memcpy(cursor, row + (width - 1) * channels, channels);
+}
+
+static void DBProfileBlurExtendRow(uint8_t *extended, const uint8_t *row, size_t width, uint32_t padding, DBProfileBlurPixelFormat format) {
+    if (format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurExtendRowChannels(extended, row, width, padding, 1);
+    }
+    else {
+        DBProfileBlurExtendRowChannels(extended, row, width, padding, 4);
+    }
+}
+
+static void DBProfileBlurBoxConvolveRowsWithInstructionSet(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize,
+                                                           size_t firstRow, size_t numberOfRows, DBProfileBlurInstructionSet instructionSet);
+
+void DBProfileBlurBoxConvolve(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize) {
+    DBProfileBlurBoxConvolveRows(src, dst, temp, boxSize, 0, src->height);
+}
+
+bool DBProfileBlurBoxConvolveWithInstructionSet(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize, DBProfileBlurInstructionSet instructionSet) {
+    if (!DBProfileBlurInstructionSetIsSupported(instructionSet)) return false;
+    DBProfileBlurBoxConvolveRowsWithInstructionSet(src, dst, temp, boxSize, 0, src->height, instructionSet);
+    return true;
+}
+
+void DBProfileBlurBoxConvolveRows(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize, size_t firstRow, size_t numberOfRows) {
+    DBProfileBlurBoxConvolveRowsWithInstructionSet(src, dst, temp, boxSize, firstRow, numberOfRows, DBProfileBlurGetInstructionSet());
+}
+
+static void DBProfileBlurBoxConvolveRowsWithInstructionSet(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize,
+                                                           size_t firstRow, size_t numberOfRows, DBProfileBlurInstructionSet instructionSet) {
+    const size_t width = src->width;
+    const size_t height = src->height;
+    if (width == 0 || height == 0 || firstRow >= height) return;
+    if (numberOfRows > height - firstRow) numberOfRows = height - firstRow;
+    const size_t lastRow = firstRow + numberOfRows;
+
+    boxSize = DBProfileBlurNormalizedBoxSize(boxSize);
+    const size_t radius = boxSize / 2;
+    const size_t count = width * DBProfileBlurPixelFormatBytesPerPixel(src->format);
+    const float scale = 1.0f / (float)boxSize;
+
+    // The vertical pass only adds bytes of whole rows, so every format shares it
+    DBProfileBlurSlideRowsFunction slideRows = DBProfileBlurSlideRowsForInstructionSet(instructionSet);
+    DBProfileBlurSlideRowFunction slideRow = DBProfileBlurSlideRowForInstructionSet(instructionSet, src->format);
+
+    uint32_t *sums = (uint32_t *)(((uintptr_t)temp + 31) & ~(uintptr_t)31);
+    uint8_t *extended = (uint8_t *)(sums + count);
+
+    // Vertical pass from src into dst, sliding a column sum for every channel down the rows. The sums start from the clamped halo rows
+    // around the first row, which are the exact integer sums the pass would have reached from the top of the image
+    memset(sums, 0, count * sizeof(uint32_t));
+    for (size_t k = 0; k <= 2 * radius; k++) {
+        size_t y = firstRow + k;
+        y = y > radius ? y - radius : 0;
+        if (y >= height) y = height - 1;
+        const uint8_t *row = src->data + y * src->rowBytes;
+        for (size_t i = 0; i < count; i++) sums[i] += row[i];
+    }
+
+    for (size_t y = firstRow; y < lastRow; y++) {
+        size_t addY = y + radius + 1;
+        if (addY >= height) addY = height - 1;
+        size_t subY = (y > radius) ? y - radius : 0;
+        slideRows(sums, dst->data + y * dst->rowBytes, src->data + addY * src->rowBytes, src->data + subY * src->rowBytes, count, scale);
+    }
+
+    // Horizontal pass over dst in place, reading from an edge-extended copy of each row
+    const uint32_t padding = (uint32_t)radius + 1;
+    for (size_t y = firstRow; y < lastRow; y++) {
+        uint8_t *row = dst->data + y * dst->rowBytes;
+        DBProfileBlurExtendRow(extended, row, width, padding, src->format);
+        slideRow(row, extended, width, boxSize, scale);
+    }
+}
+
+const DBProfileBlurBuffer *DBProfileBlurBoxIterations(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, uint32_t boxSize, size_t iterations) {
+    const DBProfileBlurBuffer *src = buffer;
+    const DBProfileBlurBuffer *dst = scratch;
+    for (size_t i = 0; i < iterations; i++) {
+        DBProfileBlurBoxConvolve(src, dst, temp, boxSize);
+        const DBProfileBlurBuffer *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return src;
+}
+
+void DBProfileBlurGaussianBoxSizes(double sigma, size_t count, uint32_t *sizes) {
+    if (count == 0) return;
+
+    double variance = sigma * sigma;
+    double idealWidth = sqrt(12.0 * variance / count + 1.0);
+    int lowerWidth = (int)floor(idealWidth);
+    if (lowerWidth % 2 == 0) lowerWidth--;
+    if (lowerWidth < 1) lowerWidth = 1;
+    int upperWidth = lowerWidth + 2;
+
+    double idealCount = (12.0 * variance - count * lowerWidth * lowerWidth - 4.0 * count * lowerWidth - 3.0 * count) / (-4.0 * lowerWidth - 4.0);
+    long lowerCount = lround(idealCount);
+    if (lowerCount < 0) lowerCount = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sizes[i] = (uint32_t)((long)i < lowerCount ? lowerWidth : upperWidth);
+    }
+}
+
+const DBProfileBlurBuffer *DBProfileBlurGaussian(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double sigma) {
+    uint32_t sizes[3];
+    DBProfileBlurGaussianBoxSizes(sigma, 3, sizes);
+
+    const DBProfileBlurBuffer *src = buffer;
+    const DBProfileBlurBuffer *dst = scratch;
+    for (size_t i = 0; i < 3; i++) {
+        DBProfileBlurBoxConvolve(src, dst, temp, sizes[i]);
+        const DBProfileBlurBuffer *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return src;
+}
+
+// MARK: - Progressive
+
+double DBProfileBlurBoxVariance(uint32_t boxSize, size_t iterations) {
+    double size = DBProfileBlurNormalizedBoxSize(boxSize);
+    return iterations * (size * size - 1.0) / 12.0;
+}
+
+uint32_t DBProfileBlurIncrementalBoxSize(double variance, double targetVariance) {
+    // Half the variance of the smallest box that changes anything
+    double difference = targetVariance - variance;
+    if (difference < DBProfileBlurBoxVariance(3, 1) / 2.0) return 1;
+
+    double idealSize = sqrt(12.0 * difference + 1.0);
+    long halfSize = lround((idealSize - 1.0) / 2.0);
+    if (halfSize < 1) halfSize = 1;
+    if (halfSize > DBProfileBlurMaximumBoxSize / 2) halfSize = DBProfileBlurMaximumBoxSize / 2;
+    return (uint32_t)(2 * halfSize + 1);
+}
+
+// MARK: - Stack Blur
+
+// Sums of a stack are converted to floats, which are only exact up to 2^24, so the weights of a stack may not add up to more than 2^16
+static const uint32_t DBProfileBlurMaximumStackBlurRadius = 254;
+
+// Columns are blurred in blocks of this many pixels, so every row of a block fills whole cache lines
+#define DBProfileBlurColumnBlockWidth 16
+
+static uint32_t DBProfileBlurNormalizedStackBlurRadius(uint32_t radius) {
+    return radius > DBProfileBlurMaximumStackBlurRadius ? DBProfileBlurMaximumStackBlurRadius : radius;
+}
+
+size_t DBProfileBlurStackBlurTempBufferSize(size_t width, size_t height, uint32_t radius) {
+    radius = DBProfileBlurNormalizedStackBlurRadius(radius);
+    size_t extendedRowSize = (width + 2 * (radius + 2)) * 4;
+    size_t extendedBlockSize = (height + 2 * (radius + 2)) * DBProfileBlurColumnBlockWidth * 4;
+    return (extendedRowSize > extendedBlockSize ? extendedRowSize : extendedBlockSize) + 3 * DBProfileBlurColumnBlockWidth * 4 * sizeof(uint32_t);
+}
+
+double DBProfileBlurStackBlurVariance(uint32_t radius) {
+    // The weights of a stack form a triangle of half-width radius + 1
+    double r = DBProfileBlurNormalizedStackBlurRadius(radius);
+    return r * (r + 2.0) / 6.0;
+}
+
+uint32_t DBProfileBlurStackBlurRadius(double variance) {
+    if (variance <= 0.0) return 0;
+    long radius = lround(sqrt(1.0 + 6.0 * variance) - 1.0);
+    if (radius < 0) radius = 0;
+    return DBProfileBlurNormalizedStackBlurRadius((uint32_t)radius);
+}
+
+// Slides a stack along `count` samples of `lanes` interleaved values each. The samples must be extended by radius + 2 copies of the
+// edge samples on either side, and sample i of the result is written to `out + i * outStride`.
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurStackSlide(uint8_t *out, size_t outStride, const uint8_t *extended, uint32_t *sums, size_t count, uint32_t radius, const size_t lanes) {
+    uint32_t *sum = sums, *sumIn = sums + lanes, *sumOut = sums + 2 * lanes;
+    const float scale = 1.0f / (float)((radius + 1) * (radius + 1));
+    const uint8_t *center = extended + (radius + 2) * lanes;
+
+    for (size_t c = 0; c < lanes; c++) {
+        sum[c] = sumIn[c] = sumOut[c] = 0;
+        for (long k = -(long)radius; k <= 0; k++) {
+            uint32_t value = center[k * (long)lanes + (long)c];
+            sum[c] += value * (uint32_t)(radius + 1 + k);
+            sumOut[c] += value;
+        }
+        for (long k = 1; k <= (long)radius + 1; k++) {
+            uint32_t value = center[k * (long)lanes + (long)c];
+            sum[c] += value * (uint32_t)(radius + 1 - k);
+            sumIn[c] += value;
+        }
+    }
+
+    // Moving the stack one sample along adds the samples entering its right half and removes those leaving its left half
+    const uint8_t *leaving = center - radius * lanes;
+    for (size_t x = 0; x < count; x++) {
+        const uint8_t *sample = center + x * lanes;
+        const uint8_t *left = leaving + x * lanes;
+        for (size_t c = 0; c < lanes; c++) {
+            out[x * outStride + c] = DBProfileBlurScaleSum(sum[c], scale);
+            sum[c] += sumIn[c] - sumOut[c];
+            sumOut[c] += sample[lanes + c] - left[c];
+            sumIn[c] += sample[(radius + 2) * lanes + c] - sample[lanes + c];
+        }
+    }
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurStackBlurChannels(const DBProfileBlurBuffer *buffer, void *temp, uint32_t radius, const size_t channels) {
+    const size_t width = buffer->width;
+    const size_t height = buffer->height;
+    const uint32_t padding = radius + 2;
+    uint32_t *sums = temp;
+    uint8_t *extended = (uint8_t *)(sums + 3 * DBProfileBlurColumnBlockWidth * 4);
+
+    // Horizontal pass, each row in place from an edge-extended copy of itself
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *row = buffer->data + y * buffer->rowBytes;
+        DBProfileBlurExtendRowChannels(extended, row, width, padding, channels);
+        DBProfileBlurStackSlide(row, channels, extended, sums, width, radius, channels);
+    }
+
+    // Vertical pass over blocks of columns gathered into edge-extended rows, which slides every column of the block together
+    for (size_t x = 0; x < width; x += DBProfileBlurColumnBlockWidth) {
+        const size_t blockWidth = width - x < DBProfileBlurColumnBlockWidth ? width - x : DBProfileBlurColumnBlockWidth;
+        const size_t lanes = blockWidth * channels;
+        for (size_t y = 0; y < height; y++) {
+            memcpy(extended + (y + padding) * lanes, buffer->data + y * buffer->rowBytes + x * channels, lanes);
+        }
+        for (uint32_t i = 0; i < padding; i++) {
+            memcpy(extended + i * lanes, extended + padding * lanes, lanes);
+            memcpy(extended + (height + padding + i) * lanes, extended + (height + padding - 1) * lanes, lanes);
+        }
+        DBProfileBlurStackSlide(buffer->data + x * channels, buffer->rowBytes, extended, sums, height, radius, lanes);
+    }
+}
+
+void DBProfileBlurStackBlur(const DBProfileBlurBuffer *buffer, void *temp, uint32_t radius) {
+    radius = DBProfileBlurNormalizedStackBlurRadius(radius);
+    if (buffer->width == 0 || buffer->height == 0 || radius == 0) return;
+
+    if (buffer->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurStackBlurChannels(buffer, temp, radius, 1);
+    }
+    else {
+        DBProfileBlurStackBlurChannels(buffer, temp, radius, 4);
+    }
+}
+
+// MARK: - Recursive Gaussian
+
+// Below this standard deviation the recursive filter no longer approximates a Gaussian, and the blur is too small to see anyway
+static const double DBProfileBlurMinimumRecursiveGaussianSigma = 0.5;
+
+// The edge response of the filter decays below anything visible well within this many samples
+#define DBProfileBlurRecursiveGaussianMaximumSettlingLength 2048
+
+typedef struct {
+    float b;
+    float a1, a2, a3;
+    float boundary[3][3];
+} DBProfileBlurRecursiveGaussianCoefficients;
+
+// Triggs and Sdika, "Boundary conditions for Young-van Vliet recursive filtering", 2006. Past the last sample the forward pass only
+// settles towards the edge value, so the state the backward pass starts from is a linear function of how far the last three forward
+// states are from it. Column j of the matrix is found by letting a unit offset of state j settle through both passes.
+static void DBProfileBlurRecursiveGaussianBoundary(DBProfileBlurRecursiveGaussianCoefficients *k, double sigma) {
+    size_t length = (size_t)(10.0 * sigma) + 32;
+    if (length > DBProfileBlurRecursiveGaussianMaximumSettlingLength) length = DBProfileBlurRecursiveGaussianMaximumSettlingLength;
+    double forward[DBProfileBlurRecursiveGaussianMaximumSettlingLength];
+
+    for (size_t j = 0; j < 3; j++) {
+        double w1 = j == 0, w2 = j == 1, w3 = j == 2;
+        for (size_t i = 0; i < length; i++) {
+            forward[i] = k->a1 * w1 + k->a2 * w2 + k->a3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = forward[i];
+        }
+
+        w1 = w2 = w3 = 0.0;
+        for (size_t i = length; i-- > 0;) {
+            double w = k->b * forward[i] + k->a1 * w1 + k->a2 * w2 + k->a3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+            if (i < 3) k->boundary[i][j] = (float)w;
+        }
+    }
+}
+
+// Young and van Vliet, "Recursive implementation of the Gaussian filter", 1995
+static DBProfileBlurRecursiveGaussianCoefficients DBProfileBlurRecursiveGaussianCoefficientsForSigma(double sigma) {
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q, q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    DBProfileBlurRecursiveGaussianCoefficients coefficients;
+    coefficients.a1 = (float)(b1 / b0);
+    coefficients.a2 = (float)(b2 / b0);
+    coefficients.a3 = (float)(b3 / b0);
+    coefficients.b = 1.0f - (coefficients.a1 + coefficients.a2 + coefficients.a3);
+    DBProfileBlurRecursiveGaussianBoundary(&coefficients, sigma);
+    return coefficients;
+}
+
+size_t DBProfileBlurRecursiveGaussianTempBufferSize(size_t width, size_t height) {
+    size_t longest = width > height * DBProfileBlurColumnBlockWidth ? width : height * DBProfileBlurColumnBlockWidth;
+    return longest * 4 * sizeof(float);
+}
+
+// Filters `count` samples of `lanes` interleaved values forwards and then backwards, as if the edge samples were repeated forever.
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurRecursiveGaussianFilter(float *samples, size_t count, const DBProfileBlurRecursiveGaussianCoefficients *coefficients, const size_t lanes) {
+    const DBProfileBlurRecursiveGaussianCoefficients k = *coefficients;
+    float w1[DBProfileBlurColumnBlockWidth * 4], w2[DBProfileBlurColumnBlockWidth * 4], w3[DBProfileBlurColumnBlockWidth * 4];
+    float edge[DBProfileBlurColumnBlockWidth * 4];
+
+    // The forward pass starts settled on the first sample
+    for (size_t c = 0; c < lanes; c++) {
+        w1[c] = w2[c] = w3[c] = samples[c];
+        edge[c] = samples[(count - 1) * lanes + c];
+    }
+    for (size_t i = 0; i < count; i++) {
+        float *sample = samples + i * lanes;
+        for (size_t c = 0; c < lanes; c++) {
+            float w = k.b * sample[c] + (k.a1 * w1[c] + k.a2 * w2[c] + k.a3 * w3[c]);
+            sample[c] = w;
+            w3[c] = w2[c];
+            w2[c] = w1[c];
+            w1[c] = w;
+        }
+    }
+
+    // The backward pass starts from the states it would have reached coming back from beyond the last sample
+    const float *last = samples + (count - 1) * lanes;
+    const float *secondToLast = count > 1 ? last - lanes : last;
+    const float *thirdToLast = count > 2 ? secondToLast - lanes : secondToLast;
+    for (size_t c = 0; c < lanes; c++) {
+        float d1 = last[c] - edge[c], d2 = secondToLast[c] - edge[c], d3 = thirdToLast[c] - edge[c];
+        w1[c] = edge[c] + (k.boundary[0][0] * d1 + k.boundary[0][1] * d2 + k.boundary[0][2] * d3);
+        w2[c] = edge[c] + (k.boundary[1][0] * d1 + k.boundary[1][1] * d2 + k.boundary[1][2] * d3);
+        w3[c] = edge[c] + (k.boundary[2][0] * d1 + k.boundary[2][1] * d2 + k.boundary[2][2] * d3);
+    }
+    for (size_t i = count; i-- > 0;) {
+        float *sample = samples + i * lanes;
+        for (size_t c = 0; c < lanes; c++) {
+            float w = k.b * sample[c] + (k.a1 * w1[c] + k.a2 * w2[c] + k.a3 * w3[c]);
+            sample[c] = w;
+            w3[c] = w2[c];
+            w2[c] = w1[c];
+            w1[c] = w;
+        }
+    }
+}
+
+static inline uint8_t DBProfileBlurClampSample(float value) {
+    value = value + 0.5f;
+    if (value <= 0.0f) return 0;
+    if (value >= 255.0f) return 255;
+    return (uint8_t)value;
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurRecursiveGaussianChannels(const DBProfileBlurBuffer *buffer, float *samples, const DBProfileBlurRecursiveGaussianCoefficients *k, const size_t channels) {
+    const size_t width = buffer->width;
+    const size_t height = buffer->height;
+
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *row = buffer->data + y * buffer->rowBytes;
+        for (size_t i = 0; i < width * channels; i++) samples[i] = row[i];
+        DBProfileBlurRecursiveGaussianFilter(samples, width, k, channels);
+        for (size_t i = 0; i < width * channels; i++) row[i] = DBProfileBlurClampSample(samples[i]);
+    }
+
+    for (size_t x = 0; x < width; x += DBProfileBlurColumnBlockWidth) {
+        const size_t blockWidth = width - x < DBProfileBlurColumnBlockWidth ? width - x : DBProfileBlurColumnBlockWidth;
+        const size_t lanes = blockWidth * channels;
+        for (size_t y = 0; y < height; y++) {
+            const uint8_t *pixels = buffer->data + y * buffer->rowBytes + x * channels;
+            for (size_t i = 0; i < lanes; i++) samples[y * lanes + i] = pixels[i];
+        }
+        DBProfileBlurRecursiveGaussianFilter(samples, height, k, lanes);
+        for (size_t y = 0; y < height; y++) {
+            uint8_t *pixels = buffer->data + y * buffer->rowBytes + x * channels;
+            for (size_t i = 0; i < lanes; i++) pixels[i] = DBProfileBlurClampSample(samples[y * lanes + i]);
+        }
+    }
+}
+
+void DBProfileBlurRecursiveGaussian(const DBProfileBlurBuffer *buffer, void *temp, double sigma) {
+    if (buffer->width == 0 || buffer->height == 0 || sigma < DBProfileBlurMinimumRecursiveGaussianSigma) return;
+
+    DBProfileBlurRecursiveGaussianCoefficients k = DBProfileBlurRecursiveGaussianCoefficientsForSigma(sigma);
+    if (buffer->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurRecursiveGaussianChannels(buffer, temp, &k, 1);
+    }
+    else {
+        DBProfileBlurRecursiveGaussianChannels(buffer, temp, &k, 4);
+    }
+}
+
+// MARK: - Dual Kawase
+
+// Each pass halves the buffer, and passes stop before a level would be narrower than this
+static const size_t DBProfileBlurDualKawaseMinimumSize = 4;
+
+#define DBProfileBlurDualKawaseMaximumPasses 8
+
+// The downsample adds 3/4 of a pixel squared of the level it reads, and the upsample 1/3 for its taps plus 3/16 for the bilinear filtering
+// of a pixel of the level it reads, which is four pixels squared of the level it writes
+static const double DBProfileBlurDualKawasePassVariance = 3.0 / 4.0 + 4.0 * (1.0 / 3.0 + 3.0 / 16.0);
+
+double DBProfileBlurDualKawaseVariance(size_t passes) {
+    double variance = 0.0;
+    for (size_t level = 0; level < passes; level++) {
+        variance += DBProfileBlurDualKawasePassVariance * (double)(1u << (2 * level));
+    }
+    return variance;
+}
+
+size_t DBProfileBlurDualKawasePasses(double variance, size_t width, size_t height) {
+    size_t passes = 0;
+    while (passes < DBProfileBlurDualKawaseMaximumPasses
+           && (width >> (passes + 1)) >= DBProfileBlurDualKawaseMinimumSize
+           && (height >> (passes + 1)) >= DBProfileBlurDualKawaseMinimumSize
+           && DBProfileBlurDualKawaseVariance(passes + 1) <= variance) {
+        passes++;
+    }
+    return passes;
+}
+
+size_t DBProfileBlurDualKawaseTempBufferSize(size_t width, size_t height) {
+    // Whatever the passes cannot reach is blurred at the smallest level, which is never larger than the buffer
+    return DBProfileBlurRecursiveGaussianTempBufferSize(width, height);
+}
+
+static inline size_t DBProfileBlurClampIndex(long index, size_t count) {
+    if (index < 0) return 0;
+    if ((size_t)index >= count) return count - 1;
+    return (size_t)index;
+}
+
+// Averages the 4x4 pixels around the corner shared by each 2x2 block, counting the inner 2x2 pixels five times.
+// This is the centre sample and four diagonal samples, half a destination pixel away, of the bilinear filtering of the original shader.
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurDualKawaseDownsampleChannels(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, const size_t channels) {
+    for (size_t y = 0; y < dst->height; y++) {
+        const uint8_t *rows[4];
+        for (long i = 0; i < 4; i++) rows[i] = src->data + DBProfileBlurClampIndex(2 * (long)y - 1 + i, src->height) * src->rowBytes;
+        uint8_t *out = dst->data + y * dst->rowBytes;
+
+        for (size_t x = 0; x < dst->width; x++) {
+            size_t columns[4];
+            for (long i = 0; i < 4; i++) columns[i] = DBProfileBlurClampIndex(2 * (long)x - 1 + i, src->width) * channels;
+
+            for (size_t c = 0; c < channels; c++) {
+                uint32_t sum = 0;
+                for (size_t i = 0; i < 4; i++) {
+                    for (size_t j = 0; j < 4; j++) sum += rows[i][columns[j] + c];
+                }
+                uint32_t inner = rows[1][columns[1] + c] + rows[1][columns[2] + c] + rows[2][columns[1] + c] + rows[2][columns[2] + c];
+                out[x * channels + c] = (uint8_t)((sum + 4 * inner + 16) >> 5);
+            }
+        }
+    }
+}
+
+// The bilinear weights, adding up to 4, that a tap `position` quarter pixels right of the centre of source pixel 1 gives to source pixels 0 to 3
+static inline void DBProfileBlurDualKawaseTapWeights(long position, uint32_t weights[4]) {
+    long index = 1 + (position >= 0 ? position / 4 : -((3 - position) / 4));
+    uint32_t fraction = (uint32_t)(position - 4 * (index - 1));
+    memset(weights, 0, 4 * sizeof(uint32_t));
+    weights[index] += 4 - fraction;
+    weights[index + 1] += fraction;
+}
+
+// Four samples one source pixel away along the axes and four diagonal samples half a source pixel away with twice the weight, each
+// filtered bilinearly from the source as the original shader does. Together they weigh a 4x4 block of source pixels with weights that
+// only depend on whether the destination row and column are even or odd, and add up to 192.
+typedef struct {
+    uint32_t weights[2][2][4][4];
+} DBProfileBlurDualKawaseKernels;
+
+static DBProfileBlurDualKawaseKernels DBProfileBlurDualKawaseUpsampleKernels(void) {
+    static const long offsets[8][3] = {
+        { -4, 0, 1 }, { 4, 0, 1 }, { 0, -4, 1 }, { 0, 4, 1 },
+        { -2, -2, 2 }, { 2, -2, 2 }, { -2, 2, 2 }, { 2, 2, 2 },
+    };
+
+    DBProfileBlurDualKawaseKernels kernels;
+    memset(&kernels, 0, sizeof(kernels));
+    for (size_t rowParity = 0; rowParity < 2; rowParity++) {
+        for (size_t columnParity = 0; columnParity < 2; columnParity++) {
+            for (size_t s = 0; s < 8; s++) {
+                // The centre of an even destination pixel lies 3 quarter pixels right of source pixel 1, and an odd one 1 quarter pixel right
+                uint32_t rowWeights[4], columnWeights[4];
+                DBProfileBlurDualKawaseTapWeights((rowParity ? 1 : 3) + offsets[s][1], rowWeights);
+                DBProfileBlurDualKawaseTapWeights((columnParity ? 1 : 3) + offsets[s][0], columnWeights);
+                for (size_t i = 0; i < 4; i++) {
+                    for (size_t j = 0; j < 4; j++) kernels.weights[rowParity][columnParity][i][j] += (uint32_t)offsets[s][2] * rowWeights[i] * columnWeights[j];
+                }
+            }
+        }
+    }
+    return kernels;
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurDualKawaseUpsampleChannels(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, const size_t channels) {
+    const DBProfileBlurDualKawaseKernels kernels = DBProfileBlurDualKawaseUpsampleKernels();
+
+    for (size_t y = 0; y < dst->height; y++) {
+        // Destination pixel y reads source rows (y - 1) / 2 - 1 to (y - 1) / 2 + 2
+        long firstRow = ((long)y - 1 >= 0 ? ((long)y - 1) / 2 : -1) - 1;
+        const uint8_t *rows[4];
+        for (long i = 0; i < 4; i++) rows[i] = src->data + DBProfileBlurClampIndex(firstRow + i, src->height) * src->rowBytes;
+        uint8_t *out = dst->data + y * dst->rowBytes;
+
+        for (size_t x = 0; x < dst->width; x++) {
+            const uint32_t (*kernel)[4] = kernels.weights[y & 1][x & 1];
+            long firstColumn = ((long)x - 1 >= 0 ? ((long)x - 1) / 2 : -1) - 1;
+
+            // Only the first and last few columns need clamping
+            size_t columns[4];
+            if (firstColumn >= 0 && (size_t)firstColumn + 3 < src->width) {
+                for (size_t j = 0; j < 4; j++) columns[j] = ((size_t)firstColumn + j) * channels;
+            }
+            else {
+                for (long j = 0; j < 4; j++) columns[j] = DBProfileBlurClampIndex(firstColumn + j, src->width) * channels;
+            }
+
+            // Channels are innermost so the sums of a pixel can be kept in one vector
+            uint32_t sums[4] = { 96, 96, 96, 96 };
+            for (size_t i = 0; i < 4; i++) {
+                for (size_t j = 0; j < 4; j++) {
+                    const uint8_t *pixel = rows[i] + columns[j];
+                    for (size_t c = 0; c < channels; c++) sums[c] += kernel[i][j] * pixel[c];
+                }
+            }
+            for (size_t c = 0; c < channels; c++) out[x * channels + c] = (uint8_t)(sums[c] / 192);
+        }
+    }
+}
+
+void DBProfileBlurDualKawase(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double variance) {
+    if (buffer->width == 0 || buffer->height == 0 || variance <= 0.0) return;
+
+    // Every level is packed into the scratch buffer, which all of them fill to less than a third
+    const size_t bytesPerPixel = DBProfileBlurPixelFormatBytesPerPixel(buffer->format);
+    const size_t passes = DBProfileBlurDualKawasePasses(variance, buffer->width, buffer->height);
+    DBProfileBlurBuffer levels[DBProfileBlurDualKawaseMaximumPasses + 1];
+    levels[0] = *buffer;
+    uint8_t *cursor = scratch->data;
+    for (size_t level = 1; level <= passes; level++) {
+        DBProfileBlurBuffer *previous = &levels[level - 1];
+        DBProfileBlurBuffer downsampled = { cursor, previous->width / 2, previous->height / 2, previous->width / 2 * bytesPerPixel, buffer->format };
+        levels[level] = downsampled;
+        cursor += downsampled.rowBytes * downsampled.height;
+
+        if (buffer->format == DBProfileBlurPixelFormatGray8) {
+            DBProfileBlurDualKawaseDownsampleChannels(previous, &levels[level], 1);
+        }
+        else {
+            DBProfileBlurDualKawaseDownsampleChannels(previous, &levels[level], 4);
+        }
+    }
+
+    // Passes only reach a few variances, the rest is blurred at the smallest level where it is cheapest
+    double residualVariance = (variance - DBProfileBlurDualKawaseVariance(passes)) / (double)(1u << (2 * passes));
+    DBProfileBlurRecursiveGaussian(&levels[passes], temp, sqrt(residualVariance > 0.0 ? residualVariance : 0.0));
+
+    for (size_t level = passes; level > 0; level--) {
+        if (buffer->format == DBProfileBlurPixelFormatGray8) {
+            DBProfileBlurDualKawaseUpsampleChannels(&levels[level], &levels[level - 1], 1);
+        }
+        else {
+            DBProfileBlurDualKawaseUpsampleChannels(&levels[level], &levels[level - 1], 4);
+        }
+    }
+}
+
+// MARK: - Algorithms
+
+size_t DBProfileBlurAlgorithmTempBufferSize(DBProfileBlurAlgorithm algorithm, size_t width, size_t height, double variance) {
+    switch (algorithm) {
+        case DBProfileBlurAlgorithmBox: {
+            uint32_t sizes[3];
+            DBProfileBlurGaussianBoxSizes(sqrt(variance > 0.0 ? variance : 0.0), 3, sizes);
+            return DBProfileBlurTempBufferSize(width, sizes[2]);
+        }
+        case DBProfileBlurAlgorithmStack:
+            return DBProfileBlurStackBlurTempBufferSize(width, height, DBProfileBlurStackBlurRadius(variance));
+        case DBProfileBlurAlgorithmDualKawase:
+            return DBProfileBlurDualKawaseTempBufferSize(width, height);
+        case DBProfileBlurAlgorithmRecursiveGaussian:
+            return DBProfileBlurRecursiveGaussianTempBufferSize(width, height);
+    }
+    return 0;
+}
+
+// Stack blurs wider than the largest stack are split into several passes of equal radius, whose variances add
+static size_t DBProfileBlurStackBlurPasses(double variance) {
+    double maximumVariance = DBProfileBlurStackBlurVariance(DBProfileBlurMaximumStackBlurRadius);
+    return variance > maximumVariance ? (size_t)ceil(variance / maximumVariance) : 1;
+}
+
+double DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithm algorithm, double variance) {
+    if (variance <= 0.0) return 0.0;
+
+    switch (algorithm) {
+        case DBProfileBlurAlgorithmBox: {
+            if (variance < DBProfileBlurBoxVariance(3, 1) / 2.0) return 0.0;
+            uint32_t sizes[3];
+            DBProfileBlurGaussianBoxSizes(sqrt(variance), 3, sizes);
+            return DBProfileBlurBoxVariance(sizes[0], 1) + DBProfileBlurBoxVariance(sizes[1], 1) + DBProfileBlurBoxVariance(sizes[2], 1);
+        }
+        case DBProfileBlurAlgorithmStack: {
+            size_t passes = DBProfileBlurStackBlurPasses(variance);
+            uint32_t radius = DBProfileBlurStackBlurRadius(variance / passes);
+            return radius > 0 ? passes * DBProfileBlurStackBlurVariance(radius) : 0.0;
+        }
+        case DBProfileBlurAlgorithmDualKawase:
+        case DBProfileBlurAlgorithmRecursiveGaussian:
+            return variance >= DBProfileBlurMinimumRecursiveGaussianSigma * DBProfileBlurMinimumRecursiveGaussianSigma ? variance : 0.0;
+    }
+    return 0.0;
+}
+
+const DBProfileBlurBuffer *DBProfileBlurWithAlgorithm(DBProfileBlurAlgorithm algorithm, const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double variance) {
+    if (DBProfileBlurAlgorithmVariance(algorithm, variance) <= 0.0) return buffer;
+
+    switch (algorithm) {
+        case DBProfileBlurAlgorithmBox:
+            return DBProfileBlurGaussian(buffer, scratch, temp, sqrt(variance));
+        case DBProfileBlurAlgorithmStack: {
+            size_t passes = DBProfileBlurStackBlurPasses(variance);
+            uint32_t radius = DBProfileBlurStackBlurRadius(variance / passes);
+            for (size_t i = 0; i < passes; i++) DBProfileBlurStackBlur(buffer, temp, radius);
+            return buffer;
+        }
+        case DBProfileBlurAlgorithmDualKawase:
+            DBProfileBlurDualKawase(buffer, scratch, temp, variance);
+            return buffer;
+        case DBProfileBlurAlgorithmRecursiveGaussian:
+            DBProfileBlurRecursiveGaussian(buffer, temp, sqrt(variance));
+            return buffer;
+    }
+    return buffer;
+}
+
+// MARK: - Summed-Area Table
+
+size_t DBProfileBlurSummedAreaTableSize(size_t width, size_t height) {
+    return (width + 1) * (height + 1) * 4 * sizeof(uint32_t);
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurSummedAreaTableBuildChannels(const DBProfileBlurBuffer *src, uint32_t *table, const size_t channels) {
+    const size_t width = src->width;
+    const size_t height = src->height;
+    const size_t stride = (width + 1) * channels;
+
+    memset(table, 0, stride * sizeof(uint32_t));
+    for (size_t y = 1; y <= height; y++) {
+        const uint8_t *row = src->data + (y - 1) * src->rowBytes;
+        const uint32_t *above = table + (y - 1) * stride;
+        uint32_t *entry = table + y * stride;
+        uint32_t rowSums[4] = { 0, 0, 0, 0 };
+
+        memset(entry, 0, channels * sizeof(uint32_t));
+        for (size_t x = 1; x <= width; x++) {
+            for (size_t c = 0; c < channels; c++) {
+                rowSums[c] += row[(x - 1) * channels + c];
+                entry[x * channels + c] = above[x * channels + c] + rowSums[c];
+            }
+        }
+    }
+}
+
+void DBProfileBlurSummedAreaTableBuild(const DBProfileBlurBuffer *src, uint32_t *table) {
+    if (src->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurSummedAreaTableBuildChannels(src, table, 1);
+    }
+    else {
+        DBProfileBlurSummedAreaTableBuildChannels(src, table, 4);
+    }
+}
+
+void DBProfileBlurSummedAreaTableBoxSizes(double variance, size_t count, uint32_t *sizes) {
+    if (count == 0) return;
+
+    // Spread the boxes evenly around a base size so their average is smoother than a single box
+    double meanSquaredFactor = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double factor = (i + 1.0) / (count + 1.0) * 2.0;
+        meanSquaredFactor += factor * factor / count;
+    }
+    double baseSize = sqrt((12.0 * variance + 1.0) / meanSquaredFactor);
+
+    for (size_t i = 0; i < count; i++) {
+        double factor = (i + 1.0) / (count + 1.0) * 2.0;
+        long halfSize = lround((baseSize * factor - 1.0) / 2.0);
+        if (halfSize < 0) halfSize = 0;
+        if (halfSize > DBProfileBlurMaximumBoxSize / 2) halfSize = DBProfileBlurMaximumBoxSize / 2;
+        sizes[i] = (uint32_t)(2 * halfSize + 1);
+    }
+}
+
+size_t DBProfileBlurSummedAreaTableTempBufferSize(size_t width) {
+    return width * 4 * sizeof(float);
+}
+
+void DBProfileBlurSummedAreaTableBoxes(const uint32_t *table, const DBProfileBlurBuffer *dst, void *temp, const uint32_t *sizes, size_t count) {
+    DBProfileBlurSummedAreaTableBoxesRows(table, dst, temp, sizes, count, 0, dst->height);
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurSummedAreaTableBoxesRowsChannels(const uint32_t *table, const DBProfileBlurBuffer *dst, void *temp, const uint32_t *sizes, size_t count, size_t firstRow, size_t numberOfRows, const size_t channels) {
+    const size_t width = dst->width;
+    const size_t height = dst->height;
+    const size_t stride = (width + 1) * channels;
+    const float countScale = 1.0f / (float)count;
+    float *accumulated = temp;
+
+    for (size_t y = firstRow; y < firstRow + numberOfRows; y++) {
+        memset(accumulated, 0, width * channels * sizeof(float));
+
+        for (size_t i = 0; i < count; i++) {
+            const size_t radius = DBProfileBlurNormalizedBoxSize(sizes[i]) / 2;
+            const size_t y0 = y > radius ? y - radius : 0;
+            const size_t y1 = y + radius + 1 < height ? y + radius + 1 : height;
+            const uint32_t *top = table + y0 * stride;
+            const uint32_t *bottom = table + y1 * stride;
+
+            // Boxes only need clipping near the left and right edges, the rest of the row shares a single area
+            size_t interiorStart = radius < width ? radius : width;
+            size_t interiorEnd = width > radius + 1 ? width - radius - 1 : 0;
+            if (interiorEnd < interiorStart) interiorEnd = interiorStart;
+
+            for (size_t x = 0; x < width; x++) {
+                if (x == interiorStart && interiorStart < interiorEnd) {
+                    const float scale = 1.0f / (float)((2 * radius + 1) * (y1 - y0));
+                    const size_t offset = (2 * radius + 1) * channels;
+                    const uint32_t *topLeft = top + (interiorStart - radius) * channels;
+                    const uint32_t *bottomLeft = bottom + (interiorStart - radius) * channels;
+                    float *out = accumulated + interiorStart * channels;
+                    const size_t n = (interiorEnd - interiorStart) * channels;
+                    for (size_t j = 0; j < n; j++) {
+                        uint32_t sum = bottomLeft[j + offset] - bottomLeft[j] - topLeft[j + offset] + topLeft[j];
+                        out[j] += (float)sum * scale;
+                    }
+                    x = interiorEnd - 1;
+                    continue;
+                }
+
+                const size_t x0 = x > radius ? x - radius : 0;
+                const size_t x1 = x + radius + 1 < width ? x + radius + 1 : width;
+                const float scale = 1.0f / (float)((x1 - x0) * (y1 - y0));
+                for (size_t c = 0; c < channels; c++) {
+                    uint32_t sum = bottom[x1 * channels + c] - bottom[x0 * channels + c] - top[x1 * channels + c] + top[x0 * channels + c];
+                    accumulated[x * channels + c] += (float)sum * scale;
+                }
+            }
+        }
+
+        uint8_t *out = dst->data + y * dst->rowBytes;
+        for (size_t j = 0; j < width * channels; j++) {
+            out[j] = (uint8_t)(accumulated[j] * countScale + 0.5f);
+        }
+    }
+}
+
+void DBProfileBlurSummedAreaTableBoxesRows(const uint32_t *table, const DBProfileBlurBuffer *dst, void *temp, const uint32_t *sizes, size_t count, size_t firstRow, size_t numberOfRows) {
+    const size_t height = dst->height;
+    if (dst->width == 0 || height == 0 || count == 0 || firstRow >= height) return;
+    if (numberOfRows > height - firstRow) numberOfRows = height - firstRow;
+
+    if (dst->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurSummedAreaTableBoxesRowsChannels(table, dst, temp, sizes, count, firstRow, numberOfRows, 1);
+    }
+    else {
+        DBProfileBlurSummedAreaTableBoxesRowsChannels(table, dst, temp, sizes, count, firstRow, numberOfRows, 4);
+    }
+}
+
+// MARK: - Pyramid
+
+size_t DBProfileBlurPyramidLevelForVariance(double variance, size_t maximumLevel) {
+    if (maximumLevel > DBProfileBlurPyramidMaximumLevel) maximumLevel = DBProfileBlurPyramidMaximumLevel;
+
+    // A level is safe once the standard deviation spans at least two of its pixels
+    double sigma = sqrt(variance > 0.0 ? variance : 0.0);
+    size_t level = 0;
+    while (level < maximumLevel && (double)(2u << level) * 2.0 <= sigma) level++;
+    return level;
+}
+
+double DBProfileBlurDownsampleVariance(size_t level) {
+    if (level == 0) return 0.0;
+
+    // Two taps one pixel of the previous level apart
+    double spacing = (double)(1u << (level - 1));
+    return (2.0 * 2.0 - 1.0) / 12.0 * spacing * spacing;
+}
+
+DBPROFILE_BLUR_SPECIALIZED void DBProfileBlurDownsampleChannels(const DBProfileBlurBuffer *src, DBProfileBlurBuffer *dst, const size_t channels) {
+    const uint8_t *data = src->data;
+    const size_t width = src->width;
+    const size_t height = src->height;
+    const size_t rowBytes = src->rowBytes;
+    const size_t downsampledWidth = width > 1 ? width / 2 : width;
+    const size_t downsampledHeight = height > 1 ? height / 2 : height;
+    const size_t downsampledRowBytes = downsampledWidth * channels;
+
+    // Every write lands at or before the first pixel still to be read, so the buffer can be reduced in place
+    if (width > 1 && height > 1) {
+        for (size_t y = 0; y < downsampledHeight; y++) {
+            const uint8_t *top = data + 2 * y * rowBytes;
+            const uint8_t *bottom = top + rowBytes;
+            uint8_t *out = dst->data + y * downsampledRowBytes;
+
+            size_t x = 0;
+            if (channels == 4) {
+                // Two 32-bit pixels are averaged at once, with the even and the odd channels spread over 16-bit lanes of one word each
+                const uint64_t mask = 0x00FF00FF00FF00FFull;
+                for (; x < downsampledWidth; x++) {
+                    uint64_t topPixels, bottomPixels;
+                    memcpy(&topPixels, top + 8 * x, sizeof(topPixels));
+                    memcpy(&bottomPixels, bottom + 8 * x, sizeof(bottomPixels));
+                    uint64_t even = (topPixels & mask) + (bottomPixels & mask);
+                    uint64_t odd = ((topPixels >> 8) & mask) + ((bottomPixels >> 8) & mask);
+                    even = (((even + (even >> 32)) + 0x00020002u) >> 2) & 0x00FF00FFu;
+                    odd = (((odd + (odd >> 32)) + 0x00020002u) >> 2) & 0x00FF00FFu;
+                    uint32_t pixel = (uint32_t)(even | (odd << 8));
+                    memcpy(out + 4 * x, &pixel, sizeof(pixel));
+                }
+            }
+            for (; x < downsampledWidth; x++) {
+                for (size_t c = 0; c < channels; c++) {
+                    out[x * channels + c] = (uint8_t)((top[2 * x * channels + c] + top[(2 * x + 1) * channels + c] + bottom[2 * x * channels + c] + bottom[(2 * x + 1) * channels + c] + 2) >> 2);
+                }
+            }
+        }
+    }
+    else {
+        // A single row or column is only halved along the other dimension
+        for (size_t y = 0; y < downsampledHeight; y++) {
+            const uint8_t *top = data + (height > 1 ? 2 * y : y) * rowBytes;
+            const uint8_t *bottom = height > 1 ? top + rowBytes : top;
+            uint8_t *out = dst->data + y * downsampledRowBytes;
+
+            for (size_t x = 0; x < downsampledWidth; x++) {
+                const size_t left = (width > 1 ? 2 * x : x) * channels;
+                const size_t right = width > 1 ? left + channels : left;
+                for (size_t c = 0; c < channels; c++) {
+                    out[x * channels + c] = (uint8_t)((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2);
+                }
+            }
+        }
+    }
+
+    dst->width = downsampledWidth;
+    dst->height = downsampledHeight;
+    dst->rowBytes = downsampledRowBytes;
+    dst->format = src->format;
+}
+
+void DBProfileBlurDownsample(DBProfileBlurBuffer *buffer) {
+    if (buffer->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurDownsampleChannels(buffer, buffer, 1);
+    }
+    else {
+        DBProfileBlurDownsampleChannels(buffer, buffer, 4);
+    }
+}
+
+void DBProfileBlurDownsampleBuffer(const DBProfileBlurBuffer *src, DBProfileBlurBuffer *dst, size_t levels) {
+    // Only the first level reads the source, the smaller levels are reduced in place
+    if (src->format == DBProfileBlurPixelFormatGray8) {
+        DBProfileBlurDownsampleChannels(src, dst, 1);
+    }
+    else {
+        DBProfileBlurDownsampleChannels(src, dst, 4);
+    }
+    for (size_t level = 1; level < levels; level++) DBProfileBlurDownsample(dst);
+}
+
+void DBProfileBlurDownsampledSize(size_t *width, size_t *height, size_t levels) {
+    for (size_t level = 0; level < levels; level++) {
+        if (*width > 1) *width /= 2;
+        if (*height > 1) *height /= 2;
+    }
+}
+
+// MARK: - Streaming
+
+static size_t DBProfileBlurStreamHalo(const uint32_t *boxSizes, size_t count) {
+    size_t halo = 0;
+    for (size_t i = 0; i < count; i++) halo += DBProfileBlurNormalizedBoxSize(boxSizes[i]) / 2;
+    return halo;
+}
+
+static size_t DBProfileBlurStreamTempBufferSize(size_t width, const uint32_t *boxSizes, size_t count) {
+    size_t tempBufferSize = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t size = DBProfileBlurTempBufferSize(width, boxSizes[i]);
+        if (size > tempBufferSize) tempBufferSize = size;
+    }
+    return tempBufferSize;
+}
+
+static size_t DBProfileBlurStreamDownsampleSize(size_t width, DBProfileBlurPixelFormat format, size_t levels) {
+    // One row of the result is shrunk at a time from 2^levels rows of the source, the first level of which is written without padding
+    if (levels == 0) return 0;
+    size_t levelWidth = width > 1 ? width / 2 : width;
+    return (levelWidth * DBProfileBlurPixelFormatBytesPerPixel(format)) << (levels - 1);
+}
+
+static size_t DBProfileBlurStreamRoundUp(size_t size) {
+    return (size + 31) & ~(size_t)31;
+}
+
+size_t DBProfileBlurStreamWindowSize(size_t width, size_t height, DBProfileBlurPixelFormat format, const uint32_t *boxSizes, size_t count, size_t levels, size_t stripHeight) {
+    size_t levelWidth = width, levelHeight = height;
+    DBProfileBlurDownsampledSize(&levelWidth, &levelHeight, levels);
+    size_t downsampleSize = DBProfileBlurStreamDownsampleSize(width, format, levels);
+    if (count == 0) return downsampleSize;
+
+    size_t windowRows = stripHeight + 2 * DBProfileBlurStreamHalo(boxSizes, count);
+    if (windowRows > levelHeight) windowRows = levelHeight;
+    size_t bufferSize = DBProfileBlurStreamRoundUp(windowRows * levelWidth * DBProfileBlurPixelFormatBytesPerPixel(format));
+    return 2 * bufferSize + DBProfileBlurStreamTempBufferSize(levelWidth, boxSizes, count) + downsampleSize;
+}
+
+size_t DBProfileBlurStreamStripHeight(size_t width, size_t height, DBProfileBlurPixelFormat format, const uint32_t *boxSizes, size_t count, size_t levels, size_t budget) {
+    size_t levelWidth = width, levelHeight = height;
+    DBProfileBlurDownsampledSize(&levelWidth, &levelHeight, levels);
+    if (count == 0 || levelHeight == 0) return levelHeight;
+
+    // Two buffers of window rows ping-pong between the boxes, next to the temporary buffer of the largest box
+    size_t halo = DBProfileBlurStreamHalo(boxSizes, count);
+    size_t fixedSize = DBProfileBlurStreamTempBufferSize(levelWidth, boxSizes, count) + DBProfileBlurStreamDownsampleSize(width, format, levels) + 64;
+    size_t rowSize = 2 * levelWidth * DBProfileBlurPixelFormatBytesPerPixel(format);
+    size_t windowRows = budget > fixedSize ? (budget - fixedSize) / rowSize : 0;
+    size_t stripHeight = windowRows > 2 * halo ? windowRows - 2 * halo : 0;
+
+    // Strips shorter than the halo would spend most of their time on the rows they share with their neighbours, so the budget gives way
+    if (stripHeight < halo) stripHeight = halo;
+    if (stripHeight < 1) stripHeight = 1;
+    if (stripHeight > levelHeight) stripHeight = levelHeight;
+    return stripHeight;
+}
+
+static void DBProfileBlurStreamDownsampleRow(const DBProfileBlurBuffer *src, uint8_t *out, uint8_t *scratch, size_t levels, size_t y) {
+    // Every row of a level only depends on the two rows of the level above it, so 2^levels rows of the source shrink to exactly one row
+    DBProfileBlurBuffer rows = *src;
+    rows.data = src->data + (y << levels) * src->rowBytes;
+    rows.height = (size_t)1 << levels;
+    DBProfileBlurBuffer row = {scratch, 0, 0, 0, src->format};
+    DBProfileBlurDownsampleBuffer(&rows, &row, levels);
+    memcpy(out, row.data, row.rowBytes);
+}
+
+void DBProfileBlurStreamBoxes(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *window, const uint32_t *boxSizes, size_t count, size_t levels, size_t stripHeight) {
+    DBProfileBlurStreamBoxesRows(src, dst, window, boxSizes, count, levels, stripHeight, 0, dst->height);
+}
+
+void DBProfileBlurStreamBoxesRows(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *window, const uint32_t *boxSizes, size_t count, size_t levels,
+                                  size_t stripHeight, size_t firstRow, size_t numberOfRows) {
+    const size_t width = dst->width;
+    const size_t height = dst->height;
+    if (width == 0 || height == 0 || firstRow >= height) return;
+    if (numberOfRows > height - firstRow) numberOfRows = height - firstRow;
+    if (stripHeight == 0) stripHeight = 1;
+    const size_t lastRow = firstRow + numberOfRows;
+    const size_t rowLength = width * DBProfileBlurPixelFormatBytesPerPixel(dst->format);
+
+    // Without boxes every row of the result is shrunk or copied straight into dst
+    uint8_t *bytes = window;
+    if (count == 0) {
+        for (size_t y = firstRow; y < lastRow; y++) {
+            if (levels > 0) {
+                DBProfileBlurStreamDownsampleRow(src, dst->data + y * dst->rowBytes, bytes, levels, y);
+            }
+            else {
+                memcpy(dst->data + y * dst->rowBytes, src->data + y * src->rowBytes, rowLength);
+            }
+        }
+        return;
+    }
+
+    const size_t halo = DBProfileBlurStreamHalo(boxSizes, count);
+    size_t windowRows = stripHeight + 2 * halo;
+    if (windowRows > height) windowRows = height;
+    const size_t bufferSize = DBProfileBlurStreamRoundUp(windowRows * rowLength);
+    DBProfileBlurBuffer buffers[2] = {
+        {bytes, width, 0, rowLength, dst->format},
+        {bytes + bufferSize, width, 0, rowLength, dst->format},
+    };
+    uint8_t *temp = bytes + 2 * bufferSize;
+    uint8_t *downsampleScratch = temp + DBProfileBlurStreamTempBufferSize(width, boxSizes, count);
+
+    for (size_t first = firstRow; first < lastRow; first += stripHeight) {
+        const size_t rows = (lastRow - first < stripHeight) ? lastRow - first : stripHeight;
+        const size_t top = first > halo ? first - halo : 0;
+        const size_t bottom = (first + rows + halo < height) ? first + rows + halo : height;
+        buffers[0].height = buffers[1].height = bottom - top;
+
+        // The window starts out as the rows of the strip and its halo, read in place or shrunk row by row into the first buffer
+        DBProfileBlurBuffer input = *src;
+        size_t next = 1;
+        if (levels > 0) {
+            for (size_t y = top; y < bottom; y++) {
+                DBProfileBlurStreamDownsampleRow(src, buffers[0].data + (y - top) * rowLength, downsampleScratch, levels, y);
+            }
+            input = buffers[0];
+        }
+        else {
+            input.data = src->data + top * src->rowBytes;
+            input.height = bottom - top;
+            next = 0;
+        }
+
+        // Each box writes the rows the remaining boxes read, so the strip is exact even though the window clamps at its own edges. Where
+        // the window ends at the edge of the image, it clamps exactly like a convolution of the whole image
+        const DBProfileBlurBuffer *current = &input;
+        size_t remainingHalo = halo;
+        for (size_t i = 0; i < count; i++) {
+            remainingHalo -= DBProfileBlurNormalizedBoxSize(boxSizes[i]) / 2;
+            if (i + 1 == count) {
+                DBProfileBlurBuffer output = *dst;
+                output.data = dst->data + top * dst->rowBytes;
+                output.height = bottom - top;
+                DBProfileBlurBoxConvolveRows(current, &output, temp, boxSizes[i], first - top, rows);
+                break;
+            }
+
+            size_t writeTop = first > top + remainingHalo ? first - remainingHalo : top;
+            size_t writeBottom = (first + rows + remainingHalo < bottom) ? first + rows + remainingHalo : bottom;
+            DBProfileBlurBoxConvolveRows(current, &buffers[next], temp, boxSizes[i], writeTop - top, writeBottom - writeTop);
+            current = &buffers[next];
+            next ^= 1;
+        }
+    }
+}
+
+// MARK: - Digest
+
+static inline uint64_t DBProfileBlurDigestMix(uint64_t digest, uint64_t value) {
+    value *= 0x9E3779B97F4A7C15ull;
+    value ^= value >> 32;
+    return (digest ^ value) * 0xBF58476D1CE4E5B9ull;
+}
+
+static uint64_t DBProfileBlurDigestRow(uint64_t digest, const uint8_t *row, size_t rowLength) {
+    size_t x = 0;
+    for (; x + 8 <= rowLength; x += 8) {
+        uint64_t value;
+        memcpy(&value, row + x, sizeof(value));
+        digest = DBProfileBlurDigestMix(digest, value);
+    }
+    if (x < rowLength) {
+        uint64_t value = 0;
+        memcpy(&value, row + x, rowLength - x);
+        digest = DBProfileBlurDigestMix(digest, value);
+    }
+    return digest;
+}
+
+static inline uint64_t DBProfileBlurDigestAvalanche(uint64_t digest) {
+    digest ^= digest >> 31;
+    digest *= 0x94D049BB133111EBull;
+    digest ^= digest >> 29;
+    return digest;
+}
+
+uint64_t DBProfileBlurBufferDigest(const DBProfileBlurBuffer *buffer) {
+    const size_t rowLength = buffer->width * DBProfileBlurPixelFormatBytesPerPixel(buffer->format);
+    uint64_t digest = DBProfileBlurDigestMix(DBProfileBlurDigestMix(0, buffer->width), buffer->height);
+
+    // Only formats other than the original one are mixed in, which keeps the digests of 32-bit pixels stable
+    if (buffer->format != DBProfileBlurPixelFormat32) digest = DBProfileBlurDigestMix(digest, buffer->format);
+
+    for (size_t y = 0; y < buffer->height; y++) {
+        digest = DBProfileBlurDigestRow(digest, buffer->data + y * buffer->rowBytes, rowLength);
+    }
+
+    // A final avalanche so that nearby digests do not differ in only a few bits
+    return DBProfileBlurDigestAvalanche(digest);
+}
+
+void DBProfileBlurRowDigests(const DBProfileBlurBuffer *buffer, uint64_t *digests) {
+    const size_t rowLength = buffer->width * DBProfileBlurPixelFormatBytesPerPixel(buffer->format);
+    const uint64_t seed = DBProfileBlurDigestMix(DBProfileBlurDigestMix(0, buffer->width), buffer->format);
+    for (size_t y = 0; y < buffer->height; y++) {
+        digests[y] = DBProfileBlurDigestAvalanche(DBProfileBlurDigestRow(seed, buffer->data + y * buffer->rowBytes, rowLength));
+    }
+}
+
+bool DBProfileBlurChangedRows(const uint64_t *digests, const uint64_t *previousDigests, size_t count, size_t *firstRow, size_t *numberOfRows) {
+    size_t first = 0;
+    while (first < count && digests[first] == previousDigests[first]) first++;
+    if (first == count) {
+        *firstRow = 0;
+        *numberOfRows = 0;
+        return false;
+    }
+
+    size_t last = count;
+    while (last > first && digests[last - 1] == previousDigests[last - 1]) last--;
+    *firstRow = first;
+    *numberOfRows = last - first;
+    return true;
+}
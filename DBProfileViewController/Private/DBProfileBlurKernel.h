@@ -0,0 +1,388 @@
+//
+//  DBProfileBlurKernel.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DBProfileBlurAlgorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The pixel layouts the kernels are specialized for.
+ */
+typedef enum {
+    /**
+     *  8-bit, 4 channel pixels. The kernels convolve every channel independently, so the pixels may be RGBA, BGRA or ARGB, premultiplied or not,
+     *  or RGBX and XRGB without alpha.
+     */
+    DBProfileBlurPixelFormat32,
+    /**
+     *  8-bit grayscale pixels without alpha.
+     */
+    DBProfileBlurPixelFormatGray8,
+} DBProfileBlurPixelFormat;
+
+/**
+ *  A view onto a buffer of 8-bit pixels.
+ *
+ *  Buffers that leave out the format hold `DBProfileBlurPixelFormat32` pixels. Buffers passed to the same kernel must have the same format.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t width;
+    size_t height;
+    size_t rowBytes;
+    DBProfileBlurPixelFormat format;
+} DBProfileBlurBuffer;
+
+/**
+ *  The number of bytes of one pixel of the specified format.
+ */
+extern size_t DBProfileBlurPixelFormatBytesPerPixel(DBProfileBlurPixelFormat format);
+
+/**
+ *  The instruction sets that the blur kernels can be dispatched to.
+ */
+typedef enum {
+    DBProfileBlurInstructionSetScalar,
+    DBProfileBlurInstructionSetSSE2,
+    DBProfileBlurInstructionSetAVX2,
+    DBProfileBlurInstructionSetNEON,
+} DBProfileBlurInstructionSet;
+
+/**
+ *  Whether the specified instruction set is available to the kernels on the current machine.
+ */
+extern bool DBProfileBlurInstructionSetIsSupported(DBProfileBlurInstructionSet instructionSet);
+
+/**
+ *  The instruction set used by the kernels, which is the best instruction set supported by the current machine.
+ *
+ *  It is resolved once, the first time it is needed, and never changes afterwards, so kernels running on many threads always agree on it.
+ */
+extern DBProfileBlurInstructionSet DBProfileBlurGetInstructionSet(void);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurBoxConvolve` for the specified width and box size, in any pixel format.
+ */
+extern size_t DBProfileBlurTempBufferSize(size_t width, uint32_t boxSize);
+
+/**
+ *  Convolves `src` with a box kernel of `boxSize` x `boxSize` pixels and writes the result into `dst`.
+ *
+ *  Pixels outside of the buffer are treated as copies of the nearest edge pixel. The box size is rounded up to the next odd number.
+ *
+ *  @param src The source buffer.
+ *  @param dst The destination buffer. Must have the same dimensions as `src` and must not alias it.
+ *  @param temp A buffer of at least `DBProfileBlurTempBufferSize` bytes.
+ *  @param boxSize The width and height of the box kernel.
+ */
+extern void DBProfileBlurBoxConvolve(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize);
+
+/**
+ *  Performs `DBProfileBlurBoxConvolve` with the specified instruction set rather than `DBProfileBlurGetInstructionSet`. This is intended for tests
+ *  and benchmarks that compare instruction sets, and does not affect any other call.
+ *
+ *  @return false if the instruction set is not supported, in which case `dst` is left unchanged.
+ */
+extern bool DBProfileBlurBoxConvolveWithInstructionSet(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize, DBProfileBlurInstructionSet instructionSet);
+
+/**
+ *  Writes `numberOfRows` rows of the result of `DBProfileBlurBoxConvolve`, starting at `firstRow`, into `dst`.
+ *
+ *  Only the rows of `src` within half a box of the strip are read, and the rows are bit-identical to those of a full convolution. Disjoint strips
+ *  of the same `dst` can be convolved concurrently, each with its own `temp` buffer.
+ */
+extern void DBProfileBlurBoxConvolveRows(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *temp, uint32_t boxSize, size_t firstRow, size_t numberOfRows);
+
+/**
+ *  Applies `iterations` box convolutions, ping-ponging between `buffer` and `scratch`.
+ *
+ *  @return The buffer holding the result, either `buffer` or `scratch`.
+ */
+extern const DBProfileBlurBuffer *DBProfileBlurBoxIterations(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, uint32_t boxSize, size_t iterations);
+
+/**
+ *  Calculates the box sizes whose successive convolution best approximates a Gaussian with the specified standard deviation.
+ *
+ *  @param sigma The standard deviation of the Gaussian.
+ *  @param count The number of boxes to calculate.
+ *  @param sizes On return, `count` odd box sizes.
+ */
+extern void DBProfileBlurGaussianBoxSizes(double sigma, size_t count, uint32_t *sizes);
+
+/**
+ *  Approximates a Gaussian blur with the specified standard deviation using three box convolutions.
+ *
+ *  @param temp A buffer of at least `DBProfileBlurTempBufferSize` bytes for the largest box returned by `DBProfileBlurGaussianBoxSizes`.
+ *
+ *  @return The buffer holding the result, either `buffer` or `scratch`.
+ */
+extern const DBProfileBlurBuffer *DBProfileBlurGaussian(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double sigma);
+
+/**
+ *  The variance of `iterations` successive box convolutions of `boxSize` pixels. The box size is rounded up to the next odd number.
+ *
+ *  Variances of successive convolutions add, which allows a blur to be built on top of an already blurred buffer.
+ */
+extern double DBProfileBlurBoxVariance(uint32_t boxSize, size_t iterations);
+
+/**
+ *  Calculates the odd box size whose variance best brings a buffer blurred with `variance` up to `targetVariance`.
+ *
+ *  @return 1 if the difference is too small to be worth a convolution.
+ */
+extern uint32_t DBProfileBlurIncrementalBoxSize(double variance, double targetVariance);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurStackBlur` for the specified dimensions and radius, in any pixel format.
+ */
+extern size_t DBProfileBlurStackBlurTempBufferSize(size_t width, size_t height, uint32_t radius);
+
+/**
+ *  The variance of a stack blur with the specified radius. Radii are clamped to 254, which keeps the sums of a stack exact.
+ */
+extern double DBProfileBlurStackBlurVariance(uint32_t radius);
+
+/**
+ *  The radius of the stack blur whose variance best matches `variance`, up to 254.
+ */
+extern uint32_t DBProfileBlurStackBlurRadius(double variance);
+
+/**
+ *  Blurs `buffer` in place with a stack blur, whose triangular kernel is the convolution of two boxes of `radius + 1` pixels.
+ *
+ *  Each pass slides a stack of sums along the rows and then the columns, so the cost per pixel does not depend on the radius.
+ *  Pixels outside of the buffer are treated as copies of the nearest edge pixel.
+ *
+ *  @param temp A buffer of at least `DBProfileBlurStackBlurTempBufferSize` bytes.
+ */
+extern void DBProfileBlurStackBlur(const DBProfileBlurBuffer *buffer, void *temp, uint32_t radius);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurRecursiveGaussian` for the specified dimensions, in any pixel format.
+ */
+extern size_t DBProfileBlurRecursiveGaussianTempBufferSize(size_t width, size_t height);
+
+/**
+ *  Blurs `buffer` in place with the recursive Gaussian filter of Young and van Vliet, which runs a third order filter forwards and
+ *  backwards along the rows and then the columns.
+ *
+ *  The cost per pixel does not depend on `sigma`. Standard deviations below 0.5 pixels leave the buffer unchanged.
+ *
+ *  @param temp A buffer of at least `DBProfileBlurRecursiveGaussianTempBufferSize` bytes.
+ */
+extern void DBProfileBlurRecursiveGaussian(const DBProfileBlurBuffer *buffer, void *temp, double sigma);
+
+/**
+ *  The variance, in pixels of the buffer, of the specified number of dual Kawase passes.
+ */
+extern double DBProfileBlurDualKawaseVariance(size_t passes);
+
+/**
+ *  The number of dual Kawase passes that `DBProfileBlurDualKawase` runs for the specified variance and dimensions.
+ */
+extern size_t DBProfileBlurDualKawasePasses(double variance, size_t width, size_t height);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurDualKawase` for the specified dimensions, in any pixel format.
+ */
+extern size_t DBProfileBlurDualKawaseTempBufferSize(size_t width, size_t height);
+
+/**
+ *  Blurs `buffer` in place with the dual Kawase filter, which halves the buffer once per pass with a 5-tap filter and then doubles it
+ *  back with an 8-tap filter.
+ *
+ *  Passes run while their variance fits `variance`, and the variance they leave is blurred with `DBProfileBlurRecursiveGaussian` at the
+ *  smallest level. Most of the work is done on buffers a quarter of the size of the one before them.
+ *
+ *  @param scratch A buffer of the same size as `buffer`, which holds the smaller levels.
+ *  @param temp A buffer of at least `DBProfileBlurDualKawaseTempBufferSize` bytes.
+ */
+extern void DBProfileBlurDualKawase(const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double variance);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurWithAlgorithm` for the specified algorithm, dimensions and variance.
+ */
+extern size_t DBProfileBlurAlgorithmTempBufferSize(DBProfileBlurAlgorithm algorithm, size_t width, size_t height, double variance);
+
+/**
+ *  The variance that `DBProfileBlurWithAlgorithm` applies when asked for `variance`, after rounding to the kernels the algorithm has.
+ *
+ *  Variances of successive blurs add, so the difference can be made up by the next blur of a progressive chain. A variance of 0 means the
+ *  buffer would be left unchanged.
+ */
+extern double DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithm algorithm, double variance);
+
+/**
+ *  Blurs `buffer` with the specified algorithm so it approximates a Gaussian blur with the specified variance, in pixels of the buffer.
+ *
+ *  @param scratch A buffer with the same dimensions as `buffer`, which box blurs may leave the result in.
+ *  @param temp A buffer of at least `DBProfileBlurAlgorithmTempBufferSize` bytes.
+ *
+ *  @return The buffer holding the result, either `buffer` or `scratch`.
+ */
+extern const DBProfileBlurBuffer *DBProfileBlurWithAlgorithm(DBProfileBlurAlgorithm algorithm, const DBProfileBlurBuffer *buffer, const DBProfileBlurBuffer *scratch, void *temp, double variance);
+
+/**
+ *  The size in bytes of the summed-area table built by `DBProfileBlurSummedAreaTableBuild` for the specified dimensions, in any pixel format.
+ */
+extern size_t DBProfileBlurSummedAreaTableSize(size_t width, size_t height);
+
+/**
+ *  Builds the summed-area table of `src`. Entry (x, y) holds, for every channel, the sum of all pixels above and to the left of (x, y).
+ *
+ *  The table has `(width + 1) * (height + 1)` entries of one `uint32_t` sum per channel. Sums wrap around, which keeps the differences used by
+ *  `DBProfileBlurSummedAreaTableBoxes` exact for any box of fewer than 2^24 pixels.
+ *
+ *  @param table A buffer of at least `DBProfileBlurSummedAreaTableSize` bytes.
+ */
+extern void DBProfileBlurSummedAreaTableBuild(const DBProfileBlurBuffer *src, uint32_t *table);
+
+/**
+ *  Calculates `count` odd box sizes whose averaged boxes have the specified variance along each axis.
+ */
+extern void DBProfileBlurSummedAreaTableBoxSizes(double variance, size_t count, uint32_t *sizes);
+
+/**
+ *  The size in bytes of the temporary buffer required by `DBProfileBlurSummedAreaTableBoxes` for the specified width, in any pixel format.
+ */
+extern size_t DBProfileBlurSummedAreaTableTempBufferSize(size_t width);
+
+/**
+ *  Writes the average of `count` box blurs of the image summarized by `table` into `dst`, at a constant cost per pixel for any box size.
+ *
+ *  Boxes are clipped to the image and normalized by the number of pixels they cover.
+ *
+ *  @param table A summed-area table built for an image with the same dimensions and format as `dst`.
+ *  @param dst The destination buffer.
+ *  @param temp A buffer of at least `DBProfileBlurSummedAreaTableTempBufferSize` bytes.
+ *  @param sizes `count` odd box sizes.
+ */
+extern void DBProfileBlurSummedAreaTableBoxes(const uint32_t *table, const DBProfileBlurBuffer *dst, void *temp, const uint32_t *sizes, size_t count);
+
+/**
+ *  Writes `numberOfRows` rows of the result of `DBProfileBlurSummedAreaTableBoxes`, starting at `firstRow`, into `dst`.
+ *
+ *  Disjoint strips of the same `dst` can be evaluated concurrently, each with its own `temp` buffer.
+ */
+extern void DBProfileBlurSummedAreaTableBoxesRows(const uint32_t *table, const DBProfileBlurBuffer *dst, void *temp, const uint32_t *sizes, size_t count, size_t firstRow, size_t numberOfRows);
+
+/**
+ *  The deepest pyramid level, where buffers are 1/8 of the original size.
+ */
+#define DBProfileBlurPyramidMaximumLevel 3
+
+/**
+ *  The deepest pyramid level at which a blur with the specified variance, in pixels of level 0, keeps all of its visible detail.
+ *
+ *  A level of n shrinks the buffer by 2^n in each dimension. The result is never deeper than `maximumLevel` or `DBProfileBlurPyramidMaximumLevel`.
+ */
+extern size_t DBProfileBlurPyramidLevelForVariance(double variance, size_t maximumLevel);
+
+/**
+ *  The variance, in pixels of level 0, that shrinking a buffer from `level - 1` to `level` adds to it.
+ */
+extern double DBProfileBlurDownsampleVariance(size_t level);
+
+/**
+ *  Halves both dimensions of `buffer` in place by averaging 2x2 blocks of pixels, and updates its width, height and row bytes.
+ *
+ *  An odd last row or column is dropped, and no dimension shrinks below one pixel.
+ */
+extern void DBProfileBlurDownsample(DBProfileBlurBuffer *buffer);
+
+/**
+ *  Shrinks `src` by 2^`levels` in each dimension into the memory of `dst`, and sets the dimensions and format of `dst`.
+ *
+ *  The result equals `levels` successive calls to `DBProfileBlurDownsample` on a copy of `src`, but the source is read once and left unchanged,
+ *  so a large image can be shrunk without copying it first. `levels` must be at least 1, and the memory of `dst` must hold a single level
+ *  of `src` without row padding.
+ */
+extern void DBProfileBlurDownsampleBuffer(const DBProfileBlurBuffer *src, DBProfileBlurBuffer *dst, size_t levels);
+
+/**
+ *  Shrinks `width` and `height` in place to their size after `levels` calls to `DBProfileBlurDownsample`.
+ */
+extern void DBProfileBlurDownsampledSize(size_t *width, size_t *height, size_t levels);
+
+/**
+ *  The number of rows of the result that `DBProfileBlurStreamBoxes` writes per strip so its window fits in `budget` bytes.
+ *
+ *  Every strip also blurs the halo of rows the boxes read around it. If the halo alone does not fit the budget, strips are as tall as the
+ *  halo and the window grows past the budget rather than spending most of its time on the halo.
+ *
+ *  @param width The width of the source, at level 0.
+ *  @param height The height of the source, at level 0.
+ */
+extern size_t DBProfileBlurStreamStripHeight(size_t width, size_t height, DBProfileBlurPixelFormat format, const uint32_t *boxSizes, size_t count, size_t levels, size_t budget);
+
+/**
+ *  The size in bytes of the window required by `DBProfileBlurStreamBoxes` for strips of `stripHeight` rows.
+ *
+ *  @param width The width of the source, at level 0.
+ *  @param height The height of the source, at level 0.
+ */
+extern size_t DBProfileBlurStreamWindowSize(size_t width, size_t height, DBProfileBlurPixelFormat format, const uint32_t *boxSizes, size_t count, size_t levels, size_t stripHeight);
+
+/**
+ *  Shrinks `src` by 2^`levels` in each dimension and convolves it with `count` successive box kernels, writing the result into `dst` one strip
+ *  of rows at a time.
+ *
+ *  Only the rows of a strip and the halo the boxes read around it are held in the window, so the working memory is set by `stripHeight`
+ *  rather than by the size of the image, and `src` is read in place and left unchanged. The result is bit-identical to shrinking a copy of
+ *  `src` with `DBProfileBlurDownsample` and convolving it with `DBProfileBlurBoxConvolve`.
+ *
+ *  @param src The source buffer. Must have at least 2^`levels` rows.
+ *  @param dst The destination buffer. Must have the dimensions of `src` after `DBProfileBlurDownsampledSize` and must not alias it.
+ *  @param window A buffer of at least `DBProfileBlurStreamWindowSize` bytes.
+ *  @param boxSizes `count` box sizes, which may be 0 to only shrink `src`.
+ *  @param levels The number of times `src` is halved before it is blurred.
+ *  @param stripHeight The number of rows of `dst` written per strip, such as `DBProfileBlurStreamStripHeight`.
+ */
+extern void DBProfileBlurStreamBoxes(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *window, const uint32_t *boxSizes, size_t count, size_t levels, size_t stripHeight);
+
+/**
+ *  Writes `numberOfRows` rows of the result of `DBProfileBlurStreamBoxes`, starting at `firstRow`, into `dst`.
+ *
+ *  Disjoint rows of the same `dst` can be streamed concurrently, each with its own window.
+ */
+extern void DBProfileBlurStreamBoxesRows(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, void *window, const uint32_t *boxSizes, size_t count, size_t levels,
+                                         size_t stripHeight, size_t firstRow, size_t numberOfRows);
+
+/**
+ *  A 64-bit digest of the pixels, dimensions and format of `buffer`. Padding at the end of each row is ignored.
+ *
+ *  Equal pixels always have equal digests. The digest is meant for cache keys and is not cryptographically secure.
+ */
+extern uint64_t DBProfileBlurBufferDigest(const DBProfileBlurBuffer *buffer);
+
+/**
+ *  Writes a 64-bit digest of the pixels of every row of `buffer` into `digests`, which must hold `buffer->height` values.
+ *
+ *  Rows with equal pixels at the same width and format have equal digests, so comparing the digests of two frames of the same size finds the
+ *  rows that changed between them without keeping the previous frame.
+ */
+extern void DBProfileBlurRowDigests(const DBProfileBlurBuffer *buffer, uint64_t *digests);
+
+/**
+ *  Finds the band of rows whose digests differ between two frames of `count` rows.
+ *
+ *  @return true and the first changed row and the number of rows up to and including the last changed one, or false and an empty band if no row changed.
+ */
+extern bool DBProfileBlurChangedRows(const uint64_t *digests, const uint64_t *previousDigests, size_t count, size_t *firstRow, size_t *numberOfRows);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+//
+//  DBProfileBlurScheduler.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+@class DBProfileBackdropBlurView;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurScheduler` class updates the dynamic `DBProfileBackdropBlurView`s in a window, in place of the scheduler of `FXBlurView`.
+ *
+ *  Views are kept in a min-heap of the times their next updates are due. Every view due by the next frame starts when the display link fires,
+ *  each on its own worker, up to `maxConcurrentUpdates` at a time. The display link only runs while a view is due within a frame, and a single
+ *  timer wakes the scheduler when a later view falls due, so an idle scheduler never wakes up.
+ *
+ *  Views starting in the same frame that would snapshot the same backdrop share a single render of it, whenever the union of their rects
+ *  holds no more pixels than their rects together.
+ */
+@interface DBProfileBlurScheduler : NSObject
+
+/**
+ *  The scheduler shared by all backdrop blur views.
+ */
++ (instancetype)sharedScheduler;
+
+/**
+ *  Whether views are updated at all. Defaults to YES.
+ */
+@property (nonatomic) BOOL blurEnabled;
+
+/**
+ *  The largest number of views blurred at the same time. Defaults to the number of active processors.
+ */
+@property (nonatomic) NSUInteger maxConcurrentUpdates;
+
+/**
+ *  Starts updating the specified view, which is due at once. Views already added are left as they are.
+ */
+- (void)addView:(DBProfileBackdropBlurView *)view;
+
+/**
+ *  Stops updating the specified view. An update already running completes.
+ */
+- (void)removeView:(DBProfileBackdropBlurView *)view;
+
+/**
+ *  Balances a call to `setUpdatesDisabled`, and resumes updates once every call has been balanced.
+ */
+- (void)setUpdatesEnabled;
+
+/**
+ *  Pauses updates until a matching call to `setUpdatesEnabled`. Calls nest.
+ */
+- (void)setUpdatesDisabled;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,310 @@
+//
+//  DBProfileBlurScheduler.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurScheduler.h"
+#import "DBProfileBlurScheduler_Private.h"
+#import "DBProfileBackdropBlurView_Private.h"
+#import "UIImage+DBProfileViewController.h"
+
+@interface DBProfileBlurScheduler ()
+
+@property (nonatomic) NSMutableSet<DBProfileBackdropBlurView *> *views;
+@property (nonatomic) NSMutableSet<DBProfileBackdropBlurView *> *updatingViews;
+@property (nonatomic, nullable) NSTimer *wakeUpTimer;
+// Disabling nests, so the count is signed and may drop below zero before it is balanced
+@property (nonatomic) NSInteger updatesEnabledCount;
+
+@end
+
+@implementation DBProfileBlurScheduler
+
++ (instancetype)sharedScheduler {
+    static DBProfileBlurScheduler *sharedScheduler;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedScheduler = [[self alloc] init];
+    });
+    return sharedScheduler;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _blurEnabled = YES;
+        _updatesEnabledCount = 1;
+        _maxConcurrentUpdates = MAX([NSProcessInfo processInfo].activeProcessorCount, 1);
+        _views = [NSMutableSet set];
+        _dueViews = [NSMutableArray array];
+        _updatingViews = [NSMutableSet set];
+
+        // The display link only runs while a view is due, so an idle scheduler never wakes up
+        _displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayLinkDidFire:)];
+        _displayLink.paused = YES;
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    return self;
+}
+
+- (void)setBlurEnabled:(BOOL)blurEnabled {
+    _blurEnabled = blurEnabled;
+    if (blurEnabled) {
+        for (DBProfileBackdropBlurView *view in self.views) {
+            [view setNeedsDisplay];
+        }
+    }
+    [self updateAsynchronously];
+}
+
+- (void)setMaxConcurrentUpdates:(NSUInteger)maxConcurrentUpdates {
+    _maxConcurrentUpdates = MAX(maxConcurrentUpdates, 1);
+    [self updateAsynchronously];
+}
+
+- (void)setUpdatesEnabled {
+    self.updatesEnabledCount++;
+    [self updateAsynchronously];
+}
+
+- (void)setUpdatesDisabled {
+    self.updatesEnabledCount--;
+    [self updateAsynchronously];
+}
+
+- (void)addView:(DBProfileBackdropBlurView *)view {
+    if ([self.views containsObject:view]) return;
+    [self.views addObject:view];
+    [self scheduleView:view dueTime:CACurrentMediaTime()];
+    [self updateAsynchronously];
+}
+
+- (void)removeView:(DBProfileBackdropBlurView *)view {
+    if (![self.views containsObject:view]) return;
+    [self.views removeObject:view];
+    [self unscheduleView:view];
+    [self updateAsynchronously];
+}
+
+#pragma mark - Due Time Heap
+
+// Views are kept in a binary min-heap of due times, and every view knows its index so it can be removed without a search
+
+- (void)swapDueViewAtIndex:(NSUInteger)index withIndex:(NSUInteger)otherIndex {
+    [self.dueViews exchangeObjectAtIndex:index withObjectAtIndex:otherIndex];
+    self.dueViews[index].dueIndex = index;
+    self.dueViews[otherIndex].dueIndex = otherIndex;
+}
+
+- (void)siftDueViewUpFromIndex:(NSUInteger)index {
+    while (index > 0) {
+        NSUInteger parent = (index - 1) / 2;
+        if (self.dueViews[index].dueTime >= self.dueViews[parent].dueTime) break;
+        [self swapDueViewAtIndex:index withIndex:parent];
+        index = parent;
+    }
+}
+
+- (void)siftDueViewDownFromIndex:(NSUInteger)index {
+    NSUInteger count = self.dueViews.count;
+    while (YES) {
+        NSUInteger first = index;
+        NSUInteger left = 2 * index + 1, right = left + 1;
+        if (left < count && self.dueViews[left].dueTime < self.dueViews[first].dueTime) first = left;
+        if (right < count && self.dueViews[right].dueTime < self.dueViews[first].dueTime) first = right;
+        if (first == index) break;
+        [self swapDueViewAtIndex:index withIndex:first];
+        index = first;
+    }
+}
+
+- (void)scheduleView:(DBProfileBackdropBlurView *)view dueTime:(CFTimeInterval)dueTime {
+    // A view being updated is scheduled again when its update completes
+    if ([self.updatingViews containsObject:view]) return;
+    [self unscheduleView:view];
+    view.dueTime = dueTime;
+    view.dueIndex = self.dueViews.count;
+    [self.dueViews addObject:view];
+    [self siftDueViewUpFromIndex:view.dueIndex];
+}
+
+- (void)unscheduleView:(DBProfileBackdropBlurView *)view {
+    NSUInteger index = view.dueIndex;
+    if (index >= self.dueViews.count || self.dueViews[index] != view) return;
+
+    NSUInteger lastIndex = self.dueViews.count - 1;
+    if (index != lastIndex) [self swapDueViewAtIndex:index withIndex:lastIndex];
+    [self.dueViews removeLastObject];
+    view.dueIndex = NSNotFound;
+    if (index < lastIndex) {
+        [self siftDueViewDownFromIndex:index];
+        [self siftDueViewUpFromIndex:index];
+    }
+}
+
+- (nullable DBProfileBackdropBlurView *)popDueViewBefore:(CFTimeInterval)time {
+    DBProfileBackdropBlurView *view = self.dueViews.firstObject;
+    if (!view || view.dueTime > time) return nil;
+    [self unscheduleView:view];
+    return view;
+}
+
+#pragma mark - Updates
+
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink {
+    if (!self.blurEnabled || self.updatesEnabledCount <= 0) {
+        [self updateAsynchronously];
+        return;
+    }
+
+    // Every view due by the next frame starts now, each on its own worker, up to one blur per core
+    CFTimeInterval frameTime = displayLink.timestamp + displayLink.duration;
+    NSMutableArray<DBProfileBackdropBlurView *> *startingViews = [NSMutableArray array];
+    DBProfileBackdropBlurView *view = nil;
+    while (self.updatingViews.count + startingViews.count < self.maxConcurrentUpdates && (view = [self popDueViewBefore:frameTime])) {
+        if (view.hidden || !view.window || ![view shouldUpdate]) {
+            // Views that cannot be blurred right now are tried again one interval later
+            [self scheduleView:view dueTime:frameTime + view.updateInterval];
+            continue;
+        }
+        [startingViews addObject:view];
+    }
+
+    [self.updatingViews addObjectsFromArray:startingViews];
+    NSMapTable<DBProfileBackdropBlurView *, UIImage *> *snapshots = [self sharedSnapshotsForViews:startingViews];
+    for (view in startingViews) {
+        __weak DBProfileBackdropBlurView *weakView = view;
+        void (^completion)(void) = ^{
+            DBProfileBackdropBlurView *strongView = weakView;
+            if (strongView) {
+                [self.updatingViews removeObject:strongView];
+                if ([self.views containsObject:strongView]) {
+                    [self scheduleView:strongView dueTime:CACurrentMediaTime() + strongView.updateInterval];
+                }
+            }
+            [self updateAsynchronously];
+        };
+        
+        UIImage *snapshot = [snapshots objectForKey:view];
+        if (snapshot) {
+            [view updateWithSnapshot:snapshot completion:completion];
+        }
+        else {
+            [view updateAsynchronously:YES completion:completion];
+        }
+    }
+    [self updateAsynchronously];
+}
+
+#pragma mark - Shared Snapshots
+
+- (NSMapTable<DBProfileBackdropBlurView *, UIImage *> *)sharedSnapshotsForViews:(NSArray<DBProfileBackdropBlurView *> *)views {
+    // Views that hide the same layers of the same backdrop at the same scale can share a single render of it in this frame
+    NSMutableDictionary<id, NSMutableArray<DBProfileBackdropBlurView *> *> *groups = [NSMutableDictionary dictionary];
+    for (DBProfileBackdropBlurView *view in views) {
+        id key = [view snapshotKey];
+        if (!key) continue;
+        NSMutableArray<DBProfileBackdropBlurView *> *group = groups[key] ?: [NSMutableArray array];
+        [group addObject:view];
+        groups[key] = group;
+    }
+    
+    NSMapTable<DBProfileBackdropBlurView *, UIImage *> *snapshots = [NSMapTable strongToStrongObjectsMapTable];
+    for (NSArray<DBProfileBackdropBlurView *> *group in groups.allValues) {
+        if (group.count < 2) continue;
+        
+        // A backdrop is only rendered once if that renders no more pixels than rendering it for every view would
+        CGRect rect = CGRectNull;
+        CGFloat area = 0.0;
+        for (DBProfileBackdropBlurView *view in group) {
+            CGRect viewRect = [view snapshotRect];
+            rect = CGRectUnion(rect, viewRect);
+            area += CGRectGetWidth(viewRect) * CGRectGetHeight(viewRect);
+        }
+        if (CGRectGetWidth(rect) * CGRectGetHeight(rect) > area) continue;
+        
+        DBProfileBackdropBlurView *firstView = group.firstObject;
+        UIImage *snapshot = [firstView snapshotOfUnderlyingViewInRect:rect scale:[firstView snapshotScale]];
+        for (DBProfileBackdropBlurView *view in group) {
+            UIImage *viewSnapshot = [self snapshotInRect:[view snapshotRect] ofSnapshot:snapshot inRect:rect];
+            if (viewSnapshot) [snapshots setObject:viewSnapshot forKey:view];
+        }
+    }
+    return snapshots;
+}
+
+// Copies the pixels of `rect` out of a snapshot of the larger `snapshotRect`, rounded to whole pixels of the snapshot
+- (nullable UIImage *)snapshotInRect:(CGRect)rect ofSnapshot:(nullable UIImage *)snapshot inRect:(CGRect)snapshotRect {
+    CGImageRef imageRef = snapshot.CGImage;
+    if (!imageRef || CGImageGetBitsPerPixel(imageRef) != 32) return nil;
+    
+    CGFloat scale = snapshot.scale;
+    size_t imageWidth = CGImageGetWidth(imageRef), imageHeight = CGImageGetHeight(imageRef);
+    size_t x = (size_t)MAX(0.0, round((CGRectGetMinX(rect) - CGRectGetMinX(snapshotRect)) * scale));
+    size_t y = (size_t)MAX(0.0, round((CGRectGetMinY(rect) - CGRectGetMinY(snapshotRect)) * scale));
+    size_t width = (size_t)MAX(0.0, floor(CGRectGetWidth(rect) * scale));
+    size_t height = (size_t)MAX(0.0, floor(CGRectGetHeight(rect) * scale));
+    if (x >= imageWidth || y >= imageHeight) return nil;
+    width = MIN(width, imageWidth - x);
+    height = MIN(height, imageHeight - y);
+    if (width == 0 || height == 0) return nil;
+    
+    CFDataRef dataSource = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    if (!dataSource) return nil;
+    size_t sourceRowBytes = CGImageGetBytesPerRow(imageRef), rowBytes = width * 4;
+    NSMutableData *pixels = [NSMutableData dataWithLength:rowBytes * height];
+    const uint8_t *source = CFDataGetBytePtr(dataSource) + y * sourceRowBytes + x * 4;
+    for (size_t row = 0; row < height; row++) {
+        memcpy((uint8_t *)pixels.mutableBytes + row * rowBytes, source + row * sourceRowBytes, rowBytes);
+    }
+    CFRelease(dataSource);
+    
+    // The crop keeps the digests of its rows, so the view does not copy its pixels again to compare it with its last snapshot
+    DBProfileBlurBuffer buffer = {pixels.mutableBytes, width, height, rowBytes, DBProfileBlurPixelFormat32};
+    NSMutableData *rowDigests = [NSMutableData dataWithLength:height * sizeof(uint64_t)];
+    DBProfileBlurRowDigests(&buffer, rowDigests.mutableBytes);
+    
+    CGDataProviderRef provider = CGDataProviderCreateWithCFData((__bridge CFDataRef)pixels);
+    CGImageRef croppedImageRef = CGImageCreate(width, height, 8, 32, rowBytes, CGImageGetColorSpace(imageRef), CGImageGetBitmapInfo(imageRef), provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    UIImage *image = [UIImage imageWithCGImage:croppedImageRef scale:scale orientation:snapshot.imageOrientation];
+    CGImageRelease(croppedImageRef);
+    image.db_rowDigests = rowDigests;
+    return image;
+}
+
+- (void)wakeUpTimerDidFire:(NSTimer *)timer {
+    self.wakeUpTimer = nil;
+    [self updateAsynchronously];
+}
+
+- (void)updateAsynchronously {
+    [self.wakeUpTimer invalidate];
+    self.wakeUpTimer = nil;
+
+    // Nothing is due while blurring is off or no view is waiting, so neither the display link nor a timer is left running
+    DBProfileBackdropBlurView *nextView = self.dueViews.firstObject;
+    BOOL canStart = self.updatingViews.count < self.maxConcurrentUpdates;
+    if (!self.blurEnabled || self.updatesEnabledCount <= 0 || !nextView || !canStart) {
+        self.displayLink.paused = YES;
+        return;
+    }
+
+    // Views due within a frame are picked up by the display link, later ones wake the scheduler once when they fall due
+    CFTimeInterval delay = nextView.dueTime - CACurrentMediaTime();
+    CFTimeInterval frameDuration = self.displayLink.duration > 0 ? self.displayLink.duration : 1.0 / 60.0;
+    if (delay <= frameDuration) {
+        self.displayLink.paused = NO;
+    }
+    else {
+        self.displayLink.paused = YES;
+        self.wakeUpTimer = [NSTimer timerWithTimeInterval:delay - frameDuration target:self selector:@selector(wakeUpTimerDidFire:) userInfo:nil repeats:NO];
+        self.wakeUpTimer.tolerance = frameDuration / 2.0;
+        [[NSRunLoop mainRunLoop] addTimer:self.wakeUpTimer forMode:NSRunLoopCommonModes];
+    }
+}
+
+@end
@@ -0,0 +1,60 @@
+//
+//  DBProfileBlurScheduler_Private.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurScheduler.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface DBProfileBlurScheduler ()
+
+/**
+ *  The views waiting for their next update, as a binary min-heap of their due times.
+ */
+@property (nonatomic) NSMutableArray<DBProfileBackdropBlurView *> *dueViews;
+
+/**
+ *  The display link that starts the views due by the next frame, paused while no view is due within a frame.
+ */
+@property (nonatomic) CADisplayLink *displayLink;
+
+/**
+ *  Adds a view to the heap at the specified due time, or moves it there if it is already in the heap. Views being updated are left out.
+ */
+- (void)scheduleView:(DBProfileBackdropBlurView *)view dueTime:(CFTimeInterval)dueTime;
+
+/**
+ *  Removes a view from the heap by its `dueIndex`. Views that are not in the heap are left as they are.
+ */
+- (void)unscheduleView:(DBProfileBackdropBlurView *)view;
+
+/**
+ *  Removes and returns the view due first, or nil if no view is due by the specified time.
+ */
+- (nullable DBProfileBackdropBlurView *)popDueViewBefore:(CFTimeInterval)time;
+
+/**
+ *  Resumes the display link if the view due first is due within a frame, or pauses it and sets a timer to wake the scheduler when that
+ *  view falls due. The display link stays paused while blurring or updates are off or no view is due.
+ */
+- (void)updateAsynchronously;
+
+/**
+ *  Takes one snapshot for every group of views that can share it, and crops the snapshot of each view in those groups out of it.
+ *
+ *  @return The snapshot of every view that shares a snapshot. Views that snapshot on their own are left out.
+ */
+- (NSMapTable<DBProfileBackdropBlurView *, UIImage *> *)sharedSnapshotsForViews:(NSArray<DBProfileBackdropBlurView *> *)views;
+
+/**
+ *  Copies the pixels of `rect` out of a snapshot of the larger `snapshotRect`, rounded to whole pixels of the snapshot.
+ */
+- (nullable UIImage *)snapshotInRect:(CGRect)rect ofSnapshot:(nullable UIImage *)snapshot inRect:(CGRect)snapshotRect;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,61 @@
+//
+//  DBProfileBlurSourceImage.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurKernel.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurSourceImage` class holds the pixels of an image in the format read by the blur kernels.
+ *
+ *  The image is decoded the first time its pixels are read. 32-bit RGBA, BGRA and RGBX images and 8-bit grayscale images are read as they are
+ *  by kernels specialized for their layout, other images are redrawn as 32-bit ARGB. Every blur of the image then reads the same
+ *  pixels, so a blur view that renders its stages again, for example after a memory warning, does not decode the image again.
+ *
+ *  All methods are safe to call from any thread.
+ */
+@interface DBProfileBlurSourceImage : NSObject
+
+- (instancetype)initWithImage:(UIImage *)image NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The format the pixels of the specified image are blurred in.
+ */
++ (DBProfileBlurPixelFormat)pixelFormatForImage:(UIImage *)image;
+
+/**
+ *  The size in pixels of the buffer the pixels of the specified image are read into, without decoding it.
+ */
++ (CGSize)pixelSizeForImage:(UIImage *)image;
+
+/**
+ *  The image the pixels are read from.
+ */
+@property (nonatomic, readonly) UIImage *image;
+
+/**
+ *  The image, or a copy of it in a format the kernels can read. Its CGImage is backed by the pixels of `buffer` without copying them.
+ */
+@property (nonatomic, readonly) UIImage *normalizedImage;
+
+/**
+ *  The pixels of `normalizedImage`. They are owned by the receiver and must not be modified.
+ */
+@property (nonatomic, readonly) DBProfileBlurBuffer buffer;
+
+/**
+ *  A digest of the pixels, dimensions and scale of the image, computed once. Images with equal digests have equal stages.
+ */
+@property (nonatomic, readonly) NSString *imageDigest;
+
+@end
+
+NS_ASSUME_NONNULL_END
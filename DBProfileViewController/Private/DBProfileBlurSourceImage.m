@@ -0,0 +1,138 @@
+//
+//  DBProfileBlurSourceImage.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurSourceImage.h"
+
+// The kernels are specialized for the layouts images are most often decoded in, so those are read as they are
+static BOOL DBProfileBlurPixelFormatForImageRef(CGImageRef imageRef, DBProfileBlurPixelFormat *format) {
+    if (CGImageGetBitsPerComponent(imageRef) != 8) return NO;
+    
+    // RGBA and BGRA, premultiplied or not, and opaque RGBX and XRGB
+    if (CGImageGetBitsPerPixel(imageRef) == 32 && (CGImageGetBitmapInfo(imageRef) & kCGBitmapAlphaInfoMask)) {
+        *format = DBProfileBlurPixelFormat32;
+        return YES;
+    }
+    
+    // Grayscale without alpha
+    if (CGImageGetBitsPerPixel(imageRef) == 8 &&
+        (CGImageGetBitmapInfo(imageRef) & kCGBitmapAlphaInfoMask) == kCGImageAlphaNone &&
+        CGColorSpaceGetModel(CGImageGetColorSpace(imageRef)) == kCGColorSpaceModelMonochrome) {
+        *format = DBProfileBlurPixelFormatGray8;
+        return YES;
+    }
+    return NO;
+}
+
+@interface DBProfileBlurSourceImage ()
+
+@property (nonatomic) UIImage *normalizedImage;
+@property (nonatomic) NSData *pixelData;
+@property (nonatomic, copy) NSString *imageDigest;
+
+@end
+
+@implementation DBProfileBlurSourceImage {
+    DBProfileBlurBuffer _buffer;
+}
+
+- (instancetype)initWithImage:(UIImage *)image {
+    self = [super init];
+    if (self) {
+        _image = image;
+    }
+    return self;
+}
+
++ (DBProfileBlurPixelFormat)pixelFormatForImage:(UIImage *)image {
+    DBProfileBlurPixelFormat format = DBProfileBlurPixelFormat32;
+    DBProfileBlurPixelFormatForImageRef(image.CGImage, &format);
+    return format;
+}
+
++ (CGSize)pixelSizeForImage:(UIImage *)image {
+    // Images read as they are keep the size of their CGImage, others are redrawn at the size of the image in pixels
+    CGImageRef imageRef = image.CGImage;
+    DBProfileBlurPixelFormat format;
+    if (imageRef && DBProfileBlurPixelFormatForImageRef(imageRef, &format)) return CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef));
+    return CGSizeMake(ceil(image.size.width * image.scale), ceil(image.size.height * image.scale));
+}
+
+- (UIImage *)normalizedImage {
+    @synchronized (self) {
+        [self loadPixelsIfNeeded];
+        return _normalizedImage;
+    }
+}
+
+- (DBProfileBlurBuffer)buffer {
+    @synchronized (self) {
+        [self loadPixelsIfNeeded];
+        return _buffer;
+    }
+}
+
+- (NSString *)imageDigest {
+    @synchronized (self) {
+        if (!_imageDigest) {
+            // Digesting the normalized pixels makes images with equal pixels match whatever format they were decoded in
+            DBProfileBlurBuffer buffer = self.buffer;
+            uint64_t digest = buffer.data ? DBProfileBlurBufferDigest(&buffer) : 0;
+            _imageDigest = [NSString stringWithFormat:@"%016llx@%gx", digest, self.image.scale];
+        }
+        return _imageDigest;
+    }
+}
+
+- (void)loadPixelsIfNeeded {
+    if (self.pixelData) return;
+
+    UIImage *image = self.image;
+    CGImageRef imageRef = image.CGImage;
+
+    // Images the kernels can read are decoded once and read in place
+    DBProfileBlurPixelFormat format;
+    if (imageRef && DBProfileBlurPixelFormatForImageRef(imageRef, &format)) {
+        NSData *pixelData = CFBridgingRelease(CGDataProviderCopyData(CGImageGetDataProvider(imageRef)));
+        self.pixelData = pixelData ?: [NSData data];
+        self.normalizedImage = image;
+        if (pixelData) _buffer = (DBProfileBlurBuffer){(uint8_t *)pixelData.bytes, CGImageGetWidth(imageRef), CGImageGetHeight(imageRef), CGImageGetBytesPerRow(imageRef), format};
+        return;
+    }
+
+    // Other images, such as 16 bits per channel or 24-bit RGB, are redrawn as 32-bit ARGB into memory that then backs the normalized image, the same way UIKit draws into an image context
+    size_t width = (size_t)ceil(image.size.width * image.scale);
+    size_t height = (size_t)ceil(image.size.height * image.scale);
+    size_t rowBytes = width * 4;
+    NSMutableData *pixelData = [NSMutableData dataWithLength:rowBytes * height];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = (CGBitmapInfo)kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little;
+
+    CGContextRef ctx = CGBitmapContextCreate(pixelData.mutableBytes, width, height, 8, rowBytes, colorSpace, bitmapInfo);
+    if (ctx) {
+        CGContextTranslateCTM(ctx, 0, height);
+        CGContextScaleCTM(ctx, image.scale, -image.scale);
+        UIGraphicsPushContext(ctx);
+        [image drawAtPoint:CGPointZero];
+        UIGraphicsPopContext();
+        CGContextRelease(ctx);
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithCFData((__bridge CFDataRef)pixelData);
+    CGImageRef normalizedImageRef = CGImageCreate(width, height, 8, 32, rowBytes, colorSpace, bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    self.pixelData = pixelData;
+    self.normalizedImage = image;
+    if (normalizedImageRef) {
+        self.normalizedImage = [UIImage imageWithCGImage:normalizedImageRef scale:image.scale orientation:UIImageOrientationUp];
+        _buffer = (DBProfileBlurBuffer){pixelData.mutableBytes, width, height, rowBytes, DBProfileBlurPixelFormat32};
+    }
+    CGImageRelease(normalizedImageRef);
+    CGDataProviderRelease(provider);
+    CGColorSpaceRelease(colorSpace);
+}
+
+@end
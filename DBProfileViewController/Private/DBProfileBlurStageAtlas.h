@@ -0,0 +1,113 @@
+//
+//  DBProfileBlurStageAtlas.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurSourceImage.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurStageAtlas` class holds every blurred stage of an image in a single page-aligned slab of memory.
+ *
+ *  Each stage is stored in its own region of the slab at the size of its pyramid level, and the image of a stage is backed by its region
+ *  without copying it. Stages are looked up by index, and the slab is freed at once when the atlas and every image of its stages have been
+ *  released, so the stages of an image always hold exactly `byteCount` bytes. Stages blurred elsewhere, such as stages mapped from a
+ *  `DBProfileBlurStageDiskCache`, can be shown as they are instead of being copied into a region.
+ *
+ *  Stage 0 is the image itself and has no region. All methods are safe to call from any thread.
+ */
+@interface DBProfileBlurStageAtlas : NSObject
+
+/**
+ *  Creates an atlas with a region for every stage after stage 0.
+ *
+ *  @param sourceImage The pixels the stages are blurred from, which provide the size, format and color space of every stage.
+ *  @param pyramidLevels The pyramid level of every stage, including stage 0, such as `-[DBProfileBlurStagePlan pyramidLevels]`.
+ */
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels;
+
+/**
+ *  Creates an atlas that shows the specified images for their stages as they are, and has a region for every other stage after stage 0.
+ *
+ *  @param sourceImage The pixels the stages are blurred from, which provide the size, format and color space of every stage.
+ *  @param pyramidLevels The pyramid level of every stage, including stage 0, such as `-[DBProfileBlurStagePlan pyramidLevels]`.
+ *  @param stageImages Images of stages blurred elsewhere, by stage. Images whose size or pixel layout do not match their stage get a region.
+ */
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage
+                      pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels
+                        stageImages:(nullable NSDictionary<NSNumber *, UIImage *> *)stageImages NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The size in bytes of the region an atlas sets aside for a stage at a pyramid level of an image, used to plan stages before they are rendered.
+ *
+ *  @param width The width in pixels of the image, such as `+[DBProfileBlurSourceImage pixelSizeForImage:]`.
+ *  @param height The height in pixels of the image.
+ *  @param format The format the image is blurred in.
+ *  @param level The pyramid level of the stage.
+ */
++ (NSUInteger)byteCountForRegionOfWidth:(size_t)width height:(size_t)height format:(DBProfileBlurPixelFormat)format pyramidLevel:(NSUInteger)level;
+
+/**
+ *  The pixels the stages are blurred from.
+ */
+@property (nonatomic, readonly) DBProfileBlurSourceImage *sourceImage;
+
+/**
+ *  The number of stages, including stage 0.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfStages;
+
+/**
+ *  The number of bytes held by the stages, which is the size of the slab and of the bitmaps of the images shown as they are.
+ */
+@property (nonatomic, readonly) NSUInteger byteCount;
+
+/**
+ *  Whether every stage after stage 0 has been stored.
+ */
+@property (nonatomic, readonly, getter=isComplete) BOOL complete;
+
+/**
+ *  The size in bytes of the region of a stage, or of its bitmap if it is shown as it is. Stage 0 has no region.
+ */
+- (NSUInteger)byteCountForStage:(NSUInteger)stage;
+
+/**
+ *  Returns the image of a stage, or nil if the stage has not been stored yet. Stage 0 returns the image itself.
+ */
+- (nullable UIImage *)imageForStage:(NSUInteger)stage;
+
+/**
+ *  Copies the pixels of `buffer` into the region of a stage and returns the image backed by the region.
+ *
+ *  @return The image of the stage, or nil if the dimensions or format of `buffer` do not match the region.
+ */
+- (nullable UIImage *)setBuffer:(const DBProfileBlurBuffer *)buffer forStage:(NSUInteger)stage;
+
+/**
+ *  Lets `block` write the pixels of a stage straight into its region, and returns the image backed by the region.
+ *
+ *  `block` is called synchronously, and only if the stage has not been stored yet. This spares large stages a buffer of their own.
+ *
+ *  @return The image of the stage, or nil if `width` and `height` do not match the region.
+ */
+- (nullable UIImage *)renderStage:(NSUInteger)stage width:(size_t)width height:(size_t)height usingBlock:(void (^)(const DBProfileBlurBuffer *region))block;
+
+/**
+ *  Copies the pixels of a stage blurred elsewhere into the region of a stage. Prefer passing such stages to
+ *  `-initWithSourceImage:pyramidLevels:stageImages:`, which shows them without copying.
+ *
+ *  @return The image of the stage, or nil if the size, pixel layout or color space of `image` do not match the region.
+ */
+- (nullable UIImage *)setImage:(UIImage *)image forStage:(NSUInteger)stage;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,243 @@
+//
+//  DBProfileBlurStageAtlas.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurStageAtlas.h"
+#import <sys/mman.h>
+#import <pthread.h>
+
+// Rows aligned to 64 bytes can be handed to Core Animation without being copied
+static const size_t DBProfileBlurStageAtlasRowAlignment = 64;
+
+static size_t DBProfileBlurStageAtlasRoundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// The region of a stage at a pyramid level, with the size computed by DBProfileBlurDownsample and rows aligned for Core Animation
+static DBProfileBlurBuffer DBProfileBlurStageAtlasRegionForLevel(size_t width, size_t height, DBProfileBlurPixelFormat format, NSUInteger level) {
+    DBProfileBlurDownsampledSize(&width, &height, MIN(level, DBProfileBlurPyramidMaximumLevel));
+    size_t rowBytes = DBProfileBlurStageAtlasRoundUp(width * DBProfileBlurPixelFormatBytesPerPixel(format), DBProfileBlurStageAtlasRowAlignment);
+    return (DBProfileBlurBuffer){NULL, width, height, rowBytes, format};
+}
+
+// Every region starts on a page of its own
+static size_t DBProfileBlurStageAtlasRegionLength(DBProfileBlurBuffer region) {
+    return DBProfileBlurStageAtlasRoundUp(region.rowBytes * region.height, (size_t)getpagesize());
+}
+
+static void DBProfileBlurStageAtlasReleaseSlab(void *info, const void *data, size_t size) {
+    CFRelease(info);
+}
+
+/**
+ *  The memory of an atlas. It is kept alive by the atlas and by the image of every stage, and unmapped once all of them are released.
+ */
+@interface DBProfileBlurStageAtlasSlab : NSObject
+
+- (instancetype)initWithLength:(size_t)length;
+
+@property (nonatomic, readonly) uint8_t *bytes;
+@property (nonatomic, readonly) size_t length;
+
+@end
+
+@implementation DBProfileBlurStageAtlasSlab
+
+- (instancetype)initWithLength:(size_t)length {
+    self = [super init];
+    if (self) {
+        // Anonymous mappings are page-aligned and go back to the system as soon as they are unmapped, rather than to the malloc zone
+        void *bytes = length > 0 ? mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0) : MAP_FAILED;
+        if (bytes != MAP_FAILED) {
+            _bytes = bytes;
+            _length = length;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_bytes) munmap(_bytes, _length);
+}
+
+@end
+
+@implementation DBProfileBlurStageAtlas {
+    DBProfileBlurStageAtlasSlab *_slab;
+    DBProfileBlurBuffer *_regions;
+    size_t *_byteCounts;
+    size_t _byteCount;
+    NSMutableArray *_images;
+    NSUInteger _numberOfStoredStages;
+
+    // A mutex rather than @synchronized, which looks the receiver up in a hash table on every lookup of a stage
+    pthread_mutex_t _lock;
+}
+
++ (NSUInteger)byteCountForRegionOfWidth:(size_t)width height:(size_t)height format:(DBProfileBlurPixelFormat)format pyramidLevel:(NSUInteger)level {
+    return DBProfileBlurStageAtlasRegionLength(DBProfileBlurStageAtlasRegionForLevel(width, height, format, level));
+}
+
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels {
+    return [self initWithSourceImage:sourceImage pyramidLevels:pyramidLevels stageImages:nil];
+}
+
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels stageImages:(NSDictionary<NSNumber *, UIImage *> *)stageImages {
+    self = [super init];
+    if (self) {
+        _sourceImage = sourceImage;
+        _numberOfStages = pyramidLevels.count;
+        _regions = calloc(MAX(_numberOfStages, 1), sizeof(DBProfileBlurBuffer));
+        _byteCounts = calloc(MAX(_numberOfStages, 1), sizeof(size_t));
+        _images = [NSMutableArray arrayWithCapacity:_numberOfStages];
+        for (NSUInteger stage = 0; stage < _numberOfStages; stage++) [_images addObject:[NSNull null]];
+        pthread_mutex_init(&_lock, NULL);
+
+        DBProfileBlurBuffer source = sourceImage.buffer;
+        size_t *offsets = calloc(MAX(_numberOfStages, 1), sizeof(size_t));
+        size_t length = 0;
+        for (NSUInteger stage = 1; stage < _numberOfStages; stage++) {
+            _regions[stage] = DBProfileBlurStageAtlasRegionForLevel(source.width, source.height, source.format, [pyramidLevels[stage] unsignedIntegerValue]);
+
+            // Images blurred elsewhere are shown as they are, so the memory they are backed by, such as a mapped file, is never copied
+            UIImage *stageImage = stageImages[@(stage)];
+            if (stageImage && [self canStoreImage:stageImage forStage:stage]) {
+                _images[stage] = [self imageWithCGImage:stageImage.CGImage forStage:stage];
+                _byteCounts[stage] = CGImageGetBytesPerRow(stageImage.CGImage) * CGImageGetHeight(stageImage.CGImage);
+                _numberOfStoredStages++;
+                continue;
+            }
+            offsets[stage] = length;
+            _byteCounts[stage] = DBProfileBlurStageAtlasRegionLength(_regions[stage]);
+            length += _byteCounts[stage];
+        }
+
+        _slab = [[DBProfileBlurStageAtlasSlab alloc] initWithLength:length];
+        for (NSUInteger stage = 1; stage < _numberOfStages; stage++) {
+            if (_images[stage] != [NSNull null]) {
+                _byteCount += _byteCounts[stage];
+            }
+            else if (_slab.bytes) {
+                _regions[stage].data = _slab.bytes + offsets[stage];
+                _byteCount += _byteCounts[stage];
+            }
+            else {
+                _byteCounts[stage] = 0;
+            }
+        }
+        free(offsets);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_regions);
+    free(_byteCounts);
+    pthread_mutex_destroy(&_lock);
+}
+
+- (NSUInteger)byteCount {
+    return _byteCount;
+}
+
+- (BOOL)isComplete {
+    pthread_mutex_lock(&_lock);
+    BOOL complete = _numberOfStoredStages + 1 >= _numberOfStages;
+    pthread_mutex_unlock(&_lock);
+    return complete;
+}
+
+- (NSUInteger)byteCountForStage:(NSUInteger)stage {
+    if (stage == 0 || stage >= _numberOfStages) return 0;
+    return _byteCounts[stage];
+}
+
+- (UIImage *)imageForStage:(NSUInteger)stage {
+    if (stage == 0) return self.sourceImage.image;
+    if (stage >= _numberOfStages) return nil;
+
+    pthread_mutex_lock(&_lock);
+    id image = _images[stage];
+    pthread_mutex_unlock(&_lock);
+    return image == [NSNull null] ? nil : image;
+}
+
+- (UIImage *)setBuffer:(const DBProfileBlurBuffer *)buffer forStage:(NSUInteger)stage {
+    if (buffer->format != self.sourceImage.buffer.format) return nil;
+    return [self renderStage:stage width:buffer->width height:buffer->height usingBlock:^(const DBProfileBlurBuffer *region) {
+        size_t rowLength = region->width * DBProfileBlurPixelFormatBytesPerPixel(region->format);
+        for (size_t y = 0; y < region->height; y++) {
+            memcpy(region->data + y * region->rowBytes, buffer->data + y * buffer->rowBytes, rowLength);
+        }
+    }];
+}
+
+- (UIImage *)renderStage:(NSUInteger)stage width:(size_t)width height:(size_t)height usingBlock:(void (^)(const DBProfileBlurBuffer *))block {
+    if (stage == 0 || stage >= _numberOfStages) return nil;
+    DBProfileBlurBuffer region = _regions[stage];
+    if (width != region.width || height != region.height) return nil;
+
+    // The pixels of a stage that is already stored may be on screen, so they are never written again
+    UIImage *storedImage = [self imageForStage:stage];
+    if (storedImage) return storedImage;
+    if (!region.data) return nil;
+    block(&region);
+
+    // The image reads the region in place and keeps the slab alive for as long as it exists
+    CGImageRef normalizedImageRef = self.sourceImage.normalizedImage.CGImage;
+    CGDataProviderRef provider = CGDataProviderCreateWithData((__bridge_retained void *)_slab, region.data, region.rowBytes * region.height, DBProfileBlurStageAtlasReleaseSlab);
+    CGImageRef imageRef = CGImageCreate(region.width, region.height, 8, 8 * DBProfileBlurPixelFormatBytesPerPixel(region.format), region.rowBytes,
+                                        CGImageGetColorSpace(normalizedImageRef), CGImageGetBitmapInfo(normalizedImageRef), provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (!imageRef) return nil;
+    UIImage *image = [self imageWithCGImage:imageRef forStage:stage];
+    CGImageRelease(imageRef);
+
+    pthread_mutex_lock(&_lock);
+    if (_images[stage] == [NSNull null]) _numberOfStoredStages++;
+    _images[stage] = image;
+    pthread_mutex_unlock(&_lock);
+    return image;
+}
+
+- (UIImage *)imageWithCGImage:(CGImageRef)imageRef forStage:(NSUInteger)stage {
+    // Stages at a deeper pyramid level keep the size of the image in points
+    UIImage *normalizedImage = self.sourceImage.normalizedImage;
+    CGFloat scale = normalizedImage.scale * _regions[stage].width / self.sourceImage.buffer.width;
+    return [UIImage imageWithCGImage:imageRef scale:scale orientation:normalizedImage.imageOrientation];
+}
+
+- (BOOL)canStoreImage:(UIImage *)image forStage:(NSUInteger)stage {
+    // Stages blurred from the same pixels have the layout and color space of the normalized image
+    DBProfileBlurBuffer region = _regions[stage];
+    CGImageRef imageRef = image.CGImage;
+    CGImageRef normalizedImageRef = self.sourceImage.normalizedImage.CGImage;
+    return (imageRef &&
+            CGImageGetWidth(imageRef) == region.width &&
+            CGImageGetHeight(imageRef) == region.height &&
+            CGImageGetBitsPerComponent(imageRef) == 8 &&
+            CGImageGetBitsPerPixel(imageRef) == 8 * DBProfileBlurPixelFormatBytesPerPixel(region.format) &&
+            CGImageGetBitmapInfo(imageRef) == CGImageGetBitmapInfo(normalizedImageRef) &&
+            CFEqual(CGImageGetColorSpace(imageRef), CGImageGetColorSpace(normalizedImageRef)));
+}
+
+- (UIImage *)setImage:(UIImage *)image forStage:(NSUInteger)stage {
+    if (stage == 0 || stage >= _numberOfStages || ![self canStoreImage:image forStage:stage]) return nil;
+    DBProfileBlurBuffer region = _regions[stage];
+    CGImageRef imageRef = image.CGImage;
+
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    if (!data) return nil;
+
+    UIImage *storedImage = nil;
+    DBProfileBlurBuffer buffer = {(uint8_t *)CFDataGetBytePtr(data), region.width, region.height, CGImageGetBytesPerRow(imageRef), region.format};
+    if ((size_t)CFDataGetLength(data) >= buffer.rowBytes * buffer.height) storedImage = [self setBuffer:&buffer forStage:stage];
+    CFRelease(data);
+    return storedImage;
+}
+
+@end
@@ -0,0 +1,186 @@
+//
+//  DBProfileBlurStageCache.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurKernel.h"
+
+@class DBProfileBlurStageAtlas;
+@class DBProfileBlurStageDiskCache;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurStageCacheKey` class identifies a blurred stage by the pixels of its source image and the blur applied to them.
+ *
+ *  Stages are cached without a tint, which views apply to the stages they show.
+ */
+@interface DBProfileBlurStageCacheKey : NSObject <NSCopying>
+
+- (instancetype)initWithImageDigest:(NSString *)imageDigest
+                         blurRadius:(CGFloat)blurRadius
+                         iterations:(NSUInteger)iterations
+                       pyramidLevel:(NSUInteger)pyramidLevel;
+
+- (instancetype)initWithImageDigest:(NSString *)imageDigest
+                         blurRadius:(CGFloat)blurRadius
+                         iterations:(NSUInteger)iterations
+                       pyramidLevel:(NSUInteger)pyramidLevel
+                      blurAlgorithm:(DBProfileBlurAlgorithm)blurAlgorithm
+                        visibleRect:(CGRect)visibleRect NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The digest of the source image, as returned by `-[DBProfileBlurStageGenerator imageDigest]`.
+ */
+@property (nonatomic, readonly, copy) NSString *imageDigest;
+
+/**
+ *  The blur radius of the stage, in points.
+ */
+@property (nonatomic, readonly) CGFloat blurRadius;
+
+/**
+ *  The number of box convolutions the stage matches.
+ */
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/**
+ *  The pyramid level the stage is stored at.
+ */
+@property (nonatomic, readonly) NSUInteger pyramidLevel;
+
+/**
+ *  The algorithm the stage was blurred with. Keys created without one use `DBProfileBlurAlgorithmBox`.
+ */
+@property (nonatomic, readonly) DBProfileBlurAlgorithm blurAlgorithm;
+
+/**
+ *  The part of the stage that was blurred, as set on `-[DBProfileBlurStageGenerator visibleRect]`. Keys created without one use the whole image.
+ */
+@property (nonatomic, readonly) CGRect visibleRect;
+
+/**
+ *  Whether the whole stage was blurred.
+ */
+@property (nonatomic, readonly, getter=isComplete) BOOL complete;
+
+@end
+
+/**
+ *  The `DBProfileBlurStageCache` class holds blurred stages for every blur view in the process.
+ *
+ *  Stages are keyed by the pixels of their source image rather than the image instance, so a profile that is shown again reuses the stages
+ *  blurred the first time. The least recently used stages are evicted once the bitmaps of all stages exceed `totalCostLimit`. The stages
+ *  of an atlas are stored, looked up and evicted together.
+ *
+ *  All methods are safe to call from any thread.
+ */
+@interface DBProfileBlurStageCache : NSObject
+
+/**
+ *  The cache shared by all blur views. It is emptied when the app receives a memory warning.
+ */
++ (instancetype)sharedCache;
+
+/**
+ *  The largest number of bytes of bitmap data to hold before evicting stages.
+ *
+ *  Defaults to 100 MB. A limit of 0 means there is no limit.
+ */
+@property (nonatomic) NSUInteger totalCostLimit;
+
+/**
+ *  An optional disk tier that keeps stages across launches, such as `+[DBProfileBlurStageDiskCache defaultDiskCache]`.
+ *
+ *  Stages are written through to the disk cache in the background as they are stored, and stages missing from memory are looked up on disk before
+ *  they are blurred again.
+ *
+ *  Defaults to nil.
+ */
+@property (atomic, nullable) DBProfileBlurStageDiskCache *diskCache;
+
+/**
+ *  The number of bytes of bitmap data held by the cache.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+/**
+ *  The number of stages held by the cache.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ *  The number of lookups that found a stage since the statistics were last reset.
+ */
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/**
+ *  The number of lookups counted by `hitCount` that found the stage in the disk cache.
+ */
+@property (nonatomic, readonly) NSUInteger diskHitCount;
+
+/**
+ *  The number of lookups that did not find a stage since the statistics were last reset.
+ */
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/**
+ *  Returns the stage for the specified key and marks it as the most recently used, or nil if the cache does not hold it.
+ */
+- (nullable UIImage *)imageForKey:(DBProfileBlurStageCacheKey *)key;
+
+/**
+ *  Stores a stage, evicting the least recently used stages if needed, and writes it to the disk cache. The cost of a stage is the size of its bitmap.
+ *
+ *  Stages that are larger than `totalCostLimit` on their own are not stored.
+ */
+- (void)setImage:(UIImage *)image forKey:(DBProfileBlurStageCacheKey *)key;
+
+/**
+ *  Returns the atlas holding the stages for every key after the first and marks them as the most recently used, or nil if no single atlas
+ *  holds all of them. The first key is that of stage 0, which atlases do not store.
+ *
+ *  Atlases are only looked up in memory.
+ */
+- (nullable DBProfileBlurStageAtlas *)atlasForKeys:(NSArray<DBProfileBlurStageCacheKey *> *)keys;
+
+/**
+ *  Stores every stage of an atlas under the key at its index, replacing the stages held for those keys, and writes them to the disk cache.
+ *  The first key, for stage 0, is ignored.
+ *
+ *  The cost of the stages is the size of the slab of the atlas. Atlases missing stages or larger than `totalCostLimit` are not stored.
+ */
+- (void)setAtlas:(DBProfileBlurStageAtlas *)atlas forKeys:(NSArray<DBProfileBlurStageCacheKey *> *)keys;
+
+/**
+ *  Removes every stage from memory. The disk cache is left untouched.
+ */
+- (void)removeAllImages;
+
+/**
+ *  Removes the stages from memory that nothing outside of the cache holds, including stages mapped from the disk cache. Stages and atlases
+ *  still shown by a view are kept, so other views showing the same image keep finding them. The disk cache is left untouched.
+ *
+ *  The shared cache calls this when the app receives a memory warning.
+ */
+- (void)removeUnusedImages;
+
+/**
+ *  Blocks until every stage stored so far has been written to the disk cache.
+ */
+- (void)waitUntilDiskWritesFinish;
+
+/**
+ *  Resets `hitCount`, `diskHitCount` and `missCount` to 0.
+ */
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
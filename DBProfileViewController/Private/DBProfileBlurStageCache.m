@@ -0,0 +1,368 @@
+//
+//  DBProfileBlurStageCache.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurStageCache.h"
+#import "DBProfileBlurStageDiskCache.h"
+#import "DBProfileBlurStageAtlas.h"
+
+@implementation DBProfileBlurStageCacheKey
+
+- (instancetype)initWithImageDigest:(NSString *)imageDigest
+                         blurRadius:(CGFloat)blurRadius
+                         iterations:(NSUInteger)iterations
+                       pyramidLevel:(NSUInteger)pyramidLevel
+{
+    return [self initWithImageDigest:imageDigest blurRadius:blurRadius iterations:iterations pyramidLevel:pyramidLevel blurAlgorithm:DBProfileBlurAlgorithmBox visibleRect:CGRectMake(0.0, 0.0, 1.0, 1.0)];
+}
+
+- (instancetype)initWithImageDigest:(NSString *)imageDigest
+                         blurRadius:(CGFloat)blurRadius
+                         iterations:(NSUInteger)iterations
+                       pyramidLevel:(NSUInteger)pyramidLevel
+                      blurAlgorithm:(DBProfileBlurAlgorithm)blurAlgorithm
+                        visibleRect:(CGRect)visibleRect
+{
+    self = [super init];
+    if (self) {
+        _imageDigest = [imageDigest copy];
+        _blurRadius = blurRadius;
+        _iterations = iterations;
+        _pyramidLevel = pyramidLevel;
+        _blurAlgorithm = blurAlgorithm;
+
+        // Stages blurred over all of their rows are the same whatever rect they were asked for
+        _complete = CGRectGetMinY(visibleRect) <= 0.0 && CGRectGetMaxY(visibleRect) >= 1.0;
+        _visibleRect = _complete ? CGRectMake(0.0, 0.0, 1.0, 1.0) : visibleRect;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    // Keys are immutable
+    return self;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if ([self class] != [object class]) {
+        return NO;
+    }
+    __typeof(self) castObject = object;
+    return ([_imageDigest isEqualToString:castObject.imageDigest]
+            && _blurRadius == castObject.blurRadius
+            && _iterations == castObject.iterations
+            && _pyramidLevel == castObject.pyramidLevel
+            && _blurAlgorithm == castObject.blurAlgorithm
+            && CGRectEqualToRect(_visibleRect, castObject.visibleRect));
+}
+
+- (NSUInteger)hash {
+    // Equal keys must have equal hashes for dictionary lookups with a new key to find an earlier entry
+    return _imageDigest.hash ^ (@(_blurRadius).hash * 131) ^ (_iterations << 8) ^ _pyramidLevel ^ ((NSUInteger)_blurAlgorithm << 4);
+}
+
+@end
+
+@interface DBProfileBlurStageCacheEntry : NSObject
+
+@property (nonatomic) UIImage *image;
+@property (nonatomic) NSUInteger cost;
+@property (nonatomic, nullable) DBProfileBlurStageAtlas *atlas;
+@property (nonatomic, nullable) NSArray<DBProfileBlurStageCacheKey *> *atlasKeys;
+
+@end
+
+@implementation DBProfileBlurStageCacheEntry
+@end
+
+@interface DBProfileBlurStageCache ()
+
+@property (nonatomic) NSMutableDictionary<DBProfileBlurStageCacheKey *, DBProfileBlurStageCacheEntry *> *entries;
+@property (nonatomic) NSMutableOrderedSet<DBProfileBlurStageCacheKey *> *recentKeys;
+@property (nonatomic) dispatch_queue_t diskQueue;
+@property (nonatomic) NSUInteger totalCost;
+@property (nonatomic) NSUInteger hitCount;
+@property (nonatomic) NSUInteger diskHitCount;
+@property (nonatomic) NSUInteger missCount;
+
+@end
+
+@implementation DBProfileBlurStageCache
+
++ (instancetype)sharedCache {
+    static DBProfileBlurStageCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[self alloc] init];
+        [[NSNotificationCenter defaultCenter] addObserver:sharedCache
+                                                 selector:@selector(removeUnusedImages)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _totalCostLimit = 100 * 1024 * 1024;
+
+        // Keys are ordered from least to most recently used
+        self.entries = [NSMutableDictionary dictionary];
+        self.recentKeys = [NSMutableOrderedSet orderedSet];
+        
+        // Writes to the disk tier copy whole stages into mapped files, which is left to a queue that does not compete with rendering
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        self.diskQueue = dispatch_queue_create("com.devonboyer.DBProfileViewController.blurStageCache.disk", attributes);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (NSUInteger)totalCostLimit {
+    @synchronized (self) {
+        return _totalCostLimit;
+    }
+}
+
+- (void)setTotalCostLimit:(NSUInteger)totalCostLimit {
+    @synchronized (self) {
+        _totalCostLimit = totalCostLimit;
+        [self evictImagesToFitCost:0];
+    }
+}
+
+- (NSUInteger)totalCost {
+    @synchronized (self) {
+        return _totalCost;
+    }
+}
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        return self.entries.count;
+    }
+}
+
+- (NSUInteger)hitCount {
+    @synchronized (self) {
+        return _hitCount;
+    }
+}
+
+- (NSUInteger)diskHitCount {
+    @synchronized (self) {
+        return _diskHitCount;
+    }
+}
+
+- (NSUInteger)missCount {
+    @synchronized (self) {
+        return _missCount;
+    }
+}
+
+- (UIImage *)imageForKey:(DBProfileBlurStageCacheKey *)key {
+    @synchronized (self) {
+        DBProfileBlurStageCacheEntry *entry = self.entries[key];
+        if (entry) {
+            _hitCount++;
+            [self.recentKeys removeObject:key];
+            [self.recentKeys addObject:key];
+            return entry.image;
+        }
+    }
+
+    // The disk is read outside of the lock so that lookups of stages held in memory are never blocked by it
+    UIImage *image = [self.diskCache imageForKey:key];
+
+    @synchronized (self) {
+        if (!image) {
+            _missCount++;
+            return nil;
+        }
+        _hitCount++;
+        _diskHitCount++;
+        [self storeImage:image forKey:key];
+        return image;
+    }
+}
+
+- (void)setImage:(UIImage *)image forKey:(DBProfileBlurStageCacheKey *)key {
+    NSParameterAssert(image);
+
+    @synchronized (self) {
+        [self storeImage:image forKey:key];
+    }
+    
+    DBProfileBlurStageDiskCache *diskCache = self.diskCache;
+    if (!diskCache) return;
+    dispatch_async(self.diskQueue, ^{
+        [diskCache setImage:image forKey:key];
+    });
+}
+
+- (DBProfileBlurStageAtlas *)atlasForKeys:(NSArray<DBProfileBlurStageCacheKey *> *)keys {
+    @synchronized (self) {
+        DBProfileBlurStageAtlas *atlas = keys.count > 1 ? self.entries[keys.lastObject].atlas : nil;
+        for (NSUInteger stage = 1; stage < keys.count && atlas; stage++) {
+            if (self.entries[keys[stage]].atlas != atlas) atlas = nil;
+        }
+        if (!atlas || atlas.numberOfStages != keys.count) {
+            _missCount++;
+            return nil;
+        }
+
+        _hitCount++;
+        for (NSUInteger stage = 1; stage < keys.count; stage++) {
+            [self.recentKeys removeObject:keys[stage]];
+            [self.recentKeys addObject:keys[stage]];
+        }
+        return atlas;
+    }
+}
+
+- (void)setAtlas:(DBProfileBlurStageAtlas *)atlas forKeys:(NSArray<DBProfileBlurStageCacheKey *> *)keys {
+    NSParameterAssert(atlas.numberOfStages == keys.count);
+    if (!atlas.isComplete || atlas.numberOfStages != keys.count) return;
+
+    NSArray<DBProfileBlurStageCacheKey *> *atlasKeys = [keys subarrayWithRange:NSMakeRange(1, keys.count - 1)];
+    @synchronized (self) {
+        for (DBProfileBlurStageCacheKey *key in atlasKeys) [self removeImageForKey:key];
+        if (_totalCostLimit > 0 && atlas.byteCount > _totalCostLimit) return;
+
+        [self evictImagesToFitCost:atlas.byteCount];
+        for (NSUInteger stage = 1; stage < keys.count; stage++) {
+            DBProfileBlurStageCacheEntry *entry = [[DBProfileBlurStageCacheEntry alloc] init];
+            entry.image = [atlas imageForStage:stage];
+            entry.cost = [atlas byteCountForStage:stage];
+            entry.atlas = atlas;
+            entry.atlasKeys = atlasKeys;
+            self.entries[keys[stage]] = entry;
+            [self.recentKeys addObject:keys[stage]];
+            _totalCost += entry.cost;
+        }
+    }
+
+    DBProfileBlurStageDiskCache *diskCache = self.diskCache;
+    if (!diskCache) return;
+    dispatch_async(self.diskQueue, ^{
+        for (NSUInteger stage = 1; stage < keys.count; stage++) {
+            @autoreleasepool {
+                [diskCache setImage:[atlas imageForStage:stage] forKey:keys[stage]];
+            }
+        }
+    });
+}
+
+- (void)removeAllImages {
+    @synchronized (self) {
+        [self.entries removeAllObjects];
+        [self.recentKeys removeAllObjects];
+        _totalCost = 0;
+    }
+}
+
+- (void)removeUnusedImages {
+    @synchronized (self) {
+        // Only weak references to the stages are kept while the cache lets go of them, so the stages nothing else holds are freed at once
+        NSArray<DBProfileBlurStageCacheKey *> *recentKeys = self.recentKeys.array;
+        NSMapTable<DBProfileBlurStageCacheKey *, UIImage *> *images = [NSMapTable strongToWeakObjectsMapTable];
+        NSMapTable<DBProfileBlurStageCacheKey *, DBProfileBlurStageAtlas *> *atlases = [NSMapTable strongToWeakObjectsMapTable];
+        NSMutableDictionary<DBProfileBlurStageCacheKey *, NSArray<DBProfileBlurStageCacheKey *> *> *atlasKeys = [NSMutableDictionary dictionary];
+        for (DBProfileBlurStageCacheKey *key in recentKeys) {
+            DBProfileBlurStageCacheEntry *entry = self.entries[key];
+            [images setObject:entry.image forKey:key];
+            if (entry.atlas) {
+                [atlases setObject:entry.atlas forKey:key];
+                atlasKeys[key] = entry.atlasKeys;
+            }
+        }
+        
+        @autoreleasepool {
+            [self removeAllImages];
+        }
+        
+        // The stages still alive are held by a view, freeing them would not save any memory, so they are stored again in the same order
+        for (DBProfileBlurStageCacheKey *key in recentKeys) {
+            DBProfileBlurStageAtlas *atlas = [atlases objectForKey:key];
+            if (atlas) {
+                NSUInteger stage = [atlasKeys[key] indexOfObject:key] + 1;
+                DBProfileBlurStageCacheEntry *entry = [[DBProfileBlurStageCacheEntry alloc] init];
+                entry.image = [images objectForKey:key] ?: [atlas imageForStage:stage];
+                entry.cost = [atlas byteCountForStage:stage];
+                entry.atlas = atlas;
+                entry.atlasKeys = atlasKeys[key];
+                self.entries[key] = entry;
+                [self.recentKeys addObject:key];
+                _totalCost += entry.cost;
+            }
+            else if (!atlasKeys[key]) {
+                UIImage *image = [images objectForKey:key];
+                if (image) [self storeImage:image forKey:key];
+            }
+        }
+    }
+}
+
+- (void)waitUntilDiskWritesFinish {
+    dispatch_sync(self.diskQueue, ^{});
+}
+
+- (void)resetStatistics {
+    @synchronized (self) {
+        _hitCount = 0;
+        _diskHitCount = 0;
+        _missCount = 0;
+    }
+}
+
+#pragma mark - Eviction
+
+- (void)storeImage:(UIImage *)image forKey:(DBProfileBlurStageCacheKey *)key {
+    DBProfileBlurStageCacheEntry *entry = [[DBProfileBlurStageCacheEntry alloc] init];
+    entry.image = image;
+    entry.cost = CGImageGetBytesPerRow(image.CGImage) * CGImageGetHeight(image.CGImage);
+
+    [self removeImageForKey:key];
+    if (_totalCostLimit > 0 && entry.cost > _totalCostLimit) return;
+
+    [self evictImagesToFitCost:entry.cost];
+    self.entries[key] = entry;
+    [self.recentKeys addObject:key];
+    _totalCost += entry.cost;
+}
+
+- (void)removeImageForKey:(DBProfileBlurStageCacheKey *)key {
+    DBProfileBlurStageCacheEntry *entry = self.entries[key];
+    if (!entry) return;
+
+    // The slab of an atlas is only freed once all of its stages are gone, so they leave together
+    NSArray<DBProfileBlurStageCacheKey *> *keys = entry.atlas ? entry.atlasKeys : @[key];
+    for (DBProfileBlurStageCacheKey *removedKey in keys) {
+        DBProfileBlurStageCacheEntry *removedEntry = self.entries[removedKey];
+        if (!removedEntry || removedEntry.atlas != entry.atlas) continue;
+        _totalCost -= removedEntry.cost;
+        [self.entries removeObjectForKey:removedKey];
+        [self.recentKeys removeObject:removedKey];
+    }
+}
+
+- (void)evictImagesToFitCost:(NSUInteger)cost {
+    if (_totalCostLimit == 0) return;
+    while (self.recentKeys.count > 0 && _totalCost + cost > _totalCostLimit) {
+        [self removeImageForKey:self.recentKeys.firstObject];
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  DBProfileBlurStageDiskCache.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+@class DBProfileBlurStageCacheKey;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurStageDiskCache` class persists blurred stages across launches.
+ *
+ *  Every stage is stored as an uncompressed bitmap behind a small header. Stored stages are memory-mapped and wrapped as images without being
+ *  decoded or copied, so showing them costs no CPU time. Files written by a different version of the format are ignored and removed.
+ *
+ *  The least recently used files are removed once the files exceed `totalSizeLimit`. All methods are safe to call from any thread.
+ */
+@interface DBProfileBlurStageDiskCache : NSObject
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  A disk cache in the app's caches directory.
+ */
++ (instancetype)defaultDiskCache;
+
+/**
+ *  The directory the stages are stored in. It is created when the first stage is stored.
+ */
+@property (nonatomic, readonly) NSURL *directoryURL;
+
+/**
+ *  The largest number of bytes of files to keep before removing the least recently used ones.
+ *
+ *  Defaults to 50 MB. A limit of 0 means there is no limit.
+ */
+@property (nonatomic) NSUInteger totalSizeLimit;
+
+/**
+ *  The number of bytes of files in the directory.
+ */
+@property (nonatomic, readonly) NSUInteger totalSize;
+
+/**
+ *  The file the stage for the specified key is stored in, or nil if the key cannot be stored.
+ */
+- (nullable NSURL *)fileURLForKey:(DBProfileBlurStageCacheKey *)key;
+
+/**
+ *  Returns the stored stage for the specified key, backed by the memory-mapped file, or nil if there is no valid file for it.
+ */
+- (nullable UIImage *)imageForKey:(DBProfileBlurStageCacheKey *)key;
+
+/**
+ *  Stores a stage, replacing any earlier file for the key. Images that are not 8-bit, 4 channel bitmaps are not stored.
+ */
+- (void)setImage:(UIImage *)image forKey:(DBProfileBlurStageCacheKey *)key;
+
+/**
+ *  Removes every stored stage.
+ */
+- (void)removeAllImages;
+
+@end
+
+NS_ASSUME_NONNULL_END
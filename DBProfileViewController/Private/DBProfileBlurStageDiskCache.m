@@ -0,0 +1,304 @@
+//
+//  DBProfileBlurStageDiskCache.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurStageDiskCache.h"
+#import "DBProfileBlurStageCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Bump the version whenever the layout of the files or the pixels of the stages change
+static const uint32_t DBProfileBlurStageFileMagic = 0x53424244; // "DBBS"
+static const uint32_t DBProfileBlurStageFileVersion = 2;
+
+// The pixels start after a fixed size header so that they stay aligned
+static const size_t DBProfileBlurStageFileHeaderSize = 64;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowBytes;
+    uint32_t bitmapInfo;
+    int32_t orientation;
+    uint32_t colorSpace;
+    double scale;
+    uint64_t dataLength;
+} DBProfileBlurStageFileHeader;
+
+// Stages keep the color space of the image they were blurred from, which is recorded as one of these
+typedef NS_ENUM(uint32_t, DBProfileBlurStageFileColorSpace) {
+    DBProfileBlurStageFileColorSpaceUnknown = 0,
+    DBProfileBlurStageFileColorSpaceDeviceRGB,
+    DBProfileBlurStageFileColorSpaceSRGB,
+    DBProfileBlurStageFileColorSpaceDisplayP3,
+};
+
+static CGColorSpaceRef DBProfileBlurStageFileCreateColorSpace(DBProfileBlurStageFileColorSpace colorSpace) {
+    switch (colorSpace) {
+        case DBProfileBlurStageFileColorSpaceDeviceRGB:
+            return CGColorSpaceCreateDeviceRGB();
+        case DBProfileBlurStageFileColorSpaceSRGB:
+            // Named color spaces are weakly linked before iOS 9
+            return (&kCGColorSpaceSRGB != NULL) ? CGColorSpaceCreateWithName(kCGColorSpaceSRGB) : NULL;
+        case DBProfileBlurStageFileColorSpaceDisplayP3:
+            return (&kCGColorSpaceDisplayP3 != NULL) ? CGColorSpaceCreateWithName(kCGColorSpaceDisplayP3) : NULL;
+        default:
+            return NULL;
+    }
+}
+
+static DBProfileBlurStageFileColorSpace DBProfileBlurStageFileColorSpaceOfImage(CGImageRef imageRef) {
+    CGColorSpaceRef imageColorSpace = CGImageGetColorSpace(imageRef);
+    if (!imageColorSpace) return DBProfileBlurStageFileColorSpaceUnknown;
+
+    DBProfileBlurStageFileColorSpace colorSpaces[] = {DBProfileBlurStageFileColorSpaceDeviceRGB, DBProfileBlurStageFileColorSpaceSRGB, DBProfileBlurStageFileColorSpaceDisplayP3};
+    for (size_t i = 0; i < sizeof(colorSpaces) / sizeof(colorSpaces[0]); i++) {
+        CGColorSpaceRef colorSpace = DBProfileBlurStageFileCreateColorSpace(colorSpaces[i]);
+        BOOL isEqual = (colorSpace && CFEqual(colorSpace, imageColorSpace));
+        CGColorSpaceRelease(colorSpace);
+        if (isEqual) return colorSpaces[i];
+    }
+    return DBProfileBlurStageFileColorSpaceUnknown;
+}
+
+static void DBProfileBlurStageFileUnmap(void *info, const void *data, size_t size) {
+    munmap((uint8_t *)data - DBProfileBlurStageFileHeaderSize, size + DBProfileBlurStageFileHeaderSize);
+}
+
+@interface DBProfileBlurStageDiskCache ()
+
+@property (nonatomic) NSUInteger totalSize;
+@property (nonatomic) BOOL hasMeasuredTotalSize;
+
+@end
+
+@implementation DBProfileBlurStageDiskCache
+
++ (instancetype)defaultDiskCache {
+    static DBProfileBlurStageDiskCache *defaultDiskCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSURL *cachesURL = [[[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+        defaultDiskCache = [[self alloc] initWithDirectoryURL:[cachesURL URLByAppendingPathComponent:@"DBProfileBlurStages" isDirectory:YES]];
+    });
+    return defaultDiskCache;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _totalSizeLimit = 50 * 1024 * 1024;
+    }
+    return self;
+}
+
+- (NSUInteger)totalSizeLimit {
+    @synchronized (self) {
+        return _totalSizeLimit;
+    }
+}
+
+- (void)setTotalSizeLimit:(NSUInteger)totalSizeLimit {
+    @synchronized (self) {
+        _totalSizeLimit = totalSizeLimit;
+        [self removeFilesToFitSize:0];
+    }
+}
+
+- (NSUInteger)totalSize {
+    @synchronized (self) {
+        [self measureTotalSizeIfNeeded];
+        return _totalSize;
+    }
+}
+
+- (NSURL *)fileURLForKey:(DBProfileBlurStageCacheKey *)key {
+    // Partly blurred stages depend on the layout of the view that rendered them, so only whole stages are kept
+    if (!key.isComplete) return nil;
+
+    NSString *fileName = [NSString stringWithFormat:@"%@-%g-%lu-%lu.stage",
+                          key.imageDigest, key.blurRadius, (unsigned long)key.iterations, (unsigned long)key.pyramidLevel];
+
+    // Box stages keep the names they were written with before other algorithms existed
+    if (key.blurAlgorithm != DBProfileBlurAlgorithmBox) {
+        fileName = [fileName.stringByDeletingPathExtension stringByAppendingFormat:@"-a%ld.stage", (long)key.blurAlgorithm];
+    }
+    return [self.directoryURL URLByAppendingPathComponent:fileName isDirectory:NO];
+}
+
+- (UIImage *)imageForKey:(DBProfileBlurStageCacheKey *)key {
+    NSURL *fileURL = [self fileURLForKey:key];
+    if (!fileURL) return nil;
+
+    int fd = open(fileURL.fileSystemRepresentation, O_RDONLY);
+    if (fd < 0) return nil;
+
+    struct stat fileStat;
+    DBProfileBlurStageFileHeader header;
+    BOOL isValid = (fstat(fd, &fileStat) == 0
+                    && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                    && header.magic == DBProfileBlurStageFileMagic
+                    && header.version == DBProfileBlurStageFileVersion
+                    && header.width > 0 && header.height > 0
+                    && header.rowBytes >= header.width * 4
+                    && header.dataLength == (uint64_t)header.rowBytes * header.height
+                    && (uint64_t)fileStat.st_size >= DBProfileBlurStageFileHeaderSize + header.dataLength);
+    if (!isValid) {
+        // Files from an earlier format, or truncated files, are never going to be readable
+        close(fd);
+        [self removeFileAtURL:fileURL];
+        return nil;
+    }
+
+    size_t length = DBProfileBlurStageFileHeaderSize + (size_t)header.dataLength;
+    void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // Reading a file makes it the most recently used
+    futimes(fd, NULL);
+    close(fd);
+    if (base == MAP_FAILED) return nil;
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, (uint8_t *)base + DBProfileBlurStageFileHeaderSize, (size_t)header.dataLength, DBProfileBlurStageFileUnmap);
+    CGColorSpaceRef colorSpace = DBProfileBlurStageFileCreateColorSpace(header.colorSpace);
+    if (!colorSpace) {
+        CGDataProviderRelease(provider);
+        return nil;
+    }
+    CGImageRef imageRef = CGImageCreate(header.width, header.height, 8, 32, header.rowBytes, colorSpace, (CGBitmapInfo)header.bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+    if (!imageRef) return nil;
+
+    UIImage *image = [UIImage imageWithCGImage:imageRef scale:header.scale orientation:(UIImageOrientation)header.orientation];
+    CGImageRelease(imageRef);
+    return image;
+}
+
+- (void)setImage:(UIImage *)image forKey:(DBProfileBlurStageCacheKey *)key {
+    NSURL *fileURL = [self fileURLForKey:key];
+    CGImageRef imageRef = image.CGImage;
+    if (!fileURL || !imageRef || CGImageGetBitsPerComponent(imageRef) != 8 || CGImageGetBitsPerPixel(imageRef) != 32) return;
+
+    // Stages in a color space that cannot be recreated when they are read would show the wrong colors, so they are not kept
+    DBProfileBlurStageFileColorSpace colorSpace = DBProfileBlurStageFileColorSpaceOfImage(imageRef);
+    if (colorSpace == DBProfileBlurStageFileColorSpaceUnknown) return;
+
+    DBProfileBlurStageFileHeader header = {0};
+    header.magic = DBProfileBlurStageFileMagic;
+    header.version = DBProfileBlurStageFileVersion;
+    header.width = (uint32_t)CGImageGetWidth(imageRef);
+    header.height = (uint32_t)CGImageGetHeight(imageRef);
+    header.rowBytes = (uint32_t)CGImageGetBytesPerRow(imageRef);
+    header.bitmapInfo = CGImageGetBitmapInfo(imageRef);
+    header.orientation = (int32_t)image.imageOrientation;
+    header.colorSpace = colorSpace;
+    header.scale = image.scale;
+    header.dataLength = (uint64_t)header.rowBytes * header.height;
+
+    CFDataRef dataSource = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    if (!dataSource) return;
+    if ((uint64_t)CFDataGetLength(dataSource) < header.dataLength) {
+        CFRelease(dataSource);
+        return;
+    }
+
+    uint8_t headerBytes[DBProfileBlurStageFileHeaderSize] = {0};
+    memcpy(headerBytes, &header, sizeof(header));
+
+    @synchronized (self) {
+        [self measureTotalSizeIfNeeded];
+        [[NSFileManager defaultManager] createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+
+        // Files are written next to their final location and renamed, so readers never see a partially written file
+        NSString *temporaryPath = [fileURL.path stringByAppendingPathExtension:@"tmp"];
+        int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        BOOL didWrite = NO;
+        if (fd >= 0) {
+            didWrite = (write(fd, headerBytes, sizeof(headerBytes)) == sizeof(headerBytes)
+                        && write(fd, CFDataGetBytePtr(dataSource), (size_t)header.dataLength) == (ssize_t)header.dataLength);
+            close(fd);
+        }
+
+        if (didWrite) {
+            NSUInteger fileSize = DBProfileBlurStageFileHeaderSize + (NSUInteger)header.dataLength;
+            [self removeFileAtURL:fileURL];
+            [self removeFilesToFitSize:fileSize];
+            if (rename(temporaryPath.fileSystemRepresentation, fileURL.fileSystemRepresentation) == 0) {
+                _totalSize += fileSize;
+            }
+        }
+        unlink(temporaryPath.fileSystemRepresentation);
+    }
+    CFRelease(dataSource);
+}
+
+- (void)removeAllImages {
+    @synchronized (self) {
+        [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+        _totalSize = 0;
+        self.hasMeasuredTotalSize = YES;
+    }
+}
+
+#pragma mark - Eviction
+
+- (NSArray<NSURL *> *)fileURLs {
+    NSArray *keys = @[NSURLContentModificationDateKey, NSURLFileSizeKey];
+    NSArray<NSURL *> *fileURLs = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:keys options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+    return [fileURLs filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"pathExtension == 'stage'"]];
+}
+
+- (NSUInteger)fileSizeAtURL:(NSURL *)fileURL {
+    NSNumber *fileSize;
+    [fileURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:nil];
+    return fileSize.unsignedIntegerValue;
+}
+
+- (void)measureTotalSizeIfNeeded {
+    if (self.hasMeasuredTotalSize) return;
+    self.hasMeasuredTotalSize = YES;
+
+    _totalSize = 0;
+    for (NSURL *fileURL in [self fileURLs]) {
+        _totalSize += [self fileSizeAtURL:fileURL];
+    }
+}
+
+- (void)removeFileAtURL:(NSURL *)fileURL {
+    @synchronized (self) {
+        NSUInteger fileSize = [self fileSizeAtURL:fileURL];
+        if (unlink(fileURL.fileSystemRepresentation) == 0 && self.hasMeasuredTotalSize) {
+            _totalSize -= MIN(fileSize, _totalSize);
+        }
+    }
+}
+
+- (void)removeFilesToFitSize:(NSUInteger)size {
+    [self measureTotalSizeIfNeeded];
+    if (_totalSizeLimit == 0 || _totalSize + size <= _totalSizeLimit) return;
+
+    // Reading a file touches its modification date, so the oldest files are the least recently used
+    NSArray<NSURL *> *fileURLs = [[self fileURLs] sortedArrayUsingComparator:^NSComparisonResult(NSURL *fileURL1, NSURL *fileURL2) {
+        NSDate *date1, *date2;
+        [fileURL1 getResourceValue:&date1 forKey:NSURLContentModificationDateKey error:nil];
+        [fileURL2 getResourceValue:&date2 forKey:NSURLContentModificationDateKey error:nil];
+        return [date1 compare:date2];
+    }];
+    for (NSURL *fileURL in fileURLs) {
+        if (_totalSize + size <= _totalSizeLimit) break;
+        [self removeFileAtURL:fileURL];
+    }
+}
+
+@end
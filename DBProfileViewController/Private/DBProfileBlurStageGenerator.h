@@ -0,0 +1,178 @@
+//
+//  DBProfileBlurStageGenerator.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurView.h"
+#import "DBProfileBlurSourceImage.h"
+#import "DBProfileBlurStageAtlas.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurStageGenerator` class generates the blurred stages of an image in a single progressive chain.
+ *
+ *  Each stage is blurred from the previous stage with one small box convolution, rather than from the original image with `iterations` convolutions.
+ *  Because variances add, every stage keeps the overall blur of the corresponding independently blurred image.
+ *
+ *  The chain holds two full-size copies of the image. Images for which they do not fit the `workingBytesLimit` of the shared
+ *  `DBProfileBlurBufferPool`, such as uncropped cover photos, are instead rendered one stage at a time as `imageForStage:blurRadius:` does,
+ *  streamed from the image in strips of rows straight into the stage. This costs more work per stage but bounds the memory held besides the
+ *  image and its stages, whatever the renderer and algorithm.
+ */
+@interface DBProfileBlurStageGenerator : NSObject
+
+- (instancetype)initWithImage:(UIImage *)image;
+
+/**
+ *  Creates a generator that reads the pixels of a source image, which may be shared with other generators so the image is decoded only once.
+ */
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The variance, in pixels, of an image with the specified scale blurred with `blurRadius` and `iterations` box convolutions.
+ */
++ (double)varianceForBlurRadius:(CGFloat)blurRadius scale:(CGFloat)scale iterations:(NSUInteger)iterations;
+
+/**
+ *  The image representing stage 0.
+ */
+@property (nonatomic, readonly) UIImage *image;
+
+/**
+ *  The pixels every stage is blurred from.
+ */
+@property (nonatomic, readonly) DBProfileBlurSourceImage *sourceImage;
+
+/**
+ *  A digest of the pixels, dimensions and scale of the image, computed once. Images with equal digests have equal stages.
+ *
+ *  This is used to share stages between generators through a `DBProfileBlurStageCache`.
+ */
+@property (nonatomic, readonly) NSString *imageDigest;
+
+/**
+ *  The engine used to render stages.
+ *
+ *  Defaults to `DBProfileBlurStageRendererProgressive`.
+ */
+@property (nonatomic) DBProfileBlurStageRenderer renderer;
+
+/**
+ *  The algorithm that blurs stages rendered by `DBProfileBlurStageRendererProgressive` and by `imageForStage:blurRadius:`. Every algorithm
+ *  blurs a stage with the variance of `iterations` box convolutions, so a blur radius looks about the same whatever the algorithm.
+ *
+ *  Box stages are blurred from the previous stage, the other algorithms cost the same for any variance and render each stage from the image
+ *  on a single thread. The summed-area table renderer ignores this property. See `DBProfileBlurAlgorithm` for the cost and quality of each.
+ *
+ *  Defaults to `DBProfileBlurAlgorithmBox`.
+ */
+@property (nonatomic) DBProfileBlurAlgorithm blurAlgorithm;
+
+/**
+ *  The part of the image that is on screen while the stages are shown, in the unit coordinate space of the image, where (0, 0) is the top
+ *  left corner and (1, 1) the bottom right one, like `-[CALayer contentsRect]`.
+ *
+ *  Only the rows of a stage within the rect are blurred, together with a halo three standard deviations of the largest blur tall, so the
+ *  visible rows match those of a stage blurred over the whole image to within a level. The other rows of the stage repeat the nearest
+ *  blurred row, so neither the stage nor the deeper levels shrunk from it ever show pixels that were not blurred.
+ *  The summed-area table renderer needs no halo and renders the visible rows exactly.
+ *
+ *  Defaults to the whole image.
+ */
+@property (nonatomic) CGRect visibleRect;
+
+/**
+ *  The deepest pyramid level that stages may be rendered and stored at, up to `DBProfileBlurPyramidMaximumLevel`.
+ *
+ *  Stages whose blur removes all detail finer than 2^n pixels are computed on buffers shrunk by 2^n in each dimension and keep the original size in points.
+ *
+ *  Defaults to 0, which renders every stage at full resolution.
+ */
+@property (nonatomic) NSUInteger maximumPyramidLevel;
+
+/**
+ *  The pyramid level of every stage, in ascending order, overriding the levels chosen from `maximumPyramidLevel`.
+ *
+ *  This is typically provided by a `DBProfileBlurStagePlan`.
+ */
+@property (nonatomic, copy, nullable) NSArray<NSNumber *> *pyramidLevels;
+
+/**
+ *  The number of box convolutions of the independently blurred image that each stage matches.
+ *
+ *  Defaults to 5.
+ */
+@property (nonatomic) NSUInteger iterations;
+
+/**
+ *  The largest number of threads that render a single stage. Stages are split into horizontal strips that are blurred concurrently,
+ *  and every strip matches the same rows of a stage rendered on a single thread exactly.
+ *
+ *  Defaults to the number of active processors. A value of 1 renders every stage on the calling thread.
+ */
+@property (nonatomic) NSUInteger numberOfWorkers;
+
+/**
+ *  The tint color applied to every generated stage. The tint is never accumulated along the chain.
+ */
+@property (nonatomic, nullable) UIColor *tintColor;
+
+/**
+ *  An atlas that stages are written into, created with the same source image and pyramid levels.
+ *
+ *  When set, every stage is copied into its region of the atlas and the images passed to blocks and returned by `imageForStage:blurRadius:`
+ *  are the images of the atlas, rather than images with pixels of their own. `tintColor` is not applied to stages written into an atlas.
+ *
+ *  Defaults to nil.
+ */
+@property (nonatomic, nullable) DBProfileBlurStageAtlas *atlas;
+
+/**
+ *  The number of box convolutions performed by this generator so far. Summed-area table stages are not counted.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfConvolutions;
+
+/**
+ *  Generates one blurred image for every blur radius, in order.
+ *
+ *  @param blurRadii The blur radius of each stage, in points. Must be in ascending order.
+ *  @param block The block called with each stage as soon as it has been generated. Set `stop` to YES to stop generating stages.
+ */
+- (void)generateStagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii usingBlock:(void (^)(NSUInteger stage, UIImage *blurredImage, BOOL *stop))block;
+
+/**
+ *  Generates one blurred image for every blur radius, in order, except for the skipped stages.
+ *
+ *  Skipped stages are still blurred when later stages are built from them, but no image is created for them.
+ */
+- (void)generateStagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii skippingStages:(nullable NSIndexSet *)skippedStages usingBlock:(void (^)(NSUInteger stage, UIImage *blurredImage, BOOL *stop))block;
+
+/**
+ *  Renders a single stage directly from the image, without rendering the stages before it.
+ *
+ *  This costs three box convolutions at the stage's pyramid level, and is intended for the few stages that are needed before the rest.
+ */
+- (UIImage *)imageForStage:(NSUInteger)stage blurRadius:(CGFloat)blurRadius;
+
+/**
+ *  Renders a preview of every stage at 1/8 of the resolution of the image, which takes a few milliseconds even for a large image.
+ *
+ *  The image is read once and shrunk without being copied, then every preview is blurred from the previous one with a single box
+ *  convolution on 1/64 of the pixels. Previews match the variance of their stages but the lightest ones are softer, as the shrinking
+ *  alone blurs more than they do. Previews keep the size of the image in points and cover the whole image whatever `visibleRect` is.
+ *  They are intended to be shown until the stages have been rendered.
+ *
+ *  @return One image for every blur radius, in order. Stages without blur are the image itself.
+ */
+- (NSArray<UIImage *> *)previewImagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii;
+
+@end
+
+NS_ASSUME_NONNULL_END
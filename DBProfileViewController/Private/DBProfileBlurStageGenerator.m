@@ -0,0 +1,608 @@
+//
+//  DBProfileBlurStageGenerator.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurStageGenerator.h"
+#import "DBProfileBlurKernel.h"
+#import "UIImage+DBProfileViewController.h"
+#import "DBProfileBlurBufferPool.h"
+
+// Strips shorter than this spend too much of their time summing the halo rows they share with their neighbours
+static const size_t DBProfileBlurStageGeneratorMinimumStripHeight = 64;
+
+// Less than 0.2% of a Gaussian lies beyond three standard deviations, so clamping the rows there barely changes the visible rows
+static const double DBProfileBlurStageGeneratorHaloDeviations = 3.0;
+
+// Previews are blurred at 1/8 of the resolution, where every stage costs 1/64 of the full-resolution work
+static const size_t DBProfileBlurStageGeneratorPreviewLevel = 3;
+
+static DBProfileBlurBuffer DBProfileBlurStageGeneratorBufferRows(const DBProfileBlurBuffer *buffer, NSRange rows) {
+    DBProfileBlurBuffer subBuffer = *buffer;
+    subBuffer.data = buffer->data + rows.location * buffer->rowBytes;
+    subBuffer.height = rows.length;
+    return subBuffer;
+}
+
+// Rows outside the blurred ones hold the unblurred source or whatever the pooled buffer held before, so they repeat the nearest blurred row
+static void DBProfileBlurStageGeneratorClampRows(const DBProfileBlurBuffer *buffer, NSRange rows) {
+    if (rows.length == 0 || (rows.location == 0 && rows.length >= buffer->height)) return;
+    const uint8_t *firstRow = buffer->data + rows.location * buffer->rowBytes;
+    const uint8_t *lastRow = buffer->data + (NSMaxRange(rows) - 1) * buffer->rowBytes;
+    for (size_t row = 0; row < rows.location; row++) {
+        memcpy(buffer->data + row * buffer->rowBytes, firstRow, buffer->rowBytes);
+    }
+    for (size_t row = NSMaxRange(rows); row < buffer->height; row++) {
+        memcpy(buffer->data + row * buffer->rowBytes, lastRow, buffer->rowBytes);
+    }
+}
+
+@implementation DBProfileBlurStageGenerator
+
+- (instancetype)initWithImage:(UIImage *)image {
+    return [self initWithSourceImage:[[DBProfileBlurSourceImage alloc] initWithImage:image]];
+}
+
+- (instancetype)initWithSourceImage:(DBProfileBlurSourceImage *)sourceImage {
+    self = [super init];
+    if (self) {
+        _sourceImage = sourceImage;
+        _visibleRect = CGRectMake(0.0, 0.0, 1.0, 1.0);
+        _iterations = 5;
+        _numberOfWorkers = [NSProcessInfo processInfo].activeProcessorCount;
+    }
+    return self;
+}
+
++ (double)varianceForBlurRadius:(CGFloat)blurRadius scale:(CGFloat)scale iterations:(NSUInteger)iterations {
+    // Matches the box size used by -[UIImage db_blurredImageWithRadius:iterations:tintColor:]
+    uint32_t boxSize = (uint32_t)(blurRadius * scale);
+    if (boxSize <= 1) return 0.0;
+    return DBProfileBlurBoxVariance(boxSize, iterations);
+}
+
+- (double)targetVarianceForBlurRadius:(CGFloat)blurRadius {
+    return [[self class] varianceForBlurRadius:blurRadius scale:self.image.scale iterations:self.iterations];
+}
+
+- (size_t)pyramidLevelForStage:(NSUInteger)stage variance:(double)variance {
+    if (self.pyramidLevels) {
+        NSAssert(stage < self.pyramidLevels.count, @"there must be a pyramid level for every stage");
+        return MIN([self.pyramidLevels[stage] unsignedIntegerValue], DBProfileBlurPyramidMaximumLevel);
+    }
+    return DBProfileBlurPyramidLevelForVariance(variance, self.maximumPyramidLevel);
+}
+
+- (NSRange)rowsToBlurInBuffer:(const DBProfileBlurBuffer *)buffer variance:(double)variance level:(size_t)level {
+    CGRect visibleRect = CGRectIntersection(self.visibleRect, CGRectMake(0.0, 0.0, 1.0, 1.0));
+    if (CGRectIsEmpty(visibleRect) || (CGRectGetMinY(visibleRect) <= 0.0 && CGRectGetMaxY(visibleRect) >= 1.0)) return NSMakeRange(0, buffer->height);
+    
+    // The halo is measured in pixels of the level, one row more covers the rounding of the rect
+    double halo = variance > 0.0 ? ceil(DBProfileBlurStageGeneratorHaloDeviations * sqrt(variance) / (double)(1u << level)) + 1.0 : 0.0;
+    double firstRow = MAX(floor(CGRectGetMinY(visibleRect) * buffer->height) - halo, 0.0);
+    double lastRow = MIN(ceil(CGRectGetMaxY(visibleRect) * buffer->height) + halo, (double)buffer->height);
+    return NSMakeRange((NSUInteger)firstRow, (NSUInteger)MAX(lastRow - firstRow, 1.0));
+}
+
+- (UIImage *)image {
+    return self.sourceImage.image;
+}
+
+- (NSString *)imageDigest {
+    return self.sourceImage.imageDigest;
+}
+
+- (size_t)bufferSize {
+    // Downsampling shrinks the buffers in place, so they are always allocated and recycled with the size of the source
+    DBProfileBlurBuffer source = self.sourceImage.buffer;
+    return source.rowBytes * source.height;
+}
+
+- (UIImage *)imageWithBuffer:(const DBProfileBlurBuffer *)buffer {
+    // Downsampled stages keep the size of the original image in points so image views scale them back up
+    UIImage *normalizedImage = self.sourceImage.normalizedImage;
+    CGFloat scale = normalizedImage.scale * buffer->width / self.sourceImage.buffer.width;
+    return [normalizedImage db_imageWithBlurBuffer:buffer scale:scale tintColor:self.tintColor];
+}
+
+- (UIImage *)imageWithBuffer:(const DBProfileBlurBuffer *)buffer stage:(NSUInteger)stage {
+    // Stages of an atlas are copied straight into its slab rather than into a buffer of their own
+    UIImage *image = [self.atlas setBuffer:buffer forStage:stage];
+    return image ?: [self imageWithBuffer:buffer];
+}
+
+- (UIImage *)imageByTakingBuffer:(const DBProfileBlurBuffer *)buffer {
+    UIImage *normalizedImage = self.sourceImage.normalizedImage;
+    CGFloat scale = normalizedImage.scale * buffer->width / self.sourceImage.buffer.width;
+    return [normalizedImage db_imageByTakingBlurBuffer:buffer allocatedSize:[self bufferSize] scale:scale tintColor:self.tintColor];
+}
+
+- (BOOL)loadBuffer:(DBProfileBlurBuffer *)buffer scratch:(DBProfileBlurBuffer *)scratch {
+    // Image must be nonzero size
+    if (floorf(self.image.size.width) * floorf(self.image.size.height) <= 0.0f) return NO;
+    
+    // The source was decoded once, the working buffers only copy it because the blur overwrites them
+    DBProfileBlurBuffer source = self.sourceImage.buffer;
+    if (!source.data) return NO;
+    *buffer = *scratch = source;
+    size_t bytes = [self bufferSize];
+    buffer->data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:bytes];
+    scratch->data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:bytes];
+    memcpy(buffer->data, source.data, bytes);
+    return YES;
+}
+
+- (void)recycleBuffer:(DBProfileBlurBuffer *)buffer {
+    [[DBProfileBlurBufferPool sharedPool] recycleBuffer:buffer->data size:[self bufferSize]];
+}
+
+- (void)enumerateStripsOfBuffer:(const DBProfileBlurBuffer *)buffer usingBlock:(void (^)(size_t firstRow, size_t numberOfRows))block {
+    [self enumerateStripsOfRows:NSMakeRange(0, buffer->height) usingBlock:block];
+}
+
+- (void)enumerateStripsOfRows:(NSRange)rows usingBlock:(void (^)(size_t firstRow, size_t numberOfRows))block {
+    [self enumerateStripsOfRows:rows numberOfWorkers:MAX(self.numberOfWorkers, 1) usingBlock:block];
+}
+
+- (void)enumerateStripsOfRows:(NSRange)rows numberOfWorkers:(size_t)numberOfWorkers usingBlock:(void (^)(size_t firstRow, size_t numberOfRows))block {
+    size_t numberOfStrips = MIN(numberOfWorkers, MAX(rows.length / DBProfileBlurStageGeneratorMinimumStripHeight, 1));
+    if (numberOfStrips == 1) {
+        block(rows.location, rows.length);
+        return;
+    }
+    
+    // One strip per worker keeps the number of threads bounded, and dispatch_apply returns once every strip has been written
+    size_t firstRowOfRows = rows.location, height = rows.length;
+    dispatch_apply(numberOfStrips, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t strip) {
+        size_t firstRow = height * strip / numberOfStrips;
+        size_t lastRow = height * (strip + 1) / numberOfStrips;
+        block(firstRowOfRows + firstRow, lastRow - firstRow);
+    });
+}
+
+- (void)convolveBuffer:(const DBProfileBlurBuffer *)src intoBuffer:(const DBProfileBlurBuffer *)dst boxSize:(uint32_t)boxSize {
+    size_t tempBufferSize = DBProfileBlurTempBufferSize(src->width, boxSize);
+    [self enumerateStripsOfBuffer:src usingBlock:^(size_t firstRow, size_t numberOfRows) {
+        void *tempBuffer = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:tempBufferSize];
+        DBProfileBlurBoxConvolveRows(src, dst, tempBuffer, boxSize, firstRow, numberOfRows);
+        [[DBProfileBlurBufferPool sharedPool] recycleBuffer:tempBuffer size:tempBufferSize];
+    }];
+    _numberOfConvolutions++;
+}
+
+- (void)streamBuffer:(const DBProfileBlurBuffer *)src intoBuffer:(const DBProfileBlurBuffer *)dst boxSizes:(const uint32_t *)boxSizes count:(size_t)count levels:(size_t)levels {
+    // Every worker streams its own rows through a window of its share of the budget, and fewer workers share it when a window needs more
+    size_t budget = [DBProfileBlurBufferPool sharedPool].workingBytesLimit;
+    size_t numberOfWorkers = MAX(self.numberOfWorkers, 1);
+    size_t stripHeight, windowSize;
+    while (YES) {
+        stripHeight = DBProfileBlurStreamStripHeight(src->width, src->height, src->format, boxSizes, count, levels, budget / numberOfWorkers);
+        windowSize = DBProfileBlurStreamWindowSize(src->width, src->height, src->format, boxSizes, count, levels, stripHeight);
+        if (numberOfWorkers == 1 || windowSize * numberOfWorkers <= budget) break;
+        numberOfWorkers--;
+    }
+    
+    [self enumerateStripsOfRows:NSMakeRange(0, dst->height) numberOfWorkers:numberOfWorkers usingBlock:^(size_t firstRow, size_t numberOfRows) {
+        void *window = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:windowSize];
+        DBProfileBlurStreamBoxesRows(src, dst, window, boxSizes, count, levels, stripHeight, firstRow, numberOfRows);
+        [[DBProfileBlurBufferPool sharedPool] recycleBuffer:window size:windowSize];
+    }];
+    _numberOfConvolutions += count;
+}
+
+- (BOOL)streamsStages {
+    // The working buffers hold two full-size copies of the source, images for which they do not fit the budget are streamed in strips
+    NSUInteger workingBytesLimit = [DBProfileBlurBufferPool sharedPool].workingBytesLimit;
+    return workingBytesLimit > 0 && 2 * [self bufferSize] > workingBytesLimit && (self.sourceImage.buffer.height >> DBProfileBlurPyramidMaximumLevel) > 0;
+}
+
+- (UIImage *)streamedImageForStage:(NSUInteger)stage variance:(double)variance {
+    DBProfileBlurBuffer source = self.sourceImage.buffer;
+    size_t level = [self pyramidLevelForStage:stage variance:variance];
+    double sourceVariance = 0.0;
+    for (size_t i = 1; i <= level; i++) sourceVariance += DBProfileBlurDownsampleVariance(i);
+    
+    // The same three boxes as imageForStage:blurRadius: blur what the pyramid leaves of the variance
+    uint32_t sizes[3];
+    size_t count = 0;
+    double factor = (double)(1u << level);
+    double remainingVariance = (variance - sourceVariance) / (factor * factor);
+    if (remainingVariance > 0.0) {
+        DBProfileBlurGaussianBoxSizes(sqrt(remainingVariance), 3, sizes);
+        count = 3;
+    }
+    const uint32_t *boxSizes = sizes;
+    
+    DBProfileBlurBuffer stageBuffer = {NULL, source.width, source.height, 0, source.format};
+    DBProfileBlurDownsampledSize(&stageBuffer.width, &stageBuffer.height, level);
+    stageBuffer.rowBytes = stageBuffer.width * DBProfileBlurPixelFormatBytesPerPixel(source.format);
+    
+    // Only the rows around the visible part of the stage are streamed, from the rows of the source they shrink from
+    NSRange rows = [self rowsToBlurInBuffer:&stageBuffer variance:variance level:level];
+    DBProfileBlurBuffer visibleSource = DBProfileBlurStageGeneratorBufferRows(&source, NSMakeRange(rows.location << level, rows.length << level));
+    void (^render)(const DBProfileBlurBuffer *) = ^(const DBProfileBlurBuffer *buffer) {
+        DBProfileBlurBuffer visibleBuffer = DBProfileBlurStageGeneratorBufferRows(buffer, rows);
+        [self streamBuffer:&visibleSource intoBuffer:&visibleBuffer boxSizes:boxSizes count:count levels:level];
+        DBProfileBlurStageGeneratorClampRows(buffer, rows);
+    };
+    
+    UIImage *atlasImage = [self.atlas renderStage:stage width:stageBuffer.width height:stageBuffer.height usingBlock:render];
+    if (atlasImage) return atlasImage;
+    
+    // Without an atlas the stage is streamed into a buffer of its own size, which the image takes over
+    size_t bytes = stageBuffer.rowBytes * stageBuffer.height;
+    stageBuffer.data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:bytes];
+    render(&stageBuffer);
+    UIImage *normalizedImage = self.sourceImage.normalizedImage;
+    CGFloat scale = normalizedImage.scale * stageBuffer.width / source.width;
+    return [normalizedImage db_imageByTakingBlurBuffer:&stageBuffer allocatedSize:bytes scale:scale tintColor:self.tintColor];
+}
+
+- (void)generateStagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block {
+    [self generateStagesWithBlurRadii:blurRadii skippingStages:nil usingBlock:block];
+}
+
+- (void)generateStagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii skippingStages:(NSIndexSet *)skippedStages usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block {
+    NSParameterAssert(block);
+    
+    // Nothing past the last stage that becomes an image needs to be blurred
+    NSUInteger count = blurRadii.count;
+    while (count > 0 && [skippedStages containsIndex:count - 1]) count--;
+    if (count == 0) return;
+    blurRadii = [blurRadii subarrayWithRange:NSMakeRange(0, count)];
+    
+    if ([self streamsStages]) {
+        [self generateStreamedStagesWithBlurRadii:blurRadii skippingStages:skippedStages usingBlock:block];
+        return;
+    }
+    
+    DBProfileBlurBuffer buffer1, buffer2;
+    if (![self loadBuffer:&buffer1 scratch:&buffer2]) {
+        BOOL stop = NO;
+        for (NSUInteger stage = 0; stage < blurRadii.count && !stop; stage++) {
+            if (![skippedStages containsIndex:stage]) block(stage, self.image, &stop);
+        }
+        return;
+    }
+    
+    BOOL stop = NO;
+    switch (self.renderer) {
+        case DBProfileBlurStageRendererProgressive:
+            if (self.blurAlgorithm == DBProfileBlurAlgorithmBox) {
+                [self generateProgressiveStagesFromBuffer:&buffer1 scratch:&buffer2 blurRadii:blurRadii skippingStages:skippedStages stop:&stop usingBlock:block];
+            }
+            else {
+                [self generateAlgorithmStagesFromBuffer:&buffer1 scratch:&buffer2 blurRadii:blurRadii skippingStages:skippedStages stop:&stop usingBlock:block];
+            }
+            break;
+        case DBProfileBlurStageRendererSummedAreaTable:
+            [self generateSummedAreaTableStagesFromBuffer:&buffer1 scratch:&buffer2 blurRadii:blurRadii skippingStages:skippedStages stop:&stop usingBlock:block];
+            break;
+    }
+    
+    [self recycleBuffer:&buffer1];
+    [self recycleBuffer:&buffer2];
+}
+
+- (UIImage *)imageForStage:(NSUInteger)stage blurRadius:(CGFloat)blurRadius {
+    if ([self streamsStages]) return [self streamedImageForStage:stage variance:[self targetVarianceForBlurRadius:blurRadius]];
+    
+    DBProfileBlurBuffer buffer, scratch;
+    if (![self loadBuffer:&buffer scratch:&scratch]) return self.image;
+    
+    double variance = [self targetVarianceForBlurRadius:blurRadius];
+    size_t level = [self pyramidLevelForStage:stage variance:variance];
+    double sourceVariance = 0.0;
+    for (size_t i = 1; i <= level; i++) {
+        DBProfileBlurDownsample(&buffer);
+        sourceVariance += DBProfileBlurDownsampleVariance(i);
+    }
+    scratch.width = buffer.width;
+    scratch.height = buffer.height;
+    scratch.rowBytes = buffer.rowBytes;
+    
+    // Only the rows around the visible part of the stage are blurred, as if the image ended there
+    NSRange rows = [self rowsToBlurInBuffer:&buffer variance:variance level:level];
+    DBProfileBlurBuffer visibleBuffer = DBProfileBlurStageGeneratorBufferRows(&buffer, rows);
+    DBProfileBlurBuffer visibleScratch = DBProfileBlurStageGeneratorBufferRows(&scratch, rows);
+    
+    // Three boxes approximate the smooth kernel of `iterations` boxes much better than the single box used between progressive stages
+    const DBProfileBlurBuffer *visibleResult = &visibleBuffer;
+    double factor = (double)(1u << level);
+    double remainingVariance = (variance - sourceVariance) / (factor * factor);
+    if (remainingVariance > 0.0 && self.blurAlgorithm != DBProfileBlurAlgorithmBox) {
+        visibleResult = [self blurBuffer:&visibleBuffer scratch:&visibleScratch variance:remainingVariance];
+    }
+    else if (remainingVariance > 0.0) {
+        uint32_t sizes[3];
+        DBProfileBlurGaussianBoxSizes(sqrt(remainingVariance), 3, sizes);
+        const DBProfileBlurBuffer *destination = &visibleScratch;
+        for (size_t i = 0; i < 3; i++) {
+            [self convolveBuffer:visibleResult intoBuffer:destination boxSize:sizes[i]];
+            const DBProfileBlurBuffer *swap = visibleResult;
+            visibleResult = destination;
+            destination = swap;
+        }
+    }
+    const DBProfileBlurBuffer *result = (visibleResult == &visibleBuffer) ? &buffer : &scratch;
+    DBProfileBlurStageGeneratorClampRows(result, rows);
+    
+    UIImage *atlasImage = [self.atlas setBuffer:result forStage:stage];
+    if (atlasImage) {
+        [self recycleBuffer:&buffer];
+        [self recycleBuffer:&scratch];
+        return atlasImage;
+    }
+    
+    // The stage is not needed afterwards, so the image takes over its buffer instead of copying it
+    [self recycleBuffer:(result == &buffer) ? &scratch : &buffer];
+    return [self imageByTakingBuffer:result];
+}
+
+- (NSArray<UIImage *> *)previewImagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii {
+    NSMutableArray<UIImage *> *images = [NSMutableArray arrayWithCapacity:blurRadii.count];
+    DBProfileBlurBuffer source = self.sourceImage.buffer;
+    if (floorf(self.image.size.width) * floorf(self.image.size.height) <= 0.0f || !source.data) {
+        for (NSUInteger stage = 0; stage < blurRadii.count; stage++) [images addObject:self.image];
+        return images;
+    }
+    
+    // The image is read straight from the source, so the full-resolution pixels are never copied
+    DBProfileBlurBufferPool *pool = [DBProfileBlurBufferPool sharedPool];
+    DBProfileBlurBuffer buffer = source;
+    size_t bufferSize;
+    if ((source.height >> DBProfileBlurStageGeneratorPreviewLevel) > 0) {
+        // Rows are shrunk one at a time straight into the preview, so only a few rows of the full resolution are ever held
+        DBProfileBlurDownsampledSize(&buffer.width, &buffer.height, DBProfileBlurStageGeneratorPreviewLevel);
+        buffer.rowBytes = buffer.width * DBProfileBlurPixelFormatBytesPerPixel(source.format);
+        bufferSize = buffer.rowBytes * buffer.height;
+        buffer.data = [pool bufferWithSize:bufferSize];
+        size_t windowSize = DBProfileBlurStreamWindowSize(source.width, source.height, source.format, NULL, 0, DBProfileBlurStageGeneratorPreviewLevel, buffer.height);
+        void *window = [pool bufferWithSize:windowSize];
+        DBProfileBlurStreamBoxes(&source, &buffer, window, NULL, 0, DBProfileBlurStageGeneratorPreviewLevel, buffer.height);
+        [pool recycleBuffer:window size:windowSize];
+    }
+    else {
+        bufferSize = MAX(source.width / 2, 1) * MAX(source.height / 2, 1) * DBProfileBlurPixelFormatBytesPerPixel(source.format);
+        buffer.data = [pool bufferWithSize:bufferSize];
+        DBProfileBlurDownsampleBuffer(&source, &buffer, DBProfileBlurStageGeneratorPreviewLevel);
+    }
+    double sourceVariance = 0.0;
+    for (size_t level = 1; level <= DBProfileBlurStageGeneratorPreviewLevel; level++) {
+        sourceVariance += DBProfileBlurDownsampleVariance(level);
+    }
+    
+    // Like progressive stages, every preview is blurred from the previous one with a single box
+    size_t previewSize = buffer.rowBytes * buffer.height;
+    DBProfileBlurBuffer scratch = buffer;
+    scratch.data = [pool bufferWithSize:previewSize];
+    DBProfileBlurBuffer *current = &buffer;
+    DBProfileBlurBuffer *next = &scratch;
+    double variance = sourceVariance;
+    double factor = (double)(1u << DBProfileBlurStageGeneratorPreviewLevel);
+    for (NSNumber *blurRadius in blurRadii) {
+        double targetVariance = [self targetVarianceForBlurRadius:blurRadius.doubleValue];
+        if (targetVariance <= 0.0) {
+            [images addObject:self.image];
+            continue;
+        }
+        
+        uint32_t boxSize = DBProfileBlurIncrementalBoxSize(variance / (factor * factor), targetVariance / (factor * factor));
+        if (boxSize > 1) {
+            size_t tempBufferSize = DBProfileBlurTempBufferSize(current->width, boxSize);
+            void *tempBuffer = [pool bufferWithSize:tempBufferSize];
+            DBProfileBlurBoxConvolve(current, next, tempBuffer, boxSize);
+            [pool recycleBuffer:tempBuffer size:tempBufferSize];
+            DBProfileBlurBuffer *swap = current;
+            current = next;
+            next = swap;
+            variance += DBProfileBlurBoxVariance(boxSize, 1) * factor * factor;
+        }
+        [images addObject:[self imageWithBuffer:current]];
+    }
+    
+    [pool recycleBuffer:buffer.data size:bufferSize];
+    [pool recycleBuffer:scratch.data size:previewSize];
+    return images;
+}
+
+- (const DBProfileBlurBuffer *)blurBuffer:(const DBProfileBlurBuffer *)buffer scratch:(const DBProfileBlurBuffer *)scratch variance:(double)variance {
+    size_t tempBufferSize = DBProfileBlurAlgorithmTempBufferSize(self.blurAlgorithm, buffer->width, buffer->height, variance);
+    void *tempBuffer = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:tempBufferSize];
+    const DBProfileBlurBuffer *result = DBProfileBlurWithAlgorithm(self.blurAlgorithm, buffer, scratch, tempBuffer, variance);
+    [[DBProfileBlurBufferPool sharedPool] recycleBuffer:tempBuffer size:tempBufferSize];
+    return result;
+}
+
+- (void)generateProgressiveStagesFromBuffer:(DBProfileBlurBuffer *)buffer
+                                    scratch:(DBProfileBlurBuffer *)scratchBuffer
+                                  blurRadii:(NSArray<NSNumber *> *)blurRadii
+                             skippingStages:(NSIndexSet *)skippedStages
+                                       stop:(BOOL *)stop
+                                 usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block
+{
+    DBProfileBlurBuffer *current = buffer;
+    DBProfileBlurBuffer *scratch = scratchBuffer;
+    double variance = 0.0;
+    size_t level = 0;
+    CGFloat previousBlurRadius = 0.0;
+    
+    // Every stage is blurred over the same rows so each one only reads rows the stage before it blurred, with a halo for the last stage
+    double largestVariance = [self targetVarianceForBlurRadius:[blurRadii.lastObject doubleValue]];
+    NSRange rows = [self rowsToBlurInBuffer:current variance:largestVariance level:level];
+    
+    for (NSUInteger stage = 0; stage < blurRadii.count && !*stop; stage++) {
+        CGFloat blurRadius = [blurRadii[stage] doubleValue];
+        NSAssert(blurRadius >= previousBlurRadius, @"blur radii must be in ascending order");
+        previousBlurRadius = blurRadius;
+        
+        // Variances are tracked in pixels of the original image and converted to the pixels of the current level
+        double targetVariance = [self targetVarianceForBlurRadius:blurRadius];
+        size_t stageLevel = [self pyramidLevelForStage:stage variance:targetVariance];
+        NSAssert(stageLevel >= level, @"pyramid levels must be in ascending order");
+        while (level < stageLevel) {
+            DBProfileBlurDownsample(current);
+            scratch->width = current->width;
+            scratch->height = current->height;
+            scratch->rowBytes = current->rowBytes;
+            variance += DBProfileBlurDownsampleVariance(++level);
+            rows = [self rowsToBlurInBuffer:current variance:largestVariance level:level];
+        }
+        double factor = (double)(1u << level);
+        
+        // A single box per stage keeps the work linear in the number of stages, any rounding error is corrected by the next stage
+        uint32_t boxSize = DBProfileBlurIncrementalBoxSize(variance / (factor * factor), targetVariance / (factor * factor));
+        if (boxSize > 1) {
+            DBProfileBlurBuffer visibleCurrent = DBProfileBlurStageGeneratorBufferRows(current, rows);
+            DBProfileBlurBuffer visibleScratch = DBProfileBlurStageGeneratorBufferRows(scratch, rows);
+            [self convolveBuffer:&visibleCurrent intoBuffer:&visibleScratch boxSize:boxSize];
+            DBProfileBlurBuffer *swap = current;
+            current = scratch;
+            scratch = swap;
+            variance += DBProfileBlurBoxVariance(boxSize, 1) * factor * factor;
+            
+            // The next level is shrunk from every row, so the rows of its halo must not come from outside the blurred ones
+            DBProfileBlurStageGeneratorClampRows(current, rows);
+        }
+        
+        // Skipped stages still advance the chain, they just never become images
+        if ([skippedStages containsIndex:stage]) continue;
+        
+        @autoreleasepool {
+            UIImage *blurredImage = [self imageWithBuffer:current stage:stage];
+            block(stage, blurredImage, stop);
+        }
+    }
+}
+
+- (void)generateAlgorithmStagesFromBuffer:(DBProfileBlurBuffer *)buffer
+                                  scratch:(DBProfileBlurBuffer *)scratch
+                                blurRadii:(NSArray<NSNumber *> *)blurRadii
+                           skippingStages:(NSIndexSet *)skippedStages
+                                     stop:(BOOL *)stop
+                               usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block
+{
+    // The algorithms cost the same for any variance, so every stage is blurred from the source at its level rather than from the stage
+    // before it, which keeps rounding from building up along the chain
+    DBProfileBlurBuffer stageBuffer = *buffer;
+    stageBuffer.data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:[self bufferSize]];
+    double sourceVariance = 0.0;
+    size_t level = 0;
+    
+    for (NSUInteger stage = 0; stage < blurRadii.count && !*stop; stage++) {
+        double variance = [self targetVarianceForBlurRadius:[blurRadii[stage] doubleValue]];
+        
+        size_t stageLevel = [self pyramidLevelForStage:stage variance:variance];
+        NSAssert(stageLevel >= level, @"pyramid levels must be in ascending order");
+        while (level < stageLevel) {
+            DBProfileBlurDownsample(buffer);
+            sourceVariance += DBProfileBlurDownsampleVariance(++level);
+        }
+        if ([skippedStages containsIndex:stage]) continue;
+        
+        stageBuffer.width = scratch->width = buffer->width;
+        stageBuffer.height = scratch->height = buffer->height;
+        stageBuffer.rowBytes = scratch->rowBytes = buffer->rowBytes;
+        
+        // Only the rows around the visible part of the stage are copied and blurred
+        NSRange rows = [self rowsToBlurInBuffer:buffer variance:variance level:level];
+        DBProfileBlurBuffer visibleSource = DBProfileBlurStageGeneratorBufferRows(buffer, rows);
+        DBProfileBlurBuffer visibleBuffer = DBProfileBlurStageGeneratorBufferRows(&stageBuffer, rows);
+        DBProfileBlurBuffer visibleScratch = DBProfileBlurStageGeneratorBufferRows(scratch, rows);
+        memcpy(visibleBuffer.data, visibleSource.data, rows.length * buffer->rowBytes);
+        
+        double factor = (double)(1u << level);
+        const DBProfileBlurBuffer *visibleResult = [self blurBuffer:&visibleBuffer scratch:&visibleScratch variance:(variance - sourceVariance) / (factor * factor)];
+        const DBProfileBlurBuffer *result = (visibleResult == &visibleBuffer) ? &stageBuffer : scratch;
+        DBProfileBlurStageGeneratorClampRows(result, rows);
+        
+        @autoreleasepool {
+            UIImage *blurredImage = [self imageWithBuffer:result stage:stage];
+            block(stage, blurredImage, stop);
+        }
+    }
+    
+    [self recycleBuffer:&stageBuffer];
+}
+
+- (void)generateStreamedStagesWithBlurRadii:(NSArray<NSNumber *> *)blurRadii
+                             skippingStages:(NSIndexSet *)skippedStages
+                                 usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block
+{
+    // Every stage is streamed from the source on its own, which costs more work than a chain of stages but never holds a full-size buffer
+    BOOL stop = NO;
+    for (NSUInteger stage = 0; stage < blurRadii.count && !stop; stage++) {
+        if ([skippedStages containsIndex:stage]) continue;
+        
+        @autoreleasepool {
+            double variance = [self targetVarianceForBlurRadius:[blurRadii[stage] doubleValue]];
+            UIImage *blurredImage = [self streamedImageForStage:stage variance:variance];
+            block(stage, blurredImage, &stop);
+        }
+    }
+}
+
+- (void)generateSummedAreaTableStagesFromBuffer:(DBProfileBlurBuffer *)buffer
+                                        scratch:(DBProfileBlurBuffer *)scratch
+                                      blurRadii:(NSArray<NSNumber *> *)blurRadii
+                                 skippingStages:(NSIndexSet *)skippedStages
+                                           stop:(BOOL *)stop
+                                     usingBlock:(void (^)(NSUInteger, UIImage *, BOOL *))block
+{
+    size_t tableSize = DBProfileBlurSummedAreaTableSize(buffer->width, buffer->height);
+    uint32_t *table = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:tableSize];
+    DBProfileBlurSummedAreaTableBuild(buffer, table);
+    
+    double sourceVariance = 0.0;
+    size_t level = 0;
+    
+    for (NSUInteger stage = 0; stage < blurRadii.count && !*stop; stage++) {
+        double variance = [self targetVarianceForBlurRadius:[blurRadii[stage] doubleValue]];
+        
+        // Shrink the source and summarize it again whenever a stage can be rendered at a deeper level
+        size_t stageLevel = [self pyramidLevelForStage:stage variance:variance];
+        NSAssert(stageLevel >= level, @"pyramid levels must be in ascending order");
+        if (level < stageLevel) {
+            while (level < stageLevel) {
+                DBProfileBlurDownsample(buffer);
+                sourceVariance += DBProfileBlurDownsampleVariance(++level);
+            }
+            scratch->width = buffer->width;
+            scratch->height = buffer->height;
+            scratch->rowBytes = buffer->rowBytes;
+            DBProfileBlurSummedAreaTableBuild(buffer, table);
+        }
+        if ([skippedStages containsIndex:stage]) continue;
+        double factor = (double)(1u << level);
+        
+        const DBProfileBlurBuffer *result = buffer;
+        if (variance - sourceVariance > 0.0) {
+            uint32_t sizes[3];
+            DBProfileBlurSummedAreaTableBoxSizes((variance - sourceVariance) / (factor * factor), 3, sizes);
+            const uint32_t *boxSizes = sizes;
+            size_t tempBufferSize = DBProfileBlurSummedAreaTableTempBufferSize(buffer->width);
+            
+            // The table holds the whole image, so the visible rows are evaluated exactly without a halo
+            NSRange rows = [self rowsToBlurInBuffer:scratch variance:0.0 level:level];
+            [self enumerateStripsOfRows:rows usingBlock:^(size_t firstRow, size_t numberOfRows) {
+                void *tempBuffer = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:tempBufferSize];
+                DBProfileBlurSummedAreaTableBoxesRows(table, scratch, tempBuffer, boxSizes, 3, firstRow, numberOfRows);
+                [[DBProfileBlurBufferPool sharedPool] recycleBuffer:tempBuffer size:tempBufferSize];
+            }];
+            DBProfileBlurStageGeneratorClampRows(scratch, rows);
+            result = scratch;
+        }
+        
+        @autoreleasepool {
+            UIImage *blurredImage = [self imageWithBuffer:result stage:stage];
+            block(stage, blurredImage, stop);
+        }
+    }
+    
+    [[DBProfileBlurBufferPool sharedPool] recycleBuffer:table size:tableSize];
+}
+
+@end
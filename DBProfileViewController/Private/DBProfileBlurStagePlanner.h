@@ -0,0 +1,133 @@
+//
+//  DBProfileBlurStagePlanner.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurView.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The `DBProfileBlurStagePlan` class describes how many blurred stages to generate for an image and the resolution to store each of them at.
+ */
+@interface DBProfileBlurStagePlan : NSObject
+
+- (instancetype)initWithBlurRadii:(NSArray<NSNumber *> *)blurRadii pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels numberOfBytes:(NSUInteger)numberOfBytes NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The blur radius of every stage, including stage 0.
+ */
+@property (nonatomic, readonly) NSArray<NSNumber *> *blurRadii;
+
+/**
+ *  The pyramid level every stage is stored at. A level of n stores the stage at 1/2^n of the image resolution.
+ */
+@property (nonatomic, readonly) NSArray<NSNumber *> *pyramidLevels;
+
+/**
+ *  The number of stages after stage 0.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfStages;
+
+/**
+ *  The number of bytes needed to store the bitmaps of every stage after stage 0, which is the image itself.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfBytes;
+
+/**
+ *  The most visible change of blur between two consecutive stages, as a difference of `log(1 + blurRadius / 3)`.
+ *
+ *  Blur radii below 3 points are close to the detail the eye resolves, so the change is measured relative to the radius plus 3 points.
+ */
+@property (nonatomic, readonly) CGFloat largestVisibleStep;
+
+/**
+ *  The fractional stage to show when the blur view has scrolled by the specified percentage.
+ *
+ *  The blur radius grows linearly with the percentage from stage 0 to the last stage, and the result falls between the two stages around
+ *  that radius. For evenly spaced stages this is `percentScrolled * numberOfStages`, which is also returned for percentages outside 0 to 1.
+ */
+- (CGFloat)stageForPercentScrolled:(CGFloat)percentScrolled;
+
+@end
+
+/**
+ *  The `DBProfileBlurStagePlanner` class fits the blurred stages of an image into a memory budget.
+ *
+ *  Stages are first stored at the lowest resolution that keeps all of their visible detail. If that does not fit, heavily blurred stages are stored
+ *  one level lower than that, and if that still does not fit, the number of stages is reduced.
+ */
+@interface DBProfileBlurStagePlanner : NSObject
+
+- (instancetype)initWithImage:(UIImage *)image NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The image to plan the stages for.
+ */
+@property (nonatomic, readonly) UIImage *image;
+
+/**
+ *  The largest number of stages after stage 0 to plan.
+ *
+ *  Defaults to 20.
+ */
+@property (nonatomic) NSUInteger numberOfStages;
+
+/**
+ *  How the blur radii of the stages are spaced.
+ *
+ *  Defaults to `DBProfileBlurStageSpacingLinear`.
+ */
+@property (nonatomic) DBProfileBlurStageSpacing stageSpacing;
+
+/**
+ *  The blur radius of the last stage.
+ *
+ *  Defaults to 20.
+ */
+@property (nonatomic) CGFloat maxBlurRadius;
+
+/**
+ *  The number of box convolutions of the independently blurred image that each stage matches.
+ *
+ *  Defaults to 5.
+ */
+@property (nonatomic) NSUInteger iterations;
+
+/**
+ *  The maximum number of bytes of stage bitmaps, or 0 for no limit.
+ *
+ *  Defaults to 0.
+ */
+@property (nonatomic) NSUInteger memoryBudget;
+
+/**
+ *  Whether stages may be stored below full resolution when there is no memory budget, or when they fit in it at full resolution.
+ *
+ *  Defaults to NO.
+ */
+@property (nonatomic) BOOL allowsDownsampling;
+
+/**
+ *  Calculates the plan with the most stages, at the highest resolution, that fits within `memoryBudget`.
+ *
+ *  If even a single stage does not fit, the plan with a single stage is returned and its `numberOfBytes` exceeds the budget.
+ */
+- (DBProfileBlurStagePlan *)plan;
+
+/**
+ *  The number of bytes needed to store one stage of the image at the specified pyramid level, which is the size of its region in a `DBProfileBlurStageAtlas`.
+ */
+- (NSUInteger)numberOfBytesForPyramidLevel:(NSUInteger)level;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,148 @@
+//
+//  DBProfileBlurStagePlanner.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "DBProfileBlurStagePlanner.h"
+#import "DBProfileBlurStageGenerator.h"
+#import "DBProfileBlurStageAtlas.h"
+#import "DBProfileBlurKernel.h"
+
+// Blur radii much below this are close to the detail the eye resolves, so steps are judged relative to the radius plus this
+static const CGFloat DBProfileBlurStagePlannerPerceptualBlurRadius = 3.0;
+
+static CGFloat DBProfileBlurStagePlannerPerceivedBlur(CGFloat blurRadius) {
+    return log1p(blurRadius / DBProfileBlurStagePlannerPerceptualBlurRadius);
+}
+
+@implementation DBProfileBlurStagePlan
+
+- (instancetype)initWithBlurRadii:(NSArray<NSNumber *> *)blurRadii pyramidLevels:(NSArray<NSNumber *> *)pyramidLevels numberOfBytes:(NSUInteger)numberOfBytes {
+    NSParameterAssert(blurRadii.count == pyramidLevels.count);
+    self = [super init];
+    if (self) {
+        _blurRadii = [blurRadii copy];
+        _pyramidLevels = [pyramidLevels copy];
+        _numberOfBytes = numberOfBytes;
+    }
+    return self;
+}
+
+- (NSUInteger)numberOfStages {
+    return self.blurRadii.count > 0 ? self.blurRadii.count - 1 : 0;
+}
+
+- (CGFloat)largestVisibleStep {
+    CGFloat largestVisibleStep = 0.0;
+    for (NSUInteger stage = 1; stage < self.blurRadii.count; stage++) {
+        CGFloat step = DBProfileBlurStagePlannerPerceivedBlur([self.blurRadii[stage] doubleValue]) - DBProfileBlurStagePlannerPerceivedBlur([self.blurRadii[stage - 1] doubleValue]);
+        largestVisibleStep = MAX(largestVisibleStep, step);
+    }
+    return largestVisibleStep;
+}
+
+- (CGFloat)stageForPercentScrolled:(CGFloat)percentScrolled {
+    NSUInteger numberOfStages = self.numberOfStages;
+    if (numberOfStages == 0 || percentScrolled <= 0.0 || percentScrolled >= 1.0) return percentScrolled * numberOfStages;
+    
+    // The blur keeps growing with the scroll offset the way it did with evenly spaced stages, only the stages it is drawn from move
+    CGFloat blurRadius = percentScrolled * [self.blurRadii.lastObject doubleValue];
+    NSUInteger stage = 1;
+    while (stage < numberOfStages && [self.blurRadii[stage] doubleValue] < blurRadius) stage++;
+    
+    CGFloat lowerBlurRadius = [self.blurRadii[stage - 1] doubleValue];
+    CGFloat upperBlurRadius = [self.blurRadii[stage] doubleValue];
+    if (upperBlurRadius <= lowerBlurRadius) return stage;
+    return (stage - 1) + MIN(MAX((blurRadius - lowerBlurRadius) / (upperBlurRadius - lowerBlurRadius), 0.0), 1.0);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p; numberOfStages = %@; pyramidLevels = %@; numberOfBytes = %@>",
+            NSStringFromClass([self class]), self, @(self.numberOfStages), [self.pyramidLevels componentsJoinedByString:@","], @(self.numberOfBytes)];
+}
+
+@end
+
+@implementation DBProfileBlurStagePlanner
+
+- (instancetype)initWithImage:(UIImage *)image {
+    self = [super init];
+    if (self) {
+        _image = image;
+        _numberOfStages = 20;
+        _maxBlurRadius = 20.0;
+        _iterations = 5;
+    }
+    return self;
+}
+
+- (NSUInteger)numberOfBytesForPyramidLevel:(NSUInteger)level {
+    // Sized the way the atlas the stages are stored in sets aside their regions, so a plan within budget is an atlas within budget
+    CGSize pixelSize = [DBProfileBlurSourceImage pixelSizeForImage:self.image];
+    DBProfileBlurPixelFormat format = [DBProfileBlurSourceImage pixelFormatForImage:self.image];
+    return [DBProfileBlurStageAtlas byteCountForRegionOfWidth:(size_t)pixelSize.width height:(size_t)pixelSize.height format:format pyramidLevel:level];
+}
+
+- (CGFloat)blurRadiusForStage:(NSUInteger)stage numberOfStages:(NSUInteger)numberOfStages {
+    switch (self.stageSpacing) {
+        case DBProfileBlurStageSpacingLinear:
+            return stage * (self.maxBlurRadius / numberOfStages);
+        case DBProfileBlurStageSpacingPerceptual: {
+            // Evenly spaced in perceived blur, the inverse of log(1 + r / r0)
+            if (stage == numberOfStages) return self.maxBlurRadius;
+            CGFloat perceivedBlur = DBProfileBlurStagePlannerPerceivedBlur(self.maxBlurRadius) * stage / numberOfStages;
+            return expm1(perceivedBlur) * DBProfileBlurStagePlannerPerceptualBlurRadius;
+        }
+    }
+    return 0.0;
+}
+
+- (DBProfileBlurStagePlan *)planWithNumberOfStages:(NSUInteger)numberOfStages additionalLevels:(NSUInteger)additionalLevels downsamples:(BOOL)downsamples {
+    NSMutableArray *blurRadii = [NSMutableArray array];
+    NSMutableArray *pyramidLevels = [NSMutableArray array];
+    NSUInteger numberOfBytes = 0;
+    
+    for (NSUInteger stage = 0; stage <= numberOfStages; stage++) {
+        CGFloat blurRadius = [self blurRadiusForStage:stage numberOfStages:numberOfStages];
+        NSUInteger level = 0;
+        
+        // Stage 0 is the unblurred image and is never downsampled
+        if (downsamples && stage > 0) {
+            double variance = [DBProfileBlurStageGenerator varianceForBlurRadius:blurRadius scale:self.image.scale iterations:self.iterations];
+            level = MIN(DBProfileBlurPyramidLevelForVariance(variance, DBProfileBlurPyramidMaximumLevel) + additionalLevels, DBProfileBlurPyramidMaximumLevel);
+        }
+        
+        [blurRadii addObject:@(blurRadius)];
+        [pyramidLevels addObject:@(level)];
+        if (stage > 0) numberOfBytes += [self numberOfBytesForPyramidLevel:level];
+    }
+    
+    return [[DBProfileBlurStagePlan alloc] initWithBlurRadii:blurRadii pyramidLevels:pyramidLevels numberOfBytes:numberOfBytes];
+}
+
+- (DBProfileBlurStagePlan *)plan {
+    NSUInteger numberOfStages = MAX(self.numberOfStages, 1);
+    
+    DBProfileBlurStagePlan *plan = [self planWithNumberOfStages:numberOfStages additionalLevels:0 downsamples:self.allowsDownsampling];
+    if (self.memoryBudget == 0 || plan.numberOfBytes <= self.memoryBudget) return plan;
+    
+    // Storing stages at the resolution their blur leaves is free, one level below that costs a little sharpness at the start of each level
+    for (NSUInteger additionalLevels = 0; additionalLevels <= 1; additionalLevels++) {
+        plan = [self planWithNumberOfStages:numberOfStages additionalLevels:additionalLevels downsamples:YES];
+        if (plan.numberOfBytes <= self.memoryBudget) return plan;
+    }
+    
+    // Fewer stages make the transition between them coarser, which interpolation between stages partly hides
+    while (numberOfStages > 1) {
+        numberOfStages--;
+        plan = [self planWithNumberOfStages:numberOfStages additionalLevels:1 downsamples:YES];
+        if (plan.numberOfBytes <= self.memoryBudget) return plan;
+    }
+    
+    return plan;
+}
+
+@end
@@ -14,4 +14,10 @@
 @property (nonatomic, nullable) NSLayoutConstraint *topLayoutGuideConstraint;
 @property (nonatomic, nullable) NSLayoutConstraint *topSuperviewConstraint;
 
+/**
+ *  The part of the bounds of the header view that stays on screen once it has collapsed into a navigation bar, or `CGRectNull` for headers
+ *  that do not collapse.
+ */
+@property (nonatomic) CGRect collapsedBounds;
+
 @end
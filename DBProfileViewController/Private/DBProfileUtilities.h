@@ -11,4 +11,8 @@
 
 extern UIImage *DBProfileImageByCroppingImageToSize(UIImage *image, CGSize size);
 
-extern CGFloat DBProfileDesiredNavigationBarHeightForTraitCollection(UITraitCollection *traitCollection);
\ No newline at end of file
+extern CGFloat DBProfileDesiredNavigationBarHeightForTraitCollection(UITraitCollection *traitCollection);
+
+extern void DBProfileSetConstraintConstant(NSLayoutConstraint *constraint, CGFloat constant);
+
+extern void DBProfileActivateConstraints(NSArray<NSLayoutConstraint *> *activeConstraints, NSArray<NSLayoutConstraint *> *inactiveConstraints);
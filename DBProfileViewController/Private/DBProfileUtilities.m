@@ -40,3 +40,18 @@ UIImage *DBProfileImageByCroppingImageToSize(UIImage *image, CGSize size) {
     
     return newImage;
 }
+
+// Layout is invalidated whenever a constant is set, so constants that are already applied are left alone
+void DBProfileSetConstraintConstant(NSLayoutConstraint *constraint, CGFloat constant) {
+    if (constraint && constraint.constant != constant) constraint.constant = constant;
+}
+
+void DBProfileActivateConstraints(NSArray<NSLayoutConstraint *> *activeConstraints, NSArray<NSLayoutConstraint *> *inactiveConstraints) {
+    NSPredicate *activePredicate = [NSPredicate predicateWithBlock:^BOOL(NSLayoutConstraint *constraint, NSDictionary *bindings) {
+        return constraint.active;
+    }];
+    NSArray *constraintsToDeactivate = [inactiveConstraints filteredArrayUsingPredicate:activePredicate];
+    NSArray *constraintsToActivate = [activeConstraints filteredArrayUsingPredicate:[NSCompoundPredicate notPredicateWithSubpredicate:activePredicate]];
+    if (constraintsToActivate.count) [NSLayoutConstraint activateConstraints:constraintsToActivate];
+    if (constraintsToDeactivate.count) [NSLayoutConstraint deactivateConstraints:constraintsToDeactivate];
+}
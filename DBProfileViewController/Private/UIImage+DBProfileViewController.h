@@ -0,0 +1,65 @@
+//
+//  UIImage+DBProfileViewController.h
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "DBProfileBlurKernel.h"
+
+@interface UIImage (DBProfileViewController)
+
+/**
+ *  Blurs the image using iterated box convolutions from `DBProfileBlurKernel`.
+ *
+ *  This is a drop-in replacement for `-[UIImage(FXBlurView) blurredImageWithRadius:iterations:tintColor:]` that does not depend on vImage.
+ *  Images whose working buffers exceed the `workingBytesLimit` of the shared `DBProfileBlurBufferPool` are blurred in strips, with the same result.
+ */
+- (UIImage *)db_blurredImageWithRadius:(CGFloat)radius iterations:(NSUInteger)iterations tintColor:(UIColor *)tintColor;
+
+/**
+ *  Blurs the image with the specified algorithm, with the same variance as `iterations` box convolutions of `radius`, so a radius blurs
+ *  about as much whatever the algorithm. Only box blurs are streamed in strips when their working buffers exceed the budget.
+ */
+- (UIImage *)db_blurredImageWithRadius:(CGFloat)radius iterations:(NSUInteger)iterations algorithm:(DBProfileBlurAlgorithm)algorithm tintColor:(UIColor *)tintColor;
+
+/**
+ *  Creates an image from a copy of the pixels in `buffer` and tints it the same way as `db_blurredImageWithRadius:iterations:tintColor:`.
+ *
+ *  The receiver must be a `normalizedImage` of a `DBProfileBlurSourceImage` and provides the orientation, color space and bitmap info of the new image.
+ */
+- (UIImage *)db_imageWithBlurBuffer:(const DBProfileBlurBuffer *)buffer scale:(CGFloat)scale tintColor:(UIColor *)tintColor;
+
+/**
+ *  Creates an image backed by the pixels in `buffer` without copying them, and tints them in place.
+ *
+ *  The image takes ownership of `buffer->data`, which must have been requested from the shared `DBProfileBlurBufferPool` with `allocatedSize`
+ *  bytes, and recycles it into the pool when the image is released.
+ */
+- (UIImage *)db_imageByTakingBlurBuffer:(const DBProfileBlurBuffer *)buffer allocatedSize:(size_t)allocatedSize scale:(CGFloat)scale tintColor:(UIColor *)tintColor;
+
+/**
+ *  Returns a copy of the receiver tinted the same way as `db_blurredImageWithRadius:iterations:tintColor:`, or the receiver if `tintColor` is
+ *  nil or transparent.
+ *
+ *  Tinting a blurred image afterwards gives the same pixels as blurring it with the tint, at the cost of a single pass over its pixels.
+ */
+- (UIImage *)db_imageByApplyingBlurTintColor:(UIColor *)tintColor;
+
+/**
+ *  The digests of the rows of the image as written by `DBProfileBlurRowDigests`, or nil if they were not recorded when the image was drawn.
+ *
+ *  Recording them from the pixels the image is created from spares copying its pixels back out of the image to compare it with another.
+ */
+@property (nonatomic, copy, setter=db_setRowDigests:) NSData *db_rowDigests;
+
+/**
+ *  Computes the digests of the rows of a 32-bit bitmap context, such as the context of a snapshot before the image is created from it.
+ *
+ *  @return The digests, or nil if the context does not have 32-bit pixels.
+ */
++ (NSData *)db_rowDigestsOfBitmapContext:(CGContextRef)context;
+
+@end
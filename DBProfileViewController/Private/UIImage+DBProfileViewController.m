@@ -0,0 +1,193 @@
+//
+//  UIImage+DBProfileViewController.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright (c) 2015 Devon Boyer. All rights reserved.
+//
+
+#import "UIImage+DBProfileViewController.h"
+#import "DBProfileBlurBufferPool.h"
+#import "DBProfileBlurSourceImage.h"
+#import <objc/runtime.h>
+
+static void DBProfileBlurApplyTint(CGContextRef ctx, UIColor *tintColor, size_t width, size_t height) {
+    if (tintColor && CGColorGetAlpha(tintColor.CGColor) > 0.0f) {
+        CGContextSetFillColorWithColor(ctx, [tintColor colorWithAlphaComponent:0.25].CGColor);
+        CGContextSetBlendMode(ctx, kCGBlendModePlusLighter);
+        CGContextFillRect(ctx, CGRectMake(0, 0, width, height));
+    }
+}
+
+// Blurred images own the pool buffer they were rendered into and return it to the pool when they are released
+static void DBProfileBlurRecycleImageBuffer(void *info, const void *data, size_t size) {
+    [[DBProfileBlurBufferPool sharedPool] recycleBuffer:(void *)data size:(size_t)info];
+}
+
+static CGImageRef DBProfileBlurCreateImageTakingBuffer(const DBProfileBlurBuffer *buffer, size_t allocatedSize, CGColorSpaceRef colorSpace, CGBitmapInfo bitmapInfo) {
+    size_t bitsPerPixel = 8 * DBProfileBlurPixelFormatBytesPerPixel(buffer->format);
+    CGDataProviderRef provider = CGDataProviderCreateWithData((void *)(uintptr_t)allocatedSize, buffer->data, buffer->rowBytes * buffer->height, DBProfileBlurRecycleImageBuffer);
+    CGImageRef imageRef = CGImageCreate(buffer->width, buffer->height, 8, bitsPerPixel, buffer->rowBytes, colorSpace, bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    return imageRef;
+}
+
+// Streams `iterations` boxes from `src` into `dst` through a window that fits `budget`, reading the source in place
+static void DBProfileBlurStreamIterations(const DBProfileBlurBuffer *src, const DBProfileBlurBuffer *dst, uint32_t boxSize, size_t iterations, size_t budget) {
+    DBProfileBlurBufferPool *pool = [DBProfileBlurBufferPool sharedPool];
+    uint32_t *boxSizes = malloc(iterations * sizeof(uint32_t));
+    for (size_t i = 0; i < iterations; i++) boxSizes[i] = boxSize;
+    
+    size_t stripHeight = DBProfileBlurStreamStripHeight(src->width, src->height, src->format, boxSizes, iterations, 0, budget);
+    size_t windowSize = DBProfileBlurStreamWindowSize(src->width, src->height, src->format, boxSizes, iterations, 0, stripHeight);
+    void *window = [pool bufferWithSize:windowSize];
+    DBProfileBlurStreamBoxes(src, dst, window, boxSizes, iterations, 0, stripHeight);
+    [pool recycleBuffer:window size:windowSize];
+    free(boxSizes);
+}
+
+@implementation UIImage (DBProfileViewController)
+
+- (UIImage *)db_blurredImageWithRadius:(CGFloat)radius iterations:(NSUInteger)iterations tintColor:(UIColor *)tintColor {
+    return [self db_blurredImageWithRadius:radius iterations:iterations algorithm:DBProfileBlurAlgorithmBox tintColor:tintColor];
+}
+
+- (UIImage *)db_blurredImageWithRadius:(CGFloat)radius iterations:(NSUInteger)iterations algorithm:(DBProfileBlurAlgorithm)algorithm tintColor:(UIColor *)tintColor {
+    // Image must be nonzero size
+    if (floorf(self.size.width) * floorf(self.size.height) <= 0.0f) return self;
+    
+    uint32_t boxSize = (uint32_t)(radius * self.scale);
+    
+    // Pixels the kernels can read are used in place, others are redrawn once into memory the source image owns
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:self];
+    DBProfileBlurBuffer source = sourceImage.buffer;
+    if (!source.data) return self;
+    
+    // A box of a single pixel leaves the image unchanged
+    if (boxSize <= 1) iterations = 0;
+    if (iterations == 0) algorithm = DBProfileBlurAlgorithmBox;
+    
+    // Other algorithms blur with the variance of the box iterations, so a radius looks the same whatever the algorithm
+    double variance = DBProfileBlurBoxVariance(boxSize, iterations);
+    size_t bytes = source.rowBytes * source.height;
+    size_t tempBufferSize = (algorithm == DBProfileBlurAlgorithmBox) ? DBProfileBlurTempBufferSize(source.width, boxSize) :
+                            DBProfileBlurAlgorithmTempBufferSize(algorithm, source.width, source.height, variance);
+    DBProfileBlurBufferPool *pool = [DBProfileBlurBufferPool sharedPool];
+    
+    // Besides the result, full-size buffers need a second one to ping-pong with. Images for which that does not fit the budget, such as
+    // uncropped cover photos, are blurred in strips straight into the result, so the peak memory no longer grows with the image
+    NSUInteger workingBytesLimit = pool.workingBytesLimit;
+    if (algorithm == DBProfileBlurAlgorithmBox && iterations > 0 && workingBytesLimit > 0 && bytes + tempBufferSize > workingBytesLimit) {
+        DBProfileBlurBuffer result = source;
+        result.data = [pool bufferWithSize:bytes];
+        DBProfileBlurStreamIterations(&source, &result, boxSize, iterations, workingBytesLimit);
+        return [sourceImage.normalizedImage db_imageByTakingBlurBuffer:&result allocatedSize:bytes scale:self.scale tintColor:tintColor];
+    }
+    
+    DBProfileBlurBuffer buffer1 = source, buffer2 = source;
+    buffer1.data = [pool bufferWithSize:bytes];
+    buffer2.data = [pool bufferWithSize:bytes];
+    void *tempBuffer = [pool bufferWithSize:tempBufferSize];
+    
+    const DBProfileBlurBuffer *result = NULL;
+    if (algorithm != DBProfileBlurAlgorithmBox) {
+        memcpy(buffer1.data, source.data, bytes);
+        result = DBProfileBlurWithAlgorithm(algorithm, &buffer1, &buffer2, tempBuffer, variance);
+    }
+    else {
+        // The first iteration reads the source directly instead of copying it into a working buffer first
+        if (iterations > 0) {
+            DBProfileBlurBoxConvolve(&source, &buffer1, tempBuffer, boxSize);
+            iterations--;
+        }
+        else {
+            memcpy(buffer1.data, source.data, bytes);
+        }
+        result = DBProfileBlurBoxIterations(&buffer1, &buffer2, tempBuffer, boxSize, iterations);
+    }
+    const DBProfileBlurBuffer *unused = (result == &buffer1) ? &buffer2 : &buffer1;
+    
+    [pool recycleBuffer:unused->data size:bytes];
+    [pool recycleBuffer:tempBuffer size:tempBufferSize];
+    
+    return [sourceImage.normalizedImage db_imageByTakingBlurBuffer:result allocatedSize:bytes scale:self.scale tintColor:tintColor];
+}
+
+- (UIImage *)db_imageWithBlurBuffer:(const DBProfileBlurBuffer *)buffer scale:(CGFloat)scale tintColor:(UIColor *)tintColor {
+    size_t bytes = buffer->rowBytes * buffer->height;
+    DBProfileBlurBuffer copy = *buffer;
+    copy.data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:bytes];
+    memcpy(copy.data, buffer->data, bytes);
+    return [self db_imageByTakingBlurBuffer:&copy allocatedSize:bytes scale:scale tintColor:tintColor];
+}
+
+- (UIImage *)db_imageByTakingBlurBuffer:(const DBProfileBlurBuffer *)buffer allocatedSize:(size_t)allocatedSize scale:(CGFloat)scale tintColor:(UIColor *)tintColor {
+    CGImageRef imageRef = self.CGImage;
+    BOOL tinted = tintColor && CGColorGetAlpha(tintColor.CGColor) > 0.0f;
+    
+    // Apply tint in place, the context only wraps the buffer
+    if (tinted && buffer->format != DBProfileBlurPixelFormatGray8) {
+        CGContextRef ctx = CGBitmapContextCreate(buffer->data, buffer->width, buffer->height, 8, buffer->rowBytes, CGImageGetColorSpace(imageRef), CGImageGetBitmapInfo(imageRef));
+        DBProfileBlurApplyTint(ctx, tintColor, buffer->width, buffer->height);
+        CGContextRelease(ctx);
+    }
+    
+    CGImageRef blurredImageRef = DBProfileBlurCreateImageTakingBuffer(buffer, allocatedSize, CGImageGetColorSpace(imageRef), CGImageGetBitmapInfo(imageRef));
+    
+    UIImage *image = [UIImage imageWithCGImage:blurredImageRef scale:scale orientation:self.imageOrientation];
+    CGImageRelease(blurredImageRef);
+    
+    // Grayscale pixels cannot hold a colored tint, so tinted grayscale images are widened to 32-bit pixels
+    if (tinted && buffer->format == DBProfileBlurPixelFormatGray8) return [image db_imageByApplyingBlurTintColor:tintColor];
+    return image;
+}
+
+- (UIImage *)db_imageByApplyingBlurTintColor:(UIColor *)tintColor {
+    if (!tintColor || CGColorGetAlpha(tintColor.CGColor) <= 0.0f) return self;
+    
+    // 32-bit images keep their layout, grayscale images are widened to hold the color of the tint
+    CGImageRef imageRef = self.CGImage;
+    BOOL keepsLayout = CGImageGetBitsPerPixel(imageRef) == 32;
+    DBProfileBlurBuffer buffer = {NULL, CGImageGetWidth(imageRef), CGImageGetHeight(imageRef), keepsLayout ? CGImageGetBytesPerRow(imageRef) : CGImageGetWidth(imageRef) * 4, DBProfileBlurPixelFormat32};
+    size_t bytes = buffer.rowBytes * buffer.height;
+    buffer.data = [[DBProfileBlurBufferPool sharedPool] bufferWithSize:bytes];
+    
+    CGColorSpaceRef colorSpace = keepsLayout ? CGColorSpaceRetain(CGImageGetColorSpace(imageRef)) : CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = keepsLayout ? CGImageGetBitmapInfo(imageRef) : (CGBitmapInfo)kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little;
+    CGContextRef ctx = CGBitmapContextCreate(buffer.data, buffer.width, buffer.height, 8, buffer.rowBytes, colorSpace, bitmapInfo);
+    if (!ctx) {
+        [[DBProfileBlurBufferPool sharedPool] recycleBuffer:buffer.data size:bytes];
+        CGColorSpaceRelease(colorSpace);
+        return self;
+    }
+    CGContextSetBlendMode(ctx, kCGBlendModeCopy);
+    CGContextDrawImage(ctx, CGRectMake(0, 0, buffer.width, buffer.height), imageRef);
+    DBProfileBlurApplyTint(ctx, tintColor, buffer.width, buffer.height);
+    CGContextRelease(ctx);
+    
+    CGImageRef tintedImageRef = DBProfileBlurCreateImageTakingBuffer(&buffer, bytes, colorSpace, bitmapInfo);
+    CGColorSpaceRelease(colorSpace);
+    UIImage *image = [UIImage imageWithCGImage:tintedImageRef scale:self.scale orientation:self.imageOrientation];
+    CGImageRelease(tintedImageRef);
+    return image;
+}
+
+- (NSData *)db_rowDigests {
+    return objc_getAssociatedObject(self, @selector(db_rowDigests));
+}
+
+- (void)db_setRowDigests:(NSData *)rowDigests {
+    objc_setAssociatedObject(self, @selector(db_rowDigests), rowDigests, OBJC_ASSOCIATION_COPY_NONATOMIC);
+}
+
++ (NSData *)db_rowDigestsOfBitmapContext:(CGContextRef)context {
+    uint8_t *data = CGBitmapContextGetData(context);
+    if (!data || CGBitmapContextGetBitsPerPixel(context) != 32) return nil;
+    
+    DBProfileBlurBuffer buffer = {data, CGBitmapContextGetWidth(context), CGBitmapContextGetHeight(context), CGBitmapContextGetBytesPerRow(context), DBProfileBlurPixelFormat32};
+    NSMutableData *rowDigests = [NSMutableData dataWithLength:buffer.height * sizeof(uint64_t)];
+    DBProfileBlurRowDigests(&buffer, rowDigests.mutableBytes);
+    return rowDigests;
+}
+
+@end
@@ -0,0 +1,60 @@
+//
+//  DBProfileBlurBufferPoolTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurBufferPool.h>
+
+@interface DBProfileBlurBufferPoolTests : XCTestCase
+
+@property (nonatomic) DBProfileBlurBufferPool *pool;
+
+@end
+
+@implementation DBProfileBlurBufferPoolTests
+
+- (void)setUp {
+    [super setUp];
+    self.pool = [[DBProfileBlurBufferPool alloc] init];
+}
+
+- (void)testRecycledBufferIsReusedForSimilarSize {
+    void *buffer = [self.pool bufferWithSize:100000];
+    XCTAssertTrue(buffer != NULL);
+    [self.pool recycleBuffer:buffer size:100000];
+    XCTAssertGreaterThanOrEqual(self.pool.idleBytes, 100000);
+
+    void *reusedBuffer = [self.pool bufferWithSize:99000];
+    XCTAssertEqual(reusedBuffer, buffer);
+    XCTAssertEqual(self.pool.numberOfRequests, 2);
+    XCTAssertEqual(self.pool.numberOfReuses, 1);
+    XCTAssertEqual(self.pool.idleBytes, 0);
+    [self.pool recycleBuffer:reusedBuffer size:99000];
+}
+
+- (void)testIdleBytesStayBelowLimit {
+    self.pool.idleBytesLimit = 256 * 1024;
+    for (NSUInteger i = 0; i < 8; i++) {
+        size_t size = 64 * 1024 * (i % 3 + 1);
+        [self.pool recycleBuffer:[self.pool bufferWithSize:size] size:size];
+        [self.pool recycleBuffer:malloc(size) size:size];
+        XCTAssertLessThanOrEqual(self.pool.idleBytes, self.pool.idleBytesLimit);
+    }
+    [self.pool recycleBuffer:malloc(1024 * 1024) size:1024 * 1024];
+    XCTAssertLessThanOrEqual(self.pool.idleBytes, self.pool.idleBytesLimit, @"a buffer larger than the limit should be freed");
+}
+
+- (void)testTrimFreesIdleBuffers {
+    [self.pool recycleBuffer:[self.pool bufferWithSize:50000] size:50000];
+    [self.pool trim];
+    XCTAssertEqual(self.pool.idleBytes, 0);
+
+    [self.pool recycleBuffer:[self.pool bufferWithSize:50000] size:50000];
+    XCTAssertEqual(self.pool.numberOfReuses, 0);
+}
+
+@end
@@ -0,0 +1,172 @@
+//
+//  DBProfileBlurJobQueueTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurJobQueue.h>
+
+@interface DBProfileBlurJobQueueTests : XCTestCase
+
+@property (nonatomic) DBProfileBlurJobQueue *queue;
+@property (nonatomic) NSObject *owner;
+
+@end
+
+@implementation DBProfileBlurJobQueueTests
+
+- (void)setUp {
+    [super setUp];
+    self.queue = [[DBProfileBlurJobQueue alloc] init];
+    // A single job at a time lets the tests hold the queue busy with one job
+    self.queue.maxConcurrentJobs = 1;
+    self.owner = [[NSObject alloc] init];
+}
+
+- (void)testRedundantJobsAreCoalesced {
+    // Hold the queue busy with another owner's job so that the following jobs stay pending
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSObject *otherOwner = [[NSObject alloc] init];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(started);
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }];
+    dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+
+    NSMutableArray<NSNumber *> *generations = [NSMutableArray array];
+    DBProfileBlurJobToken *lastToken;
+    for (NSUInteger i = 0; i < 3; i++) {
+        lastToken = [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {
+            @synchronized (generations) {
+                [generations addObject:@(token.generation)];
+            }
+        }];
+    }
+    XCTAssertEqual(self.queue.queueDepth, 1);
+    XCTAssertEqual(self.queue.numberOfCoalescedJobs, 2);
+    XCTAssertEqual(lastToken.generation, 3);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"jobs ran"];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        [expectation fulfill];
+    }];
+    dispatch_semaphore_signal(semaphore);
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqualObjects(generations, @[@3], @"only the latest job for an owner should run");
+    XCTAssertEqual(self.queue.queueDepth, 0);
+}
+
+- (void)testNewerJobCancelsRunningJob {
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t resume = dispatch_semaphore_create(0);
+    __block BOOL wasCancelled = NO;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"first job finished"];
+    [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(started);
+        dispatch_semaphore_wait(resume, DISPATCH_TIME_FOREVER);
+        wasCancelled = token.isCancelled;
+        [expectation fulfill];
+    }];
+
+    dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+    [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {}];
+    dispatch_semaphore_signal(resume);
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertTrue(wasCancelled);
+}
+
+- (void)testCancelledJobNeverRuns {
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSObject *otherOwner = [[NSObject alloc] init];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(started);
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }];
+    dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+
+    __block BOOL didRun = NO;
+    DBProfileBlurJobToken *token = [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {
+        didRun = YES;
+    }];
+    [self.queue cancelJobsForOwner:self.owner];
+    XCTAssertTrue(token.isCancelled);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"jobs ran"];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        [expectation fulfill];
+    }];
+    dispatch_semaphore_signal(semaphore);
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertFalse(didRun);
+}
+
+- (void)testJobsOfDifferentOwnersRunConcurrently {
+    self.queue.maxConcurrentJobs = 2;
+
+    // Each job waits for the other to start, which only succeeds if both run at the same time
+    dispatch_semaphore_t firstStarted = dispatch_semaphore_create(0);
+    dispatch_semaphore_t secondStarted = dispatch_semaphore_create(0);
+    __block long firstResult = -1;
+    __block long secondResult = -1;
+
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"first job finished"];
+    [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(firstStarted);
+        firstResult = dispatch_semaphore_wait(secondStarted, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(2.0 * NSEC_PER_SEC)));
+        [firstExpectation fulfill];
+    }];
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"second job finished"];
+    NSObject *otherOwner = [[NSObject alloc] init];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(secondStarted);
+        secondResult = dispatch_semaphore_wait(firstStarted, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(2.0 * NSEC_PER_SEC)));
+        [secondExpectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqual(firstResult, 0);
+    XCTAssertEqual(secondResult, 0);
+}
+
+- (void)testDeferredOwnerRunsLast {
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSObject *otherOwner = [[NSObject alloc] init];
+    [self.queue enqueueJobForOwner:otherOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        dispatch_semaphore_signal(started);
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }];
+    dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+
+    // The deferred job is submitted first, but runs after the job of an owner that is not deferred
+    NSMutableArray<NSString *> *order = [NSMutableArray array];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"deferred job ran"];
+    [self.queue setJobsDeferred:YES forOwner:self.owner];
+    [self.queue enqueueJobForOwner:self.owner usingBlock:^(DBProfileBlurJobToken *token) {
+        @synchronized (order) {
+            [order addObject:@"deferred"];
+        }
+        [expectation fulfill];
+    }];
+    NSObject *visibleOwner = [[NSObject alloc] init];
+    [self.queue enqueueJobForOwner:visibleOwner usingBlock:^(DBProfileBlurJobToken *token) {
+        @synchronized (order) {
+            [order addObject:@"visible"];
+        }
+    }];
+    dispatch_semaphore_signal(semaphore);
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqualObjects(order, (@[@"visible", @"deferred"]));
+}
+
+@end
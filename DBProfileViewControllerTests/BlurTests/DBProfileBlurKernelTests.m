@@ -0,0 +1,425 @@
+//
+//  DBProfileBlurKernelTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurKernel.h>
+
+static const size_t DBProfileBlurKernelTestsWidth = 96;
+static const size_t DBProfileBlurKernelTestsHeight = 64;
+
+@interface DBProfileBlurKernelTests : XCTestCase
+
+@property (nonatomic) NSMutableData *pixels;
+
+@end
+
+@implementation DBProfileBlurKernelTests
+
+- (void)setUp {
+    [super setUp];
+    
+    // Use a padded row stride so the kernels are exercised with rowBytes != width * 4
+    srand48(42);
+    self.pixels = [NSMutableData dataWithLength:[self rowBytes] * DBProfileBlurKernelTestsHeight];
+    uint8_t *bytes = self.pixels.mutableBytes;
+    for (NSUInteger i = 0; i < self.pixels.length; i++) {
+        bytes[i] = (uint8_t)(lrand48() & 0xFF);
+    }
+}
+
+- (size_t)rowBytes {
+    return DBProfileBlurKernelTestsWidth * 4 + 12;
+}
+
+- (DBProfileBlurBuffer)bufferWithData:(NSMutableData *)data {
+    DBProfileBlurBuffer buffer = { data.mutableBytes, DBProfileBlurKernelTestsWidth, DBProfileBlurKernelTestsHeight, [self rowBytes] };
+    return buffer;
+}
+
+- (NSData *)boxConvolvedPixelsWithInstructionSet:(DBProfileBlurInstructionSet)instructionSet boxSize:(uint32_t)boxSize {
+    NSMutableData *output = [NSMutableData dataWithLength:self.pixels.length];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(DBProfileBlurKernelTestsWidth, boxSize)];
+    DBProfileBlurBuffer src = [self bufferWithData:self.pixels];
+    DBProfileBlurBuffer dst = [self bufferWithData:output];
+    XCTAssertTrue(DBProfileBlurBoxConvolveWithInstructionSet(&src, &dst, temp.mutableBytes, boxSize, instructionSet));
+    
+    // Only compare the visible part of each row
+    NSMutableData *visible = [NSMutableData data];
+    for (size_t y = 0; y < DBProfileBlurKernelTestsHeight; y++) {
+        [visible appendBytes:dst.data + y * dst.rowBytes length:DBProfileBlurKernelTestsWidth * 4];
+    }
+    return visible;
+}
+
+- (void)testInstructionSetsMatchScalar {
+    uint32_t boxSizes[] = { 1, 3, 9, 21, 63, 301 };
+    
+    for (size_t i = 0; i < sizeof(boxSizes) / sizeof(boxSizes[0]); i++) {
+        NSData *expected = [self boxConvolvedPixelsWithInstructionSet:DBProfileBlurInstructionSetScalar boxSize:boxSizes[i]];
+        
+        for (DBProfileBlurInstructionSet instructionSet = DBProfileBlurInstructionSetSSE2; instructionSet <= DBProfileBlurInstructionSetNEON; instructionSet++) {
+            if (!DBProfileBlurInstructionSetIsSupported(instructionSet)) continue;
+            NSData *actual = [self boxConvolvedPixelsWithInstructionSet:instructionSet boxSize:boxSizes[i]];
+            XCTAssertEqualObjects(actual, expected, @"instruction set %d should match scalar for box size %u", instructionSet, boxSizes[i]);
+        }
+    }
+}
+
+- (void)testStripsMatchFullConvolution {
+    uint32_t boxSizes[] = { 3, 21, 63, 301 };
+    
+    for (size_t i = 0; i < sizeof(boxSizes) / sizeof(boxSizes[0]); i++) {
+        NSMutableData *expected = [NSMutableData dataWithLength:self.pixels.length];
+        NSMutableData *actual = [NSMutableData dataWithLength:self.pixels.length];
+        NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(DBProfileBlurKernelTestsWidth, boxSizes[i])];
+        DBProfileBlurBuffer src = [self bufferWithData:self.pixels];
+        DBProfileBlurBuffer expectedBuffer = [self bufferWithData:expected];
+        DBProfileBlurBuffer actualBuffer = [self bufferWithData:actual];
+        DBProfileBlurBoxConvolve(&src, &expectedBuffer, temp.mutableBytes, boxSizes[i]);
+        
+        // Uneven strips, including strips shorter than the box
+        for (size_t firstRow = 0, numberOfRows = 1; firstRow < DBProfileBlurKernelTestsHeight; firstRow += numberOfRows, numberOfRows += 4) {
+            DBProfileBlurBoxConvolveRows(&src, &actualBuffer, temp.mutableBytes, boxSizes[i], firstRow, numberOfRows);
+        }
+        
+        for (size_t y = 0; y < DBProfileBlurKernelTestsHeight; y++) {
+            XCTAssertEqual(memcmp(expectedBuffer.data + y * expectedBuffer.rowBytes, actualBuffer.data + y * actualBuffer.rowBytes, DBProfileBlurKernelTestsWidth * 4), 0, @"row %@ of box %@ should match", @(y), @(boxSizes[i]));
+        }
+    }
+}
+
+- (void)testStreamedBoxesMatchDownsampleAndConvolve {
+    uint32_t boxSizes[] = { 21, 9, 63 };
+    
+    for (size_t levels = 0; levels <= DBProfileBlurPyramidMaximumLevel; levels++) {
+        NSMutableData *expected = [self.pixels mutableCopy];
+        NSMutableData *scratch = [NSMutableData dataWithLength:self.pixels.length];
+        NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(DBProfileBlurKernelTestsWidth, 63)];
+        DBProfileBlurBuffer expectedBuffer = [self bufferWithData:expected];
+        DBProfileBlurBuffer scratchBuffer = [self bufferWithData:scratch];
+        for (size_t level = 0; level < levels; level++) DBProfileBlurDownsample(&expectedBuffer);
+        scratchBuffer.width = expectedBuffer.width;
+        scratchBuffer.height = expectedBuffer.height;
+        scratchBuffer.rowBytes = expectedBuffer.rowBytes;
+        const DBProfileBlurBuffer *result = &expectedBuffer, *destination = &scratchBuffer;
+        for (size_t i = 0; i < 3; i++) {
+            DBProfileBlurBoxConvolve(result, destination, temp.mutableBytes, boxSizes[i]);
+            const DBProfileBlurBuffer *swap = result;
+            result = destination;
+            destination = swap;
+        }
+        
+        // Strips of a few rows, much shorter than the halo of the boxes
+        DBProfileBlurBuffer src = [self bufferWithData:self.pixels];
+        size_t stripHeight = DBProfileBlurStreamStripHeight(src.width, src.height, src.format, boxSizes, 3, levels, 0) / 8 + 1;
+        NSMutableData *window = [NSMutableData dataWithLength:DBProfileBlurStreamWindowSize(src.width, src.height, src.format, boxSizes, 3, levels, stripHeight)];
+        NSMutableData *actual = [NSMutableData dataWithLength:self.pixels.length];
+        DBProfileBlurBuffer actualBuffer = [self bufferWithData:actual];
+        DBProfileBlurDownsampledSize(&actualBuffer.width, &actualBuffer.height, levels);
+        DBProfileBlurStreamBoxes(&src, &actualBuffer, window.mutableBytes, boxSizes, 3, levels, stripHeight);
+        
+        for (size_t y = 0; y < result->height; y++) {
+            XCTAssertEqual(memcmp(result->data + y * result->rowBytes, actualBuffer.data + y * actualBuffer.rowBytes, result->width * 4), 0, @"row %@ at level %@ should match", @(y), @(levels));
+        }
+    }
+}
+
+- (void)testChangedRowsSpanFirstToLastChangedRow {
+    const size_t height = DBProfileBlurKernelTestsHeight;
+    DBProfileBlurBuffer buffer = [self bufferWithData:self.pixels];
+    NSMutableData *previousDigests = [NSMutableData dataWithLength:height * sizeof(uint64_t)];
+    NSMutableData *digests = [NSMutableData dataWithLength:height * sizeof(uint64_t)];
+    DBProfileBlurRowDigests(&buffer, previousDigests.mutableBytes);
+
+    size_t firstRow, numberOfRows;
+    DBProfileBlurRowDigests(&buffer, digests.mutableBytes);
+    XCTAssertFalse(DBProfileBlurChangedRows(digests.bytes, previousDigests.bytes, height, &firstRow, &numberOfRows));
+    XCTAssertEqual(numberOfRows, 0);
+
+    // A change in the row padding is not a change of the pixels
+    buffer.data[3 * buffer.rowBytes + buffer.width * 4] ^= 1;
+    buffer.data[12 * buffer.rowBytes + 5] ^= 1;
+    buffer.data[40 * buffer.rowBytes + buffer.width * 4 - 1] ^= 1;
+    DBProfileBlurRowDigests(&buffer, digests.mutableBytes);
+    XCTAssertTrue(DBProfileBlurChangedRows(digests.bytes, previousDigests.bytes, height, &firstRow, &numberOfRows));
+    XCTAssertEqual(firstRow, 12);
+    XCTAssertEqual(numberOfRows, 29);
+}
+
+- (void)testGrayscaleMatchesReplicatedChannels {
+    // Every channel of a 32-bit pixel is blurred exactly like the single channel of a grayscale pixel with the same value
+    const size_t width = DBProfileBlurKernelTestsWidth, height = DBProfileBlurKernelTestsHeight, grayRowBytes = width + 3;
+    NSMutableData *gray = [NSMutableData dataWithLength:grayRowBytes * height];
+    NSMutableData *grayOutput = [NSMutableData dataWithLength:gray.length];
+    NSMutableData *output = [NSMutableData dataWithLength:self.pixels.length];
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            uint8_t value = ((uint8_t *)self.pixels.mutableBytes)[y * [self rowBytes] + x * 4];
+            ((uint8_t *)gray.mutableBytes)[y * grayRowBytes + x] = value;
+            memset((uint8_t *)self.pixels.mutableBytes + y * [self rowBytes] + x * 4, value, 4);
+        }
+    }
+    
+    DBProfileBlurBuffer src = [self bufferWithData:self.pixels], dst = [self bufferWithData:output];
+    DBProfileBlurBuffer graySrc = { gray.mutableBytes, width, height, grayRowBytes, DBProfileBlurPixelFormatGray8 };
+    DBProfileBlurBuffer grayDst = { grayOutput.mutableBytes, width, height, grayRowBytes, DBProfileBlurPixelFormatGray8 };
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(width, 21)];
+    DBProfileBlurBoxConvolve(&src, &dst, temp.mutableBytes, 21);
+    DBProfileBlurBoxConvolve(&graySrc, &grayDst, temp.mutableBytes, 21);
+    
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            XCTAssertEqual(grayDst.data[y * grayRowBytes + x], dst.data[y * dst.rowBytes + x * 4]);
+        }
+    }
+}
+
+- (void)testConstantImageIsUnchanged {
+    memset(self.pixels.mutableBytes, 0x80, self.pixels.length);
+    
+    NSData *output = [self boxConvolvedPixelsWithInstructionSet:DBProfileBlurGetInstructionSet() boxSize:21];
+    const uint8_t *bytes = output.bytes;
+    for (NSUInteger i = 0; i < output.length; i++) {
+        XCTAssertEqual(bytes[i], 0x80, @"blurring a constant image should not change it");
+        if (bytes[i] != 0x80) break;
+    }
+}
+
+- (void)testGaussianMatchesReference {
+    const double sigma = 6.0;
+    const NSInteger radius = (NSInteger)ceil(sigma * 4);
+    const NSInteger width = DBProfileBlurKernelTestsWidth, height = DBProfileBlurKernelTestsHeight;
+    
+    NSData *original = [self.pixels copy];
+    const uint8_t *source = original.bytes;
+    
+    uint32_t boxSizes[3];
+    DBProfileBlurGaussianBoxSizes(sigma, 3, boxSizes);
+    
+    NSMutableData *scratch = [NSMutableData dataWithLength:self.pixels.length];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(width, boxSizes[2])];
+    DBProfileBlurBuffer buffer = [self bufferWithData:self.pixels];
+    DBProfileBlurBuffer scratchBuffer = [self bufferWithData:scratch];
+    const DBProfileBlurBuffer *result = DBProfileBlurGaussian(&buffer, &scratchBuffer, temp.mutableBytes, sigma);
+    
+    // Reference separable Gaussian in double precision
+    double kernel[2 * radius + 1];
+    double kernelSum = 0;
+    for (NSInteger i = -radius; i <= radius; i++) {
+        kernel[i + radius] = exp(-(i * i) / (2 * sigma * sigma));
+        kernelSum += kernel[i + radius];
+    }
+    
+    NSMutableData *verticalData = [NSMutableData dataWithLength:width * height * 4 * sizeof(double)];
+    double *vertical = verticalData.mutableBytes;
+    for (NSInteger y = 0; y < height; y++) {
+        for (NSInteger x = 0; x < width * 4; x++) {
+            double sum = 0;
+            for (NSInteger i = -radius; i <= radius; i++) {
+                NSInteger row = MIN(MAX(y + i, 0), height - 1);
+                sum += kernel[i + radius] * source[row * [self rowBytes] + x];
+            }
+            vertical[y * width * 4 + x] = sum / kernelSum;
+        }
+    }
+    
+    // Iterated boxes extend the already blurred edges, so only the interior is compared
+    double maximumError = 0;
+    for (NSInteger y = radius; y < height - radius; y++) {
+        for (NSInteger x = radius; x < width - radius; x++) {
+            for (NSInteger c = 0; c < 4; c++) {
+                double sum = 0;
+                for (NSInteger i = -radius; i <= radius; i++) {
+                    sum += kernel[i + radius] * vertical[y * width * 4 + (x + i) * 4 + c];
+                }
+                double actual = result->data[y * result->rowBytes + x * 4 + c];
+                maximumError = MAX(maximumError, fabs(actual - sum / kernelSum));
+            }
+        }
+    }
+    
+    XCTAssertLessThanOrEqual(maximumError, 2.0, @"gaussian approximation should be within 2 levels of the reference");
+}
+
+- (double)rootMeanSquareErrorOfAlgorithm:(DBProfileBlurAlgorithm)algorithm sigma:(double)sigma {
+    const NSInteger radius = (NSInteger)ceil(sigma * 4), margin = (NSInteger)ceil(sigma * 2);
+    const NSInteger width = DBProfileBlurKernelTestsWidth, height = DBProfileBlurKernelTestsHeight;
+    
+    NSMutableData *pixels = [self.pixels mutableCopy];
+    const uint8_t *source = self.pixels.bytes;
+    
+    NSMutableData *scratch = [NSMutableData dataWithLength:pixels.length];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurAlgorithmTempBufferSize(algorithm, width, height, sigma * sigma)];
+    DBProfileBlurBuffer buffer = [self bufferWithData:pixels];
+    DBProfileBlurBuffer scratchBuffer = [self bufferWithData:scratch];
+    const DBProfileBlurBuffer *result = DBProfileBlurWithAlgorithm(algorithm, &buffer, &scratchBuffer, temp.mutableBytes, sigma * sigma);
+    
+    // Reference separable Gaussian in double precision, extending the edges like the kernels do
+    double kernel[2 * radius + 1];
+    double kernelSum = 0;
+    for (NSInteger i = -radius; i <= radius; i++) {
+        kernel[i + radius] = exp(-(i * i) / (2 * sigma * sigma));
+        kernelSum += kernel[i + radius];
+    }
+    
+    NSMutableData *verticalData = [NSMutableData dataWithLength:width * height * 4 * sizeof(double)];
+    double *vertical = verticalData.mutableBytes;
+    for (NSInteger y = 0; y < height; y++) {
+        for (NSInteger x = 0; x < width * 4; x++) {
+            double sum = 0;
+            for (NSInteger i = -radius; i <= radius; i++) {
+                NSInteger row = MIN(MAX(y + i, 0), height - 1);
+                sum += kernel[i + radius] * source[row * [self rowBytes] + x];
+            }
+            vertical[y * width * 4 + x] = sum / kernelSum;
+        }
+    }
+    
+    // The algorithms treat the edges differently, so only pixels at least two sigma inside are compared
+    double squaredError = 0;
+    NSUInteger count = 0;
+    for (NSInteger y = margin; y < height - margin; y++) {
+        for (NSInteger x = margin; x < width - margin; x++) {
+            for (NSInteger c = 0; c < 4; c++) {
+                double sum = 0;
+                for (NSInteger i = -radius; i <= radius; i++) {
+                    NSInteger column = MIN(MAX(x + i, 0), width - 1);
+                    sum += kernel[i + radius] * vertical[y * width * 4 + column * 4 + c];
+                }
+                double error = result->data[y * result->rowBytes + x * 4 + c] - sum / kernelSum;
+                squaredError += error * error;
+                count++;
+            }
+        }
+    }
+    return sqrt(squaredError / count);
+}
+
+- (void)testAlgorithmsMatchReference {
+    XCTAssertLessThanOrEqual([self rootMeanSquareErrorOfAlgorithm:DBProfileBlurAlgorithmBox sigma:6.0], 1.0);
+    XCTAssertLessThanOrEqual([self rootMeanSquareErrorOfAlgorithm:DBProfileBlurAlgorithmStack sigma:6.0], 1.0);
+    XCTAssertLessThanOrEqual([self rootMeanSquareErrorOfAlgorithm:DBProfileBlurAlgorithmDualKawase sigma:6.0], 1.0);
+    XCTAssertLessThanOrEqual([self rootMeanSquareErrorOfAlgorithm:DBProfileBlurAlgorithmRecursiveGaussian sigma:6.0], 1.0);
+}
+
+- (void)testAlgorithmVarianceMatchesRequest {
+    // Box and stack blurs round to the kernels they have, the other algorithms apply any variance they are asked for
+    XCTAssertEqual(DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithmBox, 0.1), 0.0);
+    XCTAssertEqualWithAccuracy(DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithmStack, 256.0), 256.0, 16.0);
+    XCTAssertEqual(DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithmDualKawase, 256.0), 256.0);
+    XCTAssertEqual(DBProfileBlurAlgorithmVariance(DBProfileBlurAlgorithmRecursiveGaussian, 256.0), 256.0);
+}
+
+- (void)testGaussianBoxSizesAreOdd {
+    uint32_t sizes[3];
+    DBProfileBlurGaussianBoxSizes(10.0, 3, sizes);
+    
+    for (size_t i = 0; i < 3; i++) {
+        XCTAssertTrue(sizes[i] % 2 == 1, @"box sizes should be odd");
+    }
+    XCTAssertLessThanOrEqual(sizes[0], sizes[2], @"box sizes should be ascending");
+}
+
+- (void)testSummedAreaTableBoxMatchesBoxConvolve {
+    const uint32_t boxSize = 9;
+    const size_t radius = boxSize / 2;
+    NSData *expected = [self boxConvolvedPixelsWithInstructionSet:DBProfileBlurGetInstructionSet() boxSize:boxSize];
+    
+    NSMutableData *table = [NSMutableData dataWithLength:DBProfileBlurSummedAreaTableSize(DBProfileBlurKernelTestsWidth, DBProfileBlurKernelTestsHeight)];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurSummedAreaTableTempBufferSize(DBProfileBlurKernelTestsWidth)];
+    NSMutableData *output = [NSMutableData dataWithLength:self.pixels.length];
+    DBProfileBlurBuffer src = [self bufferWithData:self.pixels];
+    DBProfileBlurBuffer dst = [self bufferWithData:output];
+    DBProfileBlurSummedAreaTableBuild(&src, table.mutableBytes);
+    DBProfileBlurSummedAreaTableBoxes(table.bytes, &dst, temp.mutableBytes, &boxSize, 1);
+    
+    // The separable kernel rounds between passes, so the two may differ by one level away from the edges
+    const uint8_t *expectedBytes = expected.bytes;
+    for (size_t y = radius; y < DBProfileBlurKernelTestsHeight - radius; y++) {
+        for (size_t x = radius * 4; x < (DBProfileBlurKernelTestsWidth - radius) * 4; x++) {
+            int difference = abs((int)dst.data[y * dst.rowBytes + x] - (int)expectedBytes[y * DBProfileBlurKernelTestsWidth * 4 + x]);
+            XCTAssertLessThanOrEqual(difference, 1);
+            if (difference > 1) return;
+        }
+    }
+}
+
+- (void)testDownsampleAveragesBlocks {
+    DBProfileBlurBuffer buffer = [self bufferWithData:self.pixels];
+    NSData *original = [self.pixels copy];
+    const uint8_t *source = original.bytes;
+    
+    DBProfileBlurDownsample(&buffer);
+    
+    XCTAssertEqual(buffer.width, DBProfileBlurKernelTestsWidth / 2);
+    XCTAssertEqual(buffer.height, DBProfileBlurKernelTestsHeight / 2);
+    XCTAssertEqual(buffer.rowBytes, buffer.width * 4);
+    
+    for (size_t y = 0; y < buffer.height; y++) {
+        for (size_t x = 0; x < buffer.width * 4; x++) {
+            const uint8_t *top = source + 2 * y * [self rowBytes] + (x / 4) * 8 + x % 4;
+            const uint8_t *bottom = top + [self rowBytes];
+            uint8_t expected = (uint8_t)((top[0] + top[4] + bottom[0] + bottom[4] + 2) / 4);
+            XCTAssertEqual(buffer.data[y * buffer.rowBytes + x], expected);
+            if (buffer.data[y * buffer.rowBytes + x] != expected) return;
+        }
+    }
+}
+
+- (void)testPyramidLevelGrowsWithVariance {
+    XCTAssertEqual(DBProfileBlurPyramidLevelForVariance(0.0, DBProfileBlurPyramidMaximumLevel), 0);
+    XCTAssertEqual(DBProfileBlurPyramidLevelForVariance(16.0, DBProfileBlurPyramidMaximumLevel), 1);
+    XCTAssertEqual(DBProfileBlurPyramidLevelForVariance(10000.0, DBProfileBlurPyramidMaximumLevel), DBProfileBlurPyramidMaximumLevel);
+    XCTAssertEqual(DBProfileBlurPyramidLevelForVariance(10000.0, 1), 1);
+}
+
+- (void)testBoxConvolvePerformance {
+    const size_t width = 1242, height = 480;
+    NSMutableData *source = [NSMutableData dataWithLength:width * height * 4];
+    NSMutableData *destination = [NSMutableData dataWithLength:width * height * 4];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(width, 61)];
+    DBProfileBlurBuffer src = { source.mutableBytes, width, height, width * 4 };
+    DBProfileBlurBuffer dst = { destination.mutableBytes, width, height, width * 4 };
+    
+    [self measureBlock:^{
+        DBProfileBlurBoxConvolve(&src, &dst, temp.mutableBytes, 61);
+    }];
+}
+
+- (void)measureAlgorithm:(DBProfileBlurAlgorithm)algorithm {
+    // The same size as the box convolution, at the variance of the largest stage of a default blur view
+    const size_t width = 1242, height = 480;
+    const double variance = 256.0;
+    NSMutableData *source = [NSMutableData dataWithLength:width * height * 4];
+    NSMutableData *scratch = [NSMutableData dataWithLength:width * height * 4];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurAlgorithmTempBufferSize(algorithm, width, height, variance)];
+    DBProfileBlurBuffer buffer = { source.mutableBytes, width, height, width * 4 };
+    DBProfileBlurBuffer scratchBuffer = { scratch.mutableBytes, width, height, width * 4 };
+    
+    [self measureBlock:^{
+        DBProfileBlurWithAlgorithm(algorithm, &buffer, &scratchBuffer, temp.mutableBytes, variance);
+    }];
+}
+
+- (void)testBoxAlgorithmPerformance {
+    [self measureAlgorithm:DBProfileBlurAlgorithmBox];
+}
+
+- (void)testStackAlgorithmPerformance {
+    [self measureAlgorithm:DBProfileBlurAlgorithmStack];
+}
+
+- (void)testDualKawaseAlgorithmPerformance {
+    [self measureAlgorithm:DBProfileBlurAlgorithmDualKawase];
+}
+
+- (void)testRecursiveGaussianAlgorithmPerformance {
+    [self measureAlgorithm:DBProfileBlurAlgorithmRecursiveGaussian];
+}
+
+@end
@@ -0,0 +1,241 @@
+//
+//  DBProfileBlurSchedulerTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBackdropBlurView.h>
+#import <DBProfileViewController/DBProfileBackdropBlurView_Private.h>
+#import <DBProfileViewController/DBProfileBlurScheduler_Private.h>
+#import <DBProfileViewController/UIImage+DBProfileViewController.h>
+
+@interface DBProfileBlurSchedulerTests : XCTestCase
+
+@property (nonatomic) DBProfileBlurScheduler *scheduler;
+@property (nonatomic) NSArray<DBProfileBackdropBlurView *> *views;
+
+@end
+
+@implementation DBProfileBlurSchedulerTests
+
+- (void)setUp {
+    [super setUp];
+
+    self.scheduler = [[DBProfileBlurScheduler alloc] init];
+    NSMutableArray<DBProfileBackdropBlurView *> *views = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 8; i++) {
+        [views addObject:[[DBProfileBackdropBlurView alloc] initWithFrame:CGRectMake(0, 0, 32, 32)]];
+    }
+    self.views = views;
+}
+
+- (void)tearDown {
+    // The display link retains the scheduler, so it is invalidated for the scheduler to be released
+    [self.scheduler.displayLink invalidate];
+    [super tearDown];
+}
+
+- (void)assertHeapIsValid {
+    NSArray<DBProfileBackdropBlurView *> *dueViews = self.scheduler.dueViews;
+    for (NSUInteger index = 0; index < dueViews.count; index++) {
+        XCTAssertEqual(dueViews[index].dueIndex, index, @"every view should know its index in the heap");
+        if (index > 0) {
+            XCTAssertLessThanOrEqual(dueViews[(index - 1) / 2].dueTime, dueViews[index].dueTime, @"no view should be due before its parent");
+        }
+    }
+}
+
+- (void)scheduleViewsWithDueTimes:(NSArray<NSNumber *> *)dueTimes {
+    [dueTimes enumerateObjectsUsingBlock:^(NSNumber *dueTime, NSUInteger index, BOOL *stop) {
+        [self.scheduler scheduleView:self.views[index] dueTime:dueTime.doubleValue];
+        [self assertHeapIsValid];
+    }];
+}
+
+- (NSArray<NSNumber *> *)dueTimesOfViewsPoppedBefore:(CFTimeInterval)time {
+    NSMutableArray<NSNumber *> *dueTimes = [NSMutableArray array];
+    DBProfileBackdropBlurView *view = nil;
+    while ((view = [self.scheduler popDueViewBefore:time])) {
+        XCTAssertEqual(view.dueIndex, NSNotFound);
+        [dueTimes addObject:@(view.dueTime)];
+        [self assertHeapIsValid];
+    }
+    return dueTimes;
+}
+
+- (void)testViewsArePoppedInOrderOfDueTime {
+    [self scheduleViewsWithDueTimes:@[@5, @3, @8, @1, @9, @2, @7, @4]];
+
+    XCTAssertNil([self.scheduler popDueViewBefore:0.5], @"no view should be due before the first due time");
+    XCTAssertEqualObjects([self dueTimesOfViewsPoppedBefore:4], (@[@1, @2, @3, @4]));
+    XCTAssertEqualObjects([self dueTimesOfViewsPoppedBefore:100], (@[@5, @7, @8, @9]));
+    XCTAssertEqual(self.scheduler.dueViews.count, 0);
+}
+
+- (void)testReschedulingViewSiftsItUpAndDown {
+    [self scheduleViewsWithDueTimes:@[@1, @2, @3, @4, @5, @6, @7, @8]];
+
+    // The root moves to the bottom of the heap, then a leaf moves to the root
+    [self.scheduler scheduleView:self.views[0] dueTime:10];
+    [self assertHeapIsValid];
+    XCTAssertEqual(self.scheduler.dueViews.firstObject, self.views[1]);
+
+    [self.scheduler scheduleView:self.views[7] dueTime:0];
+    [self assertHeapIsValid];
+    XCTAssertEqual(self.scheduler.dueViews.firstObject, self.views[7]);
+    XCTAssertEqual(self.scheduler.dueViews.count, 8, @"a view already in the heap should not be added twice");
+
+    XCTAssertEqualObjects([self dueTimesOfViewsPoppedBefore:100], (@[@0, @2, @3, @4, @5, @6, @7, @10]));
+}
+
+- (void)testUnschedulingViewRemovesItByIndex {
+    [self scheduleViewsWithDueTimes:@[@1, @6, @2, @7, @8, @3, @4, @5]];
+
+    // Removing a view from the middle of the heap moves the last view into its place, which may have to move either way
+    DBProfileBackdropBlurView *view = self.views[1];
+    [self.scheduler unscheduleView:view];
+    [self assertHeapIsValid];
+    XCTAssertEqual(view.dueIndex, NSNotFound);
+    XCTAssertFalse([self.scheduler.dueViews containsObject:view]);
+
+    [self.scheduler unscheduleView:view];
+    [self.scheduler unscheduleView:self.views[0]];
+    [self assertHeapIsValid];
+    XCTAssertEqual(self.scheduler.dueViews.count, 6);
+
+    XCTAssertEqualObjects([self dueTimesOfViewsPoppedBefore:100], (@[@2, @3, @4, @5, @7, @8]));
+}
+
+- (void)testNestedDisablingPausesDisplayLinkUntilBalanced {
+    [self.scheduler addView:self.views[0]];
+    XCTAssertFalse(self.scheduler.displayLink.paused, @"a view added is due at once");
+
+    [self.scheduler setUpdatesDisabled];
+    [self.scheduler setUpdatesDisabled];
+    XCTAssertTrue(self.scheduler.displayLink.paused);
+
+    [self.scheduler setUpdatesEnabled];
+    XCTAssertTrue(self.scheduler.displayLink.paused, @"updates should stay disabled until every call is balanced");
+
+    [self.scheduler setUpdatesEnabled];
+    XCTAssertFalse(self.scheduler.displayLink.paused);
+}
+
+- (void)testDisplayLinkStaysPausedWhileNoViewIsDue {
+    XCTAssertTrue(self.scheduler.displayLink.paused, @"an idle scheduler should never wake up");
+
+    [self.scheduler addView:self.views[0]];
+    XCTAssertFalse(self.scheduler.displayLink.paused);
+
+    // A view due in a few seconds wakes the scheduler with a timer instead of the display link
+    [self.scheduler scheduleView:self.views[0] dueTime:CACurrentMediaTime() + 10.0];
+    [self.scheduler updateAsynchronously];
+    XCTAssertTrue(self.scheduler.displayLink.paused);
+
+    [self.scheduler scheduleView:self.views[0] dueTime:CACurrentMediaTime()];
+    self.scheduler.blurEnabled = NO;
+    XCTAssertTrue(self.scheduler.displayLink.paused, @"nothing should be due while blurring is off");
+
+    self.scheduler.blurEnabled = YES;
+    XCTAssertFalse(self.scheduler.displayLink.paused);
+
+    [self.scheduler removeView:self.views[0]];
+    XCTAssertTrue(self.scheduler.displayLink.paused);
+}
+
+#pragma mark - Shared Snapshots
+
+// Two blur views side by side in a bar over a striped backdrop, so they hide the same layers of the same backdrop
+- (UIView *)backdropWithBlurViews:(NSArray<DBProfileBackdropBlurView *> *)blurViews frames:(NSArray<NSValue *> *)frames {
+    UIView *backdrop = [[UIView alloc] initWithFrame:CGRectMake(0, 0, 200, 160)];
+    backdrop.backgroundColor = [UIColor whiteColor];
+    for (NSUInteger stripe = 0; stripe < 10; stripe++) {
+        UIView *stripeView = [[UIView alloc] initWithFrame:CGRectMake(stripe * 20, 0, 12, 160)];
+        stripeView.backgroundColor = [UIColor colorWithHue:stripe / 10.0 saturation:0.8 brightness:0.9 alpha:1.0];
+        [backdrop addSubview:stripeView];
+    }
+
+    UIView *bar = [[UIView alloc] initWithFrame:backdrop.bounds];
+    [backdrop addSubview:bar];
+    [blurViews enumerateObjectsUsingBlock:^(DBProfileBackdropBlurView *blurView, NSUInteger index, BOOL *stop) {
+        blurView.frame = frames[index].CGRectValue;
+        blurView.blurRadius = 8.0;
+        blurView.underlyingView = backdrop;
+        [bar addSubview:blurView];
+    }];
+    return backdrop;
+}
+
+- (NSData *)pixelsOfImage:(UIImage *)image {
+    CGImageRef imageRef = image.CGImage;
+    NSMutableData *pixels = [NSMutableData data];
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    for (size_t y = 0; y < CGImageGetHeight(imageRef); y++) {
+        [pixels appendBytes:CFDataGetBytePtr(data) + y * CGImageGetBytesPerRow(imageRef) length:CGImageGetWidth(imageRef) * 4];
+    }
+    CFRelease(data);
+    return pixels;
+}
+
+- (void)testViewsOverSameBackdropShareSnapshot {
+    NSArray<DBProfileBackdropBlurView *> *blurViews = @[self.views[0], self.views[1]];
+    UIView *backdrop = [self backdropWithBlurViews:blurViews frames:@[[NSValue valueWithCGRect:CGRectMake(0, 60, 100, 40)],
+                                                                      [NSValue valueWithCGRect:CGRectMake(100, 60, 100, 40)]]];
+    XCTAssertEqualObjects([blurViews[0] snapshotKey], [blurViews[1] snapshotKey]);
+
+    NSMapTable<DBProfileBackdropBlurView *, UIImage *> *snapshots = [self.scheduler sharedSnapshotsForViews:blurViews];
+    XCTAssertEqual(snapshots.count, 2);
+
+    // The crop of each view holds the same pixels as a snapshot the view takes on its own
+    for (DBProfileBackdropBlurView *blurView in blurViews) {
+        UIImage *sharedSnapshot = [snapshots objectForKey:blurView];
+        UIImage *snapshot = [blurView snapshotOfUnderlyingViewInRect:[blurView snapshotRect] scale:[blurView snapshotScale]];
+        XCTAssertNotNil(sharedSnapshot);
+        XCTAssertEqual(sharedSnapshot.scale, snapshot.scale);
+        XCTAssertEqual(CGImageGetWidth(sharedSnapshot.CGImage), CGImageGetWidth(snapshot.CGImage));
+        XCTAssertEqual(CGImageGetHeight(sharedSnapshot.CGImage), CGImageGetHeight(snapshot.CGImage));
+        XCTAssertEqualObjects([self pixelsOfImage:sharedSnapshot], [self pixelsOfImage:snapshot]);
+        XCTAssertEqualObjects(sharedSnapshot.db_rowDigests, snapshot.db_rowDigests);
+        XCTAssertEqual(blurView.underlyingView, backdrop);
+    }
+}
+
+- (void)testViewsFarApartSnapshotOnTheirOwn {
+    // The union of two corners of the backdrop holds far more pixels than the two views together
+    NSArray<DBProfileBackdropBlurView *> *blurViews = @[self.views[0], self.views[1]];
+    UIView *backdrop = [self backdropWithBlurViews:blurViews frames:@[[NSValue valueWithCGRect:CGRectMake(0, 0, 40, 40)],
+                                                                      [NSValue valueWithCGRect:CGRectMake(160, 120, 40, 40)]]];
+
+    XCTAssertEqual(blurViews[0].underlyingView, backdrop);
+    XCTAssertEqual([self.scheduler sharedSnapshotsForViews:blurViews].count, 0);
+}
+
+- (void)testViewsOverDifferentBackdropsSnapshotOnTheirOwn {
+    UIView *backdrop = [self backdropWithBlurViews:@[self.views[0]] frames:@[[NSValue valueWithCGRect:CGRectMake(0, 60, 100, 40)]]];
+    UIView *otherBackdrop = [self backdropWithBlurViews:@[self.views[1]] frames:@[[NSValue valueWithCGRect:CGRectMake(100, 60, 100, 40)]]];
+
+    XCTAssertEqual(self.views[0].underlyingView, backdrop);
+    XCTAssertEqual(self.views[1].underlyingView, otherBackdrop);
+    XCTAssertNotEqualObjects([self.views[0] snapshotKey], [self.views[1] snapshotKey]);
+    XCTAssertEqual([self.scheduler sharedSnapshotsForViews:@[self.views[0], self.views[1]]].count, 0);
+}
+
+- (void)testSnapshotInRectIsClippedToSnapshot {
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(20, 10), NO, 2.0);
+    [[UIColor redColor] setFill];
+    UIRectFill(CGRectMake(0, 0, 20, 10));
+    UIImage *snapshot = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+
+    CGRect snapshotRect = CGRectMake(100, 50, 20, 10);
+    UIImage *crop = [self.scheduler snapshotInRect:CGRectMake(110, 55, 20, 10) ofSnapshot:snapshot inRect:snapshotRect];
+    XCTAssertEqual(CGImageGetWidth(crop.CGImage), 20);
+    XCTAssertEqual(CGImageGetHeight(crop.CGImage), 10);
+    XCTAssertEqual(crop.scale, 2.0);
+    XCTAssertNil([self.scheduler snapshotInRect:CGRectMake(130, 50, 10, 10) ofSnapshot:snapshot inRect:snapshotRect]);
+}
+
+@end
@@ -0,0 +1,98 @@
+//
+//  DBProfileBlurSourceImageTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurSourceImage.h>
+#import <DBProfileViewController/DBProfileBlurStageGenerator.h>
+
+@interface DBProfileBlurSourceImageTests : XCTestCase
+
+@end
+
+@implementation DBProfileBlurSourceImageTests
+
+- (UIImage *)imageWithColorSpace:(CGColorSpaceRef)colorSpace bitmapInfo:(CGBitmapInfo)bitmapInfo bytesPerPixel:(size_t)bytesPerPixel {
+    const size_t width = 64, height = 48;
+    CGContextRef ctx = CGBitmapContextCreate(NULL, width, height, 8, width * bytesPerPixel, colorSpace, bitmapInfo);
+    for (size_t i = 0; i < 8; i++) {
+        CGContextSetGrayFillColor(ctx, i / 8.0, 1.0);
+        CGContextFillRect(ctx, CGRectMake(i * 8, 0, 8, height));
+    }
+    CGImageRef imageRef = CGBitmapContextCreateImage(ctx);
+    UIImage *image = [UIImage imageWithCGImage:imageRef scale:2.0 orientation:UIImageOrientationUp];
+    CGImageRelease(imageRef);
+    CGContextRelease(ctx);
+    return image;
+}
+
+- (void)testImageKernelsCanReadIsNotRedrawn {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    UIImage *image = [self imageWithColorSpace:colorSpace bitmapInfo:(CGBitmapInfo)kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little bytesPerPixel:4];
+    CGColorSpaceRelease(colorSpace);
+
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:image];
+    XCTAssertEqual(sourceImage.normalizedImage, image);
+    XCTAssertEqual(sourceImage.buffer.width, 64);
+    XCTAssertEqual(sourceImage.buffer.rowBytes, CGImageGetBytesPerRow(image.CGImage));
+}
+
+- (void)testGrayImageIsNotRedrawn {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+    UIImage *image = [self imageWithColorSpace:colorSpace bitmapInfo:(CGBitmapInfo)kCGImageAlphaNone bytesPerPixel:1];
+    CGColorSpaceRelease(colorSpace);
+    
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:image];
+    XCTAssertEqual(sourceImage.normalizedImage, image);
+    XCTAssertEqual(sourceImage.buffer.format, DBProfileBlurPixelFormatGray8);
+}
+
+- (void)testDeepImageIsRedrawnIntoOwnedPixels {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    const size_t width = 64, height = 48;
+    CGContextRef ctx = CGBitmapContextCreate(NULL, width, height, 16, width * 8, colorSpace, (CGBitmapInfo)kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder16Little);
+    CGContextSetRGBFillColor(ctx, 0.2, 0.4, 0.6, 1.0);
+    CGContextFillRect(ctx, CGRectMake(0, 0, width, height));
+    CGImageRef deepImageRef = CGBitmapContextCreateImage(ctx);
+    UIImage *image = [UIImage imageWithCGImage:deepImageRef scale:2.0 orientation:UIImageOrientationUp];
+    CGImageRelease(deepImageRef);
+    CGContextRelease(ctx);
+    CGColorSpaceRelease(colorSpace);
+    
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:image];
+    CGImageRef imageRef = sourceImage.normalizedImage.CGImage;
+    XCTAssertEqual(CGImageGetBitsPerPixel(imageRef), 32);
+    XCTAssertEqual(sourceImage.buffer.format, DBProfileBlurPixelFormat32);
+    XCTAssertTrue(CGSizeEqualToSize(sourceImage.normalizedImage.size, image.size));
+    
+    // The normalized image reads the same memory as the buffer
+    DBProfileBlurBuffer buffer = sourceImage.buffer;
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    XCTAssertEqual(memcmp(CFDataGetBytePtr(data), buffer.data, buffer.rowBytes * buffer.height), 0);
+    CFRelease(data);
+}
+
+- (void)testGeneratorsSharingSourceRenderEqualStages {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+    UIImage *image = [self imageWithColorSpace:colorSpace bitmapInfo:(CGBitmapInfo)kCGImageAlphaNone bytesPerPixel:1];
+    CGColorSpaceRelease(colorSpace);
+
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:image];
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithSourceImage:sourceImage];
+    DBProfileBlurStageGenerator *otherGenerator = [[DBProfileBlurStageGenerator alloc] initWithImage:image];
+    XCTAssertEqualObjects(generator.imageDigest, otherGenerator.imageDigest);
+
+    UIImage *stage = [generator imageForStage:1 blurRadius:4.0];
+    UIImage *otherStage = [otherGenerator imageForStage:1 blurRadius:4.0];
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(stage.CGImage));
+    CFDataRef otherData = CGDataProviderCopyData(CGImageGetDataProvider(otherStage.CGImage));
+    XCTAssertEqualObjects((__bridge NSData *)data, (__bridge NSData *)otherData);
+    CFRelease(data);
+    CFRelease(otherData);
+}
+
+@end
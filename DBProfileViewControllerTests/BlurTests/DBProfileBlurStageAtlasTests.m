@@ -0,0 +1,104 @@
+//
+//  DBProfileBlurStageAtlasTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurStageAtlas.h>
+#import <DBProfileViewController/DBProfileBlurStageGenerator.h>
+
+@interface DBProfileBlurStageAtlasTests : XCTestCase
+
+@property (nonatomic) UIImage *image;
+@property (nonatomic) NSArray<NSNumber *> *blurRadii;
+@property (nonatomic) NSArray<NSNumber *> *pyramidLevels;
+
+@end
+
+@implementation DBProfileBlurStageAtlasTests
+
+- (void)setUp {
+    [super setUp];
+
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(150, 50), YES, 2.0);
+    for (NSUInteger i = 0; i < 10; i++) {
+        [[UIColor colorWithHue:i / 10.0 saturation:1.0 brightness:1.0 alpha:1.0] setFill];
+        UIRectFill(CGRectMake(i * 15, 0, 15, 50));
+    }
+    self.image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+
+    self.blurRadii = @[@0.0, @2.0, @4.0, @8.0, @16.0];
+    self.pyramidLevels = @[@0, @0, @1, @2, @3];
+}
+
+- (NSData *)pixelsForImage:(UIImage *)image {
+    CGImageRef imageRef = image.CGImage;
+    NSMutableData *pixels = [NSMutableData data];
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    for (size_t y = 0; y < CGImageGetHeight(imageRef); y++) {
+        [pixels appendBytes:CFDataGetBytePtr(data) + y * CGImageGetBytesPerRow(imageRef) length:CGImageGetWidth(imageRef) * 4];
+    }
+    CFRelease(data);
+    return pixels;
+}
+
+- (void)testStagesWrittenIntoAtlasMatchStagesOfTheirOwn {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    generator.pyramidLevels = self.pyramidLevels;
+    NSMutableArray<NSData *> *expectedPixels = [NSMutableArray array];
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        [expectedPixels addObject:[self pixelsForImage:blurredImage]];
+    }];
+
+    DBProfileBlurStageAtlas *atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:generator.sourceImage pyramidLevels:self.pyramidLevels];
+    generator.atlas = atlas;
+    XCTAssertFalse(atlas.isComplete);
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        XCTAssertEqual(blurredImage, [atlas imageForStage:stage], @"stage %@ should be the image of the atlas", @(stage));
+        XCTAssertEqualObjects([self pixelsForImage:blurredImage], expectedPixels[stage]);
+        XCTAssertEqualWithAccuracy(blurredImage.size.width, self.image.size.width, 0.001);
+    }];
+    XCTAssertTrue(atlas.isComplete);
+
+    // The regions of every stage add up to the slab, which is made of whole pages
+    NSUInteger byteCount = 0;
+    for (NSUInteger stage = 0; stage < atlas.numberOfStages; stage++) byteCount += [atlas byteCountForStage:stage];
+    XCTAssertEqual(byteCount, atlas.byteCount);
+    XCTAssertEqual(atlas.byteCount % getpagesize(), 0);
+    XCTAssertEqual(CGImageGetBytesPerRow([atlas imageForStage:4].CGImage) % 64, 0);
+}
+
+- (void)testStageOfAnotherLayoutIsNotStored {
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:self.image];
+    DBProfileBlurStageAtlas *atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:sourceImage pyramidLevels:self.pyramidLevels];
+
+    XCTAssertNil([atlas setImage:self.image forStage:2], @"a full size image should not fit the region of a downsampled stage");
+    XCTAssertNotNil([atlas setImage:self.image forStage:1]);
+    XCTAssertNil([atlas imageForStage:2]);
+    XCTAssertEqual([atlas imageForStage:0], self.image);
+}
+
+- (void)testStagesBlurredElsewhereAreShownWithoutCopying {
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:self.image];
+    DBProfileBlurStageAtlas *emptyAtlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:sourceImage pyramidLevels:self.pyramidLevels];
+    DBProfileBlurStageAtlas *atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:sourceImage pyramidLevels:self.pyramidLevels
+                                                                               stageImages:@{@1: self.image, @2: self.image}];
+
+    // Stage 2 is downsampled, so a full size image gets a region instead
+    XCTAssertEqual([atlas imageForStage:1].CGImage, self.image.CGImage);
+    XCTAssertNil([atlas imageForStage:2]);
+    XCTAssertEqual([atlas renderStage:1 width:CGImageGetWidth(self.image.CGImage) height:CGImageGetHeight(self.image.CGImage) usingBlock:^(const DBProfileBlurBuffer *region) {
+        XCTFail(@"a stage shown as it is should never be rendered");
+    }].CGImage, self.image.CGImage);
+
+    NSUInteger imageByteCount = CGImageGetBytesPerRow(self.image.CGImage) * CGImageGetHeight(self.image.CGImage);
+    XCTAssertEqual([atlas byteCountForStage:1], imageByteCount);
+    XCTAssertEqual([atlas byteCountForStage:2], [emptyAtlas byteCountForStage:2]);
+    XCTAssertEqual(atlas.byteCount, emptyAtlas.byteCount - [emptyAtlas byteCountForStage:1] + imageByteCount);
+}
+
+@end
@@ -0,0 +1,123 @@
+//
+//  DBProfileBlurStageCacheTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurStageCache.h>
+#import <DBProfileViewController/DBProfileBlurStageAtlas.h>
+
+@interface DBProfileBlurStageCacheTests : XCTestCase
+
+@property (nonatomic) DBProfileBlurStageCache *cache;
+@property (nonatomic) UIImage *image;
+@property (nonatomic) NSUInteger imageCost;
+
+@end
+
+@implementation DBProfileBlurStageCacheTests
+
+- (void)setUp {
+    [super setUp];
+
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(16, 16), YES, 1.0);
+    self.image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    self.imageCost = CGImageGetBytesPerRow(self.image.CGImage) * CGImageGetHeight(self.image.CGImage);
+
+    self.cache = [[DBProfileBlurStageCache alloc] init];
+}
+
+- (DBProfileBlurStageCacheKey *)keyWithBlurRadius:(CGFloat)blurRadius {
+    return [[DBProfileBlurStageCacheKey alloc] initWithImageDigest:@"digest"
+                                                        blurRadius:blurRadius
+                                                        iterations:5
+                                                      pyramidLevel:0];
+}
+
+- (void)testLookupWithNewKeyFindsEarlierStage {
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+
+    XCTAssertEqualObjects([self keyWithBlurRadius:1.0], [self keyWithBlurRadius:1.0]);
+    XCTAssertEqual([self keyWithBlurRadius:1.0].hash, [self keyWithBlurRadius:1.0].hash);
+    XCTAssertEqual([self.cache imageForKey:[self keyWithBlurRadius:1.0]], self.image);
+    XCTAssertNil([self.cache imageForKey:[self keyWithBlurRadius:2.0]]);
+    XCTAssertEqual(self.cache.hitCount, 1);
+    XCTAssertEqual(self.cache.missCount, 1);
+}
+
+- (void)testCostIsAccounted {
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:2.0]];
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:2.0]];
+    XCTAssertEqual(self.cache.count, 2);
+    XCTAssertEqual(self.cache.totalCost, 2 * self.imageCost);
+
+    [self.cache removeAllImages];
+    XCTAssertEqual(self.cache.count, 0);
+    XCTAssertEqual(self.cache.totalCost, 0);
+}
+
+- (void)testLeastRecentlyUsedStageIsEvicted {
+    self.cache.totalCostLimit = 3 * self.imageCost;
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:2.0]];
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:3.0]];
+
+    // Using the first stage makes the second one the least recently used
+    XCTAssertNotNil([self.cache imageForKey:[self keyWithBlurRadius:1.0]]);
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:4.0]];
+
+    XCTAssertEqual(self.cache.totalCost, 3 * self.imageCost);
+    XCTAssertNotNil([self.cache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertNil([self.cache imageForKey:[self keyWithBlurRadius:2.0]]);
+    XCTAssertNotNil([self.cache imageForKey:[self keyWithBlurRadius:3.0]]);
+    XCTAssertNotNil([self.cache imageForKey:[self keyWithBlurRadius:4.0]]);
+
+    self.cache.totalCostLimit = self.imageCost;
+    XCTAssertEqual(self.cache.count, 1);
+    XCTAssertNotNil([self.cache imageForKey:[self keyWithBlurRadius:4.0]], @"the most recently used stage should be kept");
+}
+
+- (void)testAtlasIsStoredAndEvictedTogether {
+    DBProfileBlurSourceImage *sourceImage = [[DBProfileBlurSourceImage alloc] initWithImage:self.image];
+    DBProfileBlurStageAtlas *atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:sourceImage pyramidLevels:@[@0, @0, @0]];
+    NSArray *keys = @[[self keyWithBlurRadius:0.0], [self keyWithBlurRadius:1.0], [self keyWithBlurRadius:2.0]];
+    [self.cache setAtlas:atlas forKeys:keys];
+    XCTAssertEqual(self.cache.count, 0, @"an atlas missing stages should not be stored");
+
+    [atlas setImage:self.image forStage:1];
+    [atlas setImage:self.image forStage:2];
+    [self.cache setAtlas:atlas forKeys:keys];
+    XCTAssertEqual(self.cache.count, 2);
+    XCTAssertEqual(self.cache.totalCost, atlas.byteCount);
+    XCTAssertEqual([self.cache atlasForKeys:keys], atlas);
+    XCTAssertEqual([self.cache imageForKey:keys[2]], [atlas imageForStage:2]);
+
+    // Replacing a single stage evicts every stage of the atlas
+    [self.cache setImage:self.image forKey:keys[1]];
+    XCTAssertNil([self.cache atlasForKeys:keys]);
+    XCTAssertEqual(self.cache.count, 1);
+    XCTAssertEqual(self.cache.totalCost, self.imageCost);
+}
+
+- (void)testUnusedStagesAreRemovedAndUsedStagesKept {
+    @autoreleasepool {
+        // A stage only the cache holds
+        UIGraphicsBeginImageContextWithOptions(CGSizeMake(16, 16), YES, 1.0);
+        [self.cache setImage:UIGraphicsGetImageFromCurrentImageContext() forKey:[self keyWithBlurRadius:1.0]];
+        UIGraphicsEndImageContext();
+    }
+    [self.cache setImage:self.image forKey:[self keyWithBlurRadius:2.0]];
+
+    [self.cache removeUnusedImages];
+    XCTAssertEqual(self.cache.count, 1);
+    XCTAssertEqual(self.cache.totalCost, self.imageCost);
+    XCTAssertEqual([self.cache imageForKey:[self keyWithBlurRadius:2.0]], self.image, @"a stage still held elsewhere should be kept");
+    XCTAssertNil([self.cache imageForKey:[self keyWithBlurRadius:1.0]]);
+}
+
+@end
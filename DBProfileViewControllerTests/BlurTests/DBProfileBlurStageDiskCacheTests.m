@@ -0,0 +1,149 @@
+//
+//  DBProfileBlurStageDiskCacheTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurStageCache.h>
+#import <DBProfileViewController/DBProfileBlurStageDiskCache.h>
+
+@interface DBProfileBlurStageDiskCacheTests : XCTestCase
+
+@property (nonatomic) NSURL *directoryURL;
+@property (nonatomic) DBProfileBlurStageDiskCache *diskCache;
+@property (nonatomic) UIImage *image;
+
+@end
+
+@implementation DBProfileBlurStageDiskCacheTests
+
+- (void)setUp {
+    [super setUp];
+
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(16, 8), NO, 2.0);
+    [[UIColor colorWithRed:0.2 green:0.4 blue:0.6 alpha:0.8] setFill];
+    UIRectFill(CGRectMake(0, 0, 8, 8));
+    self.image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+
+    self.directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString] isDirectory:YES];
+    self.diskCache = [[DBProfileBlurStageDiskCache alloc] initWithDirectoryURL:self.directoryURL];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (DBProfileBlurStageCacheKey *)keyWithBlurRadius:(CGFloat)blurRadius {
+    return [[DBProfileBlurStageCacheKey alloc] initWithImageDigest:@"0123456789abcdef@2x"
+                                                        blurRadius:blurRadius
+                                                        iterations:5
+                                                      pyramidLevel:1];
+}
+
+- (NSData *)pixelsOfImage:(UIImage *)image {
+    return CFBridgingRelease(CGDataProviderCopyData(CGImageGetDataProvider(image.CGImage)));
+}
+
+- (void)testStoredStageSurvivesRelaunch {
+    [self.diskCache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+
+    // A new cache on the same directory stands in for the next launch
+    DBProfileBlurStageDiskCache *diskCache = [[DBProfileBlurStageDiskCache alloc] initWithDirectoryURL:self.directoryURL];
+    UIImage *image = [diskCache imageForKey:[self keyWithBlurRadius:1.0]];
+
+    XCTAssertNotNil(image);
+    XCTAssertEqual(image.scale, self.image.scale);
+    XCTAssertTrue(CGSizeEqualToSize(image.size, self.image.size));
+    XCTAssertEqual(CGImageGetBitmapInfo(image.CGImage), CGImageGetBitmapInfo(self.image.CGImage));
+    XCTAssertTrue(CFEqual(CGImageGetColorSpace(image.CGImage), CGImageGetColorSpace(self.image.CGImage)));
+    XCTAssertEqualObjects([self pixelsOfImage:image], [self pixelsOfImage:self.image]);
+    XCTAssertNil([diskCache imageForKey:[self keyWithBlurRadius:2.0]]);
+    XCTAssertEqual(diskCache.totalSize, self.diskCache.totalSize);
+}
+
+- (void)testStageInDisplayP3KeepsItsColorSpace {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceDisplayP3);
+    CGContextRef context = CGBitmapContextCreate(NULL, 16, 8, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGContextSetRGBFillColor(context, 0.2, 0.4, 0.6, 0.8);
+    CGContextFillRect(context, CGRectMake(0, 0, 8, 8));
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    UIImage *displayP3Image = [UIImage imageWithCGImage:imageRef scale:2.0 orientation:UIImageOrientationUp];
+    CGImageRelease(imageRef);
+    CGContextRelease(context);
+
+    [self.diskCache setImage:displayP3Image forKey:[self keyWithBlurRadius:1.0]];
+    UIImage *image = [[[DBProfileBlurStageDiskCache alloc] initWithDirectoryURL:self.directoryURL] imageForKey:[self keyWithBlurRadius:1.0]];
+
+    XCTAssertNotNil(image);
+    XCTAssertTrue(CFEqual(CGImageGetColorSpace(image.CGImage), colorSpace));
+    XCTAssertEqualObjects([self pixelsOfImage:image], [self pixelsOfImage:displayP3Image]);
+    CGColorSpaceRelease(colorSpace);
+}
+
+- (void)testStageInUnknownColorSpaceIsNotStored {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceAdobeRGB1998);
+    CGContextRef context = CGBitmapContextCreate(NULL, 16, 8, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    UIImage *adobeRGBImage = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    CGContextRelease(context);
+    CGColorSpaceRelease(colorSpace);
+
+    [self.diskCache setImage:adobeRGBImage forKey:[self keyWithBlurRadius:1.0]];
+
+    XCTAssertNil([self.diskCache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertEqual(self.diskCache.totalSize, 0);
+}
+
+- (void)testFileFromAnotherVersionIsRemoved {
+    [self.diskCache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+    NSURL *fileURL = [self.diskCache fileURLForKey:[self keyWithBlurRadius:1.0]];
+
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:fileURL error:nil];
+    uint32_t version = 0;
+    [fileHandle seekToFileOffset:sizeof(uint32_t)];
+    [fileHandle writeData:[NSData dataWithBytes:&version length:sizeof(version)]];
+    [fileHandle closeFile];
+
+    XCTAssertNil([self.diskCache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:fileURL.path]);
+    XCTAssertEqual(self.diskCache.totalSize, 0);
+}
+
+- (void)testOldestFilesAreRemovedToFitSizeLimit {
+    [self.diskCache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+    NSUInteger fileSize = self.diskCache.totalSize;
+    XCTAssertGreaterThan(fileSize, 0);
+
+    self.diskCache.totalSizeLimit = 2 * fileSize;
+    [self.diskCache setImage:self.image forKey:[self keyWithBlurRadius:2.0]];
+
+    // Modification dates have a resolution of a second on some file systems
+    NSURL *oldestFileURL = [self.diskCache fileURLForKey:[self keyWithBlurRadius:1.0]];
+    [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: [NSDate distantPast]} ofItemAtPath:oldestFileURL.path error:nil];
+    [self.diskCache setImage:self.image forKey:[self keyWithBlurRadius:3.0]];
+
+    XCTAssertEqual(self.diskCache.totalSize, 2 * fileSize);
+    XCTAssertNil([self.diskCache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertNotNil([self.diskCache imageForKey:[self keyWithBlurRadius:2.0]]);
+    XCTAssertNotNil([self.diskCache imageForKey:[self keyWithBlurRadius:3.0]]);
+}
+
+- (void)testStageCacheFallsBackToDisk {
+    DBProfileBlurStageCache *cache = [[DBProfileBlurStageCache alloc] init];
+    cache.diskCache = self.diskCache;
+    [cache setImage:self.image forKey:[self keyWithBlurRadius:1.0]];
+    [cache removeAllImages];
+
+    XCTAssertNotNil([cache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertNotNil([cache imageForKey:[self keyWithBlurRadius:1.0]]);
+    XCTAssertEqual(cache.diskHitCount, 1, @"a stage read from disk should be kept in memory");
+    XCTAssertEqual(cache.hitCount, 2);
+}
+
+@end
@@ -0,0 +1,377 @@
+//
+//  DBProfileBlurStageGeneratorTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurKernel.h>
+#import <DBProfileViewController/DBProfileBlurStageGenerator.h>
+#import <DBProfileViewController/DBProfileBlurBufferPool.h>
+
+static const size_t DBProfileBlurStageGeneratorTestsWidth = 160;
+static const size_t DBProfileBlurStageGeneratorTestsHeight = 96;
+static const NSUInteger DBProfileBlurStageGeneratorTestsNumberOfStages = 20;
+static const CGFloat DBProfileBlurStageGeneratorTestsMaxBlurRadius = 20.0;
+
+@interface DBProfileBlurStageGeneratorTests : XCTestCase
+
+@property (nonatomic) NSData *pixels;
+@property (nonatomic) UIImage *image;
+@property (nonatomic) NSArray<NSNumber *> *blurRadii;
+
+@end
+
+@implementation DBProfileBlurStageGeneratorTests
+
+- (void)setUp {
+    [super setUp];
+    
+    // An opaque image with gradients, hard edges and noise
+    const size_t width = DBProfileBlurStageGeneratorTestsWidth, height = DBProfileBlurStageGeneratorTestsHeight;
+    NSMutableData *pixels = [NSMutableData dataWithLength:width * height * 4];
+    uint8_t *bytes = pixels.mutableBytes;
+    srand48(7);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            uint8_t *pixel = bytes + (y * width + x) * 4;
+            pixel[0] = 255;
+            pixel[1] = (uint8_t)(x * 255 / width);
+            pixel[2] = (uint8_t)(((x / 16 + y / 16) % 2) * 200 + (lrand48() % 40));
+            pixel[3] = (uint8_t)(128 + 100 * sin(x * 0.1) * cos(y * 0.15));
+        }
+    }
+    self.pixels = pixels;
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef ctx = CGBitmapContextCreate(bytes, width, height, 8, width * 4, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Big);
+    CGImageRef imageRef = CGBitmapContextCreateImage(ctx);
+    self.image = [UIImage imageWithCGImage:imageRef scale:2.0 orientation:UIImageOrientationUp];
+    CGImageRelease(imageRef);
+    CGContextRelease(ctx);
+    CGColorSpaceRelease(colorSpace);
+    
+    NSMutableArray *blurRadii = [NSMutableArray array];
+    for (NSUInteger stage = 0; stage <= DBProfileBlurStageGeneratorTestsNumberOfStages; stage++) {
+        [blurRadii addObject:@(stage * (DBProfileBlurStageGeneratorTestsMaxBlurRadius / DBProfileBlurStageGeneratorTestsNumberOfStages))];
+    }
+    self.blurRadii = blurRadii;
+}
+
+- (NSData *)pixelsForImage:(UIImage *)image {
+    CGImageRef imageRef = image.CGImage;
+    NSMutableData *pixels = [NSMutableData data];
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    for (size_t y = 0; y < CGImageGetHeight(imageRef); y++) {
+        [pixels appendBytes:CFDataGetBytePtr(data) + y * CGImageGetBytesPerRow(imageRef) length:CGImageGetWidth(imageRef) * 4];
+    }
+    CFRelease(data);
+    return pixels;
+}
+
+- (NSData *)independentlyBlurredPixelsWithBlurRadius:(CGFloat)blurRadius iterations:(NSUInteger)iterations {
+    const size_t width = DBProfileBlurStageGeneratorTestsWidth, height = DBProfileBlurStageGeneratorTestsHeight;
+    uint32_t boxSize = (uint32_t)(blurRadius * self.image.scale);
+    if (boxSize <= 1) return self.pixels;
+    
+    NSMutableData *pixels = [self.pixels mutableCopy];
+    NSMutableData *scratch = [NSMutableData dataWithLength:pixels.length];
+    NSMutableData *temp = [NSMutableData dataWithLength:DBProfileBlurTempBufferSize(width, boxSize)];
+    DBProfileBlurBuffer buffer = { pixels.mutableBytes, width, height, width * 4 };
+    DBProfileBlurBuffer scratchBuffer = { scratch.mutableBytes, width, height, width * 4 };
+    const DBProfileBlurBuffer *result = DBProfileBlurBoxIterations(&buffer, &scratchBuffer, temp.mutableBytes, boxSize, iterations);
+    return [NSData dataWithBytes:result->data length:pixels.length];
+}
+
+- (void)testGeneratesEveryStageInOrder {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    
+    NSMutableArray *stages = [NSMutableArray array];
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        [stages addObject:@(stage)];
+        XCTAssertEqual(blurredImage.scale, self.image.scale);
+        XCTAssertTrue(CGSizeEqualToSize(blurredImage.size, self.image.size));
+    }];
+    
+    XCTAssertEqual(stages.count, self.blurRadii.count);
+    XCTAssertEqualObjects(stages.lastObject, @(DBProfileBlurStageGeneratorTestsNumberOfStages));
+}
+
+- (void)testWorkIsAFifthOfIndependentBlurs {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    generator.iterations = 5;
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {}];
+    
+    // Independently blurring every stage past stage 0 takes `iterations` convolutions each
+    NSUInteger independentConvolutions = DBProfileBlurStageGeneratorTestsNumberOfStages * generator.iterations;
+    XCTAssertLessThanOrEqual(generator.numberOfConvolutions * 5, independentConvolutions);
+}
+
+- (void)testStagesMatchIndependentBlurs {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        NSData *expected = [self independentlyBlurredPixelsWithBlurRadius:[self.blurRadii[stage] doubleValue] iterations:generator.iterations];
+        NSData *actual = [self pixelsForImage:blurredImage];
+        XCTAssertEqual(actual.length, expected.length);
+        
+        const uint8_t *expectedBytes = expected.bytes, *actualBytes = actual.bytes;
+        double totalError = 0;
+        for (NSUInteger i = 0; i < expected.length; i++) {
+            totalError += abs((int)expectedBytes[i] - (int)actualBytes[i]);
+        }
+        
+        // The first stages replace a smooth kernel with a single box, later stages converge on a Gaussian
+        XCTAssertLessThan(totalError / expected.length, stage <= 1 ? 3.0 : 1.0, @"stage %@ should look like the independently blurred stage", @(stage));
+    }];
+}
+
+- (void)testStopEndsGeneration {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    
+    __block NSUInteger count = 0;
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        count++;
+        *stop = (stage == 3);
+    }];
+    
+    XCTAssertEqual(count, 4);
+}
+
+- (void)testSkippedStagesAreNotGenerated {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    NSMutableIndexSet *skippedStages = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(3, 3)];
+    [skippedStages addIndex:DBProfileBlurStageGeneratorTestsNumberOfStages];
+    
+    NSMutableIndexSet *stages = [NSMutableIndexSet indexSet];
+    [generator generateStagesWithBlurRadii:self.blurRadii skippingStages:skippedStages usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        [stages addIndex:stage];
+    }];
+    
+    XCTAssertFalse([stages containsIndexes:skippedStages]);
+    XCTAssertEqual(stages.count, self.blurRadii.count - skippedStages.count);
+    XCTAssertLessThan(generator.numberOfConvolutions, DBProfileBlurStageGeneratorTestsNumberOfStages, @"nothing after the last generated stage should be blurred");
+}
+
+- (void)testSingleStageMatchesIndependentBlur {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    NSUInteger stage = DBProfileBlurStageGeneratorTestsNumberOfStages / 2;
+    CGFloat blurRadius = [self.blurRadii[stage] doubleValue];
+    
+    UIImage *blurredImage = [generator imageForStage:stage blurRadius:blurRadius];
+    NSData *expected = [self independentlyBlurredPixelsWithBlurRadius:blurRadius iterations:generator.iterations];
+    NSData *actual = [self pixelsForImage:blurredImage];
+    
+    const uint8_t *expectedBytes = expected.bytes, *actualBytes = actual.bytes;
+    double totalError = 0;
+    for (NSUInteger i = 0; i < expected.length; i++) {
+        totalError += abs((int)expectedBytes[i] - (int)actualBytes[i]);
+    }
+    
+    XCTAssertLessThan(totalError / expected.length, 1.0);
+    XCTAssertEqual(generator.numberOfConvolutions, 3);
+}
+
+- (void)testSummedAreaTableStagesMatchIndependentBlurs {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    generator.renderer = DBProfileBlurStageRendererSummedAreaTable;
+    
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        NSData *expected = [self independentlyBlurredPixelsWithBlurRadius:[self.blurRadii[stage] doubleValue] iterations:generator.iterations];
+        NSData *actual = [self pixelsForImage:blurredImage];
+        
+        const uint8_t *expectedBytes = expected.bytes, *actualBytes = actual.bytes;
+        double totalError = 0;
+        for (NSUInteger i = 0; i < expected.length; i++) {
+            totalError += abs((int)expectedBytes[i] - (int)actualBytes[i]);
+        }
+        
+        // Boxes are clipped at the edges rather than extended, which accounts for most of the difference on a small image
+        XCTAssertLessThan(totalError / expected.length, 4.0, @"stage %@ should look like the independently blurred stage", @(stage));
+    }];
+    
+    XCTAssertEqual(generator.numberOfConvolutions, 0);
+}
+
+- (void)testPyramidStagesKeepTheirSizeInPoints {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:self.image];
+    generator.maximumPyramidLevel = DBProfileBlurPyramidMaximumLevel;
+    
+    __block size_t lastWidth = CGImageGetWidth(self.image.CGImage);
+    [generator generateStagesWithBlurRadii:self.blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        size_t width = CGImageGetWidth(blurredImage.CGImage);
+        XCTAssertLessThanOrEqual(width, lastWidth, @"stages should never get sharper");
+        XCTAssertEqualWithAccuracy(blurredImage.size.width, self.image.size.width, 0.001);
+        lastWidth = width;
+    }];
+    
+    XCTAssertEqual(lastWidth, CGImageGetWidth(self.image.CGImage) >> DBProfileBlurPyramidMaximumLevel);
+}
+
+- (NSArray<NSData *> *)stagePixelsOfCoverWithRenderer:(DBProfileBlurStageRenderer)renderer numberOfWorkers:(NSUInteger)numberOfWorkers {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+    generator.renderer = renderer;
+    generator.numberOfWorkers = numberOfWorkers;
+    
+    NSMutableArray *stagePixels = [NSMutableArray array];
+    [generator generateStagesWithBlurRadii:[self blurRadiiWithMaxBlurRadius:40.0] usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        [stagePixels addObject:[self pixelsForImage:blurredImage]];
+    }];
+    [stagePixels addObject:[self pixelsForImage:[generator imageForStage:DBProfileBlurStageGeneratorTestsNumberOfStages / 2 blurRadius:20.0]]];
+    return stagePixels;
+}
+
+- (void)testParallelStagesMatchSerialStagesExactly {
+    for (DBProfileBlurStageRenderer renderer = DBProfileBlurStageRendererProgressive; renderer <= DBProfileBlurStageRendererSummedAreaTable; renderer++) {
+        NSArray<NSData *> *serialPixels = [self stagePixelsOfCoverWithRenderer:renderer numberOfWorkers:1];
+        NSArray<NSData *> *parallelPixels = [self stagePixelsOfCoverWithRenderer:renderer numberOfWorkers:4];
+        XCTAssertEqualObjects(parallelPixels, serialPixels, @"renderer %@ should not depend on the number of workers", @(renderer));
+    }
+}
+
+- (void)testVisibleRowsMatchWholeStages {
+    // The band a collapsed header leaves on screen
+    const CGRect visibleRect = CGRectMake(0.0, 0.75, 1.0, 0.25);
+    NSArray *blurRadii = [self blurRadiiWithMaxBlurRadius:20.0];
+    
+    for (DBProfileBlurStageRenderer renderer = DBProfileBlurStageRendererProgressive; renderer <= DBProfileBlurStageRendererSummedAreaTable; renderer++) {
+        DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+        generator.renderer = renderer;
+        NSMutableArray<NSData *> *expectedPixels = [NSMutableArray array];
+        [generator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+            [expectedPixels addObject:[self pixelsForImage:blurredImage]];
+        }];
+        
+        generator.visibleRect = visibleRect;
+        [generator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+            NSData *actual = [self pixelsForImage:blurredImage];
+            size_t rowLength = CGImageGetWidth(blurredImage.CGImage) * 4, height = CGImageGetHeight(blurredImage.CGImage);
+            const uint8_t *expectedBytes = expectedPixels[stage].bytes, *actualBytes = actual.bytes;
+            
+            // The summed-area table holds the whole image, the other renderers clamp the rows beyond the halo
+            int maximumDifference = 0;
+            for (size_t i = (size_t)(CGRectGetMinY(visibleRect) * height) * rowLength; i < height * rowLength; i++) {
+                maximumDifference = MAX(maximumDifference, abs((int)expectedBytes[i] - (int)actualBytes[i]));
+            }
+            XCTAssertLessThanOrEqual(maximumDifference, renderer == DBProfileBlurStageRendererSummedAreaTable ? 0 : 2, @"visible rows of stage %@ should match", @(stage));
+        }];
+    }
+}
+
+- (void)testRowsOutsideTheVisibleRowsRepeatTheNearestBlurredRow {
+    const CGRect visibleRect = CGRectMake(0.0, 0.75, 1.0, 0.25);
+    NSArray *blurRadii = [self blurRadiiWithMaxBlurRadius:20.0];
+    
+    for (DBProfileBlurStageRenderer renderer = DBProfileBlurStageRendererProgressive; renderer <= DBProfileBlurStageRendererSummedAreaTable; renderer++) {
+        DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+        generator.renderer = renderer;
+        generator.visibleRect = visibleRect;
+        
+        // The top rows of a blurred stage are far above the halo, so they must all be copies of the first blurred row rather than the
+        // unblurred image or the previous contents of a pooled buffer
+        [generator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+            if ([blurRadii[stage] doubleValue] * generator.image.scale <= 1.0) return;
+            NSData *pixels = [self pixelsForImage:blurredImage];
+            size_t rowLength = CGImageGetWidth(blurredImage.CGImage) * 4;
+            XCTAssertEqual(memcmp(pixels.bytes, (const uint8_t *)pixels.bytes + rowLength, rowLength), 0, @"rows of stage %@ above the visible rows should match", @(stage));
+        }];
+        
+        UIImage *blurredImage = [generator imageForStage:DBProfileBlurStageGeneratorTestsNumberOfStages blurRadius:20.0];
+        NSData *pixels = [self pixelsForImage:blurredImage];
+        size_t rowLength = CGImageGetWidth(blurredImage.CGImage) * 4;
+        XCTAssertEqual(memcmp(pixels.bytes, (const uint8_t *)pixels.bytes + rowLength, rowLength), 0);
+    }
+}
+
+- (void)testPreviewsCoverEveryStageAtAnEighthOfTheResolution {
+    UIImage *image = [self coverImage];
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:image];
+    NSArray<UIImage *> *previewImages = [generator previewImagesWithBlurRadii:self.blurRadii];
+    
+    XCTAssertEqual(previewImages.count, self.blurRadii.count);
+    XCTAssertEqual(previewImages.firstObject, image, @"stage 0 should be the image itself");
+    for (UIImage *previewImage in [previewImages subarrayWithRange:NSMakeRange(1, previewImages.count - 1)]) {
+        XCTAssertEqual(CGImageGetWidth(previewImage.CGImage), CGImageGetWidth(image.CGImage) / 8);
+        XCTAssertEqualWithAccuracy(previewImage.size.width, image.size.width, 0.001);
+    }
+    XCTAssertEqual(generator.numberOfConvolutions, 0, @"previews should not render any stage");
+}
+
+- (void)testStreamedStagesMatchStagesBlurredInFullSizeBuffers {
+    UIImage *image = [self coverImage];
+    NSArray<NSNumber *> *pyramidLevels = @[@0, @0, @1, @3];
+    NSArray<NSNumber *> *blurRadii = @[@0.0, @4.0, @8.0, @30.0];
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:image];
+    generator.pyramidLevels = pyramidLevels;
+    NSMutableArray<NSData *> *expectedPixels = [NSMutableArray array];
+    for (NSUInteger stage = 0; stage < blurRadii.count; stage++) {
+        [expectedPixels addObject:[self pixelsForImage:[generator imageForStage:stage blurRadius:[blurRadii[stage] doubleValue]]]];
+    }
+    
+    // A budget far below the size of the image, so every stage is streamed in strips as short as their halo
+    DBProfileBlurBufferPool *pool = [DBProfileBlurBufferPool sharedPool];
+    NSUInteger workingBytesLimit = pool.workingBytesLimit;
+    pool.workingBytesLimit = 64 * 1024;
+    DBProfileBlurStageGenerator *streamingGenerator = [[DBProfileBlurStageGenerator alloc] initWithImage:image];
+    streamingGenerator.pyramidLevels = pyramidLevels;
+    for (NSUInteger stage = 0; stage < blurRadii.count; stage++) {
+        UIImage *blurredImage = [streamingGenerator imageForStage:stage blurRadius:[blurRadii[stage] doubleValue]];
+        XCTAssertEqualObjects([self pixelsForImage:blurredImage], expectedPixels[stage], @"streamed stage %@ should match", @(stage));
+    }
+    [streamingGenerator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {
+        XCTAssertEqualObjects([self pixelsForImage:blurredImage], expectedPixels[stage], @"streamed stage %@ should match", @(stage));
+        XCTAssertEqualWithAccuracy(blurredImage.size.width, image.size.width, 0.001);
+    }];
+    pool.workingBytesLimit = workingBytesLimit;
+}
+
+#pragma mark - Performance
+
+- (UIImage *)coverImage {
+    // The size of a full width cover photo on a 5.5 inch display
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(414, 160), YES, 3.0);
+    [self.image drawInRect:CGRectMake(0, 0, 414, 160)];
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    return image;
+}
+
+- (NSArray<NSNumber *> *)blurRadiiWithMaxBlurRadius:(CGFloat)maxBlurRadius {
+    NSMutableArray *blurRadii = [NSMutableArray array];
+    for (NSUInteger stage = 0; stage <= DBProfileBlurStageGeneratorTestsNumberOfStages; stage++) {
+        [blurRadii addObject:@(stage * (maxBlurRadius / DBProfileBlurStageGeneratorTestsNumberOfStages))];
+    }
+    return blurRadii;
+}
+
+- (void)testProgressiveRendererPerformance {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+    NSArray *blurRadii = [self blurRadiiWithMaxBlurRadius:80.0];
+    
+    [self measureBlock:^{
+        [generator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {}];
+    }];
+}
+
+- (void)testPreviewPerformance {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+    NSArray *blurRadii = [self blurRadiiWithMaxBlurRadius:80.0];
+    
+    [self measureBlock:^{
+        [generator previewImagesWithBlurRadii:blurRadii];
+    }];
+}
+
+- (void)testSummedAreaTableRendererPerformance {
+    DBProfileBlurStageGenerator *generator = [[DBProfileBlurStageGenerator alloc] initWithImage:[self coverImage]];
+    generator.renderer = DBProfileBlurStageRendererSummedAreaTable;
+    NSArray *blurRadii = [self blurRadiiWithMaxBlurRadius:80.0];
+    
+    [self measureBlock:^{
+        [generator generateStagesWithBlurRadii:blurRadii usingBlock:^(NSUInteger stage, UIImage *blurredImage, BOOL *stop) {}];
+    }];
+}
+
+@end
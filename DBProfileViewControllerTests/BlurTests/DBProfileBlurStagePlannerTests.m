@@ -0,0 +1,125 @@
+//
+//  DBProfileBlurStagePlannerTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBlurStagePlanner.h>
+#import <DBProfileViewController/DBProfileBlurStageAtlas.h>
+
+@interface DBProfileBlurStagePlannerTests : XCTestCase
+
+@property (nonatomic) DBProfileBlurStagePlanner *planner;
+
+@end
+
+@implementation DBProfileBlurStagePlannerTests
+
+- (void)setUp {
+    [super setUp];
+    
+    // A 1242x480 cover photo
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(414, 160), YES, 3.0);
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    self.planner = [[DBProfileBlurStagePlanner alloc] initWithImage:image];
+}
+
+- (void)testPlanWithoutBudgetKeepsEveryStageAtFullResolution {
+    DBProfileBlurStagePlan *plan = [self.planner plan];
+    
+    XCTAssertEqual(plan.numberOfStages, 20);
+    XCTAssertEqual(plan.blurRadii.count, 21);
+    XCTAssertEqualObjects(plan.blurRadii.lastObject, @20.0);
+    for (NSNumber *level in plan.pyramidLevels) {
+        XCTAssertEqualObjects(level, @0);
+    }
+    XCTAssertEqual(plan.numberOfBytes, 20 * [self.planner numberOfBytesForPyramidLevel:0]);
+}
+
+- (void)testPerceptualPlanStepsLessVisiblyWithFewerStages {
+    DBProfileBlurStagePlan *linearPlan = [self.planner plan];
+    
+    self.planner.numberOfStages = 8;
+    self.planner.stageSpacing = DBProfileBlurStageSpacingPerceptual;
+    DBProfileBlurStagePlan *perceptualPlan = [self.planner plan];
+    
+    XCTAssertEqual(perceptualPlan.numberOfStages, 8);
+    XCTAssertEqualObjects(perceptualPlan.blurRadii.lastObject, @20.0);
+    XCTAssertLessThanOrEqual(perceptualPlan.largestVisibleStep, linearPlan.largestVisibleStep);
+    XCTAssertLessThan([perceptualPlan.blurRadii[1] doubleValue], [perceptualPlan.blurRadii[8] doubleValue] - [perceptualPlan.blurRadii[7] doubleValue], @"stages should be closer together at small radii");
+}
+
+- (void)testStageForPercentScrolledFollowsBlurRadius {
+    DBProfileBlurStagePlan *linearPlan = [self.planner plan];
+    XCTAssertEqualWithAccuracy([linearPlan stageForPercentScrolled:0.33], 0.33 * 20, 0.0001);
+    XCTAssertEqualWithAccuracy([linearPlan stageForPercentScrolled:1.5], 1.5 * 20, 0.0001);
+    
+    self.planner.numberOfStages = 8;
+    self.planner.stageSpacing = DBProfileBlurStageSpacingPerceptual;
+    DBProfileBlurStagePlan *plan = [self.planner plan];
+    
+    // Showing stage n means the blur has reached the radius of stage n
+    for (NSUInteger stage = 0; stage <= plan.numberOfStages; stage++) {
+        CGFloat percentScrolled = [plan.blurRadii[stage] doubleValue] / [plan.blurRadii.lastObject doubleValue];
+        XCTAssertEqualWithAccuracy([plan stageForPercentScrolled:percentScrolled], stage, 0.0001);
+    }
+}
+
+- (void)testPlanFitsBudget {
+    NSUInteger fullResolutionBytes = [self.planner numberOfBytesForPyramidLevel:0];
+    
+    for (NSUInteger budget = fullResolutionBytes * 16; budget >= fullResolutionBytes * 2; budget /= 2) {
+        self.planner.memoryBudget = budget;
+        DBProfileBlurStagePlan *plan = [self.planner plan];
+        
+        XCTAssertLessThanOrEqual(plan.numberOfBytes, budget);
+        XCTAssertGreaterThanOrEqual(plan.numberOfStages, 1);
+        XCTAssertEqualObjects(plan.pyramidLevels.firstObject, @0, @"stage 0 should never be downsampled");
+        
+        NSUInteger previousLevel = 0;
+        for (NSNumber *level in plan.pyramidLevels) {
+            XCTAssertGreaterThanOrEqual(level.unsignedIntegerValue, previousLevel, @"pyramid levels should be in ascending order");
+            previousLevel = level.unsignedIntegerValue;
+        }
+    }
+}
+
+- (void)testPlanPrefersDownsamplingOverFewerStages {
+    // Less than half of the full resolution stages
+    self.planner.memoryBudget = 10 * [self.planner numberOfBytesForPyramidLevel:0];
+    DBProfileBlurStagePlan *plan = [self.planner plan];
+    
+    XCTAssertEqual(plan.numberOfStages, 20);
+    XCTAssertLessThanOrEqual(plan.numberOfBytes, self.planner.memoryBudget);
+}
+
+- (void)testPlanNeedsAsManyBytesAsItsAtlas {
+    // An odd width leaves rows that are not a multiple of the row alignment at every level
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(333, 125), YES, 1.0);
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    DBProfileBlurStagePlanner *planner = [[DBProfileBlurStagePlanner alloc] initWithImage:image];
+    planner.memoryBudget = 6 * [planner numberOfBytesForPyramidLevel:0];
+    DBProfileBlurStagePlan *plan = [planner plan];
+    XCTAssertGreaterThan([plan.pyramidLevels.lastObject unsignedIntegerValue], 0);
+    
+    DBProfileBlurStageAtlas *atlas = [[DBProfileBlurStageAtlas alloc] initWithSourceImage:[[DBProfileBlurSourceImage alloc] initWithImage:image] pyramidLevels:plan.pyramidLevels];
+    XCTAssertEqual(plan.numberOfBytes, atlas.byteCount);
+    XCTAssertLessThanOrEqual(atlas.byteCount, planner.memoryBudget);
+}
+
+- (void)testPlanExceedsBudgetThatCannotBeMet {
+    self.planner.memoryBudget = 1;
+    DBProfileBlurStagePlan *plan = [self.planner plan];
+    
+    XCTAssertEqual(plan.numberOfStages, 1);
+    XCTAssertGreaterThan(plan.numberOfBytes, self.planner.memoryBudget);
+}
+
+@end
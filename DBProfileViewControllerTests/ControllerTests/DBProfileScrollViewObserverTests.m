@@ -0,0 +1,58 @@
+//
+//  DBProfileScrollViewObserverTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileObserver.h>
+
+@interface DBProfileScrollViewObserverTests : XCTestCase <DBProfileScrollViewObserverDelegate>
+
+@property (nonatomic) UIScrollView *scrollView;
+@property (nonatomic) NSMutableArray<NSValue *> *deliveredContentOffsets;
+
+@end
+
+@implementation DBProfileScrollViewObserverTests
+
+- (void)setUp {
+    [super setUp];
+    self.scrollView = [[UIScrollView alloc] initWithFrame:CGRectMake(0, 0, 320, 480)];
+    self.scrollView.contentSize = CGSizeMake(320, 2000);
+    self.deliveredContentOffsets = [NSMutableArray array];
+}
+
+- (void)observedScrollViewDidScroll:(UIScrollView *)scrollView {
+    [self.deliveredContentOffsets addObject:[NSValue valueWithCGPoint:scrollView.contentOffset]];
+}
+
+- (void)testOffsetSetInCodeIsDeliveredImmediately {
+    DBProfileScrollViewObserver *observer = [[DBProfileScrollViewObserver alloc] initWithTargetView:self.scrollView delegate:self];
+
+    self.scrollView.contentOffset = CGPointMake(0, 40);
+    XCTAssertEqual(self.deliveredContentOffsets.count, 1);
+    XCTAssertEqual([self.deliveredContentOffsets.lastObject CGPointValue].y, 40);
+
+    // Nothing is left to deliver at the end of the frame
+    [observer flush];
+    XCTAssertEqual(self.deliveredContentOffsets.count, 1);
+}
+
+- (void)testPausedObserverKeepsObservingWithoutDelivering {
+    DBProfileScrollViewObserver *observer = [[DBProfileScrollViewObserver alloc] initWithTargetView:self.scrollView delegate:self];
+
+    observer.paused = YES;
+    self.scrollView.contentOffset = CGPointMake(0, 40);
+    [observer flush];
+    XCTAssertEqual(self.deliveredContentOffsets.count, 0);
+
+    observer.paused = NO;
+    self.scrollView.contentOffset = CGPointMake(0, 80);
+    XCTAssertEqual(self.deliveredContentOffsets.count, 1);
+    XCTAssertEqual(observer.scrollView, self.scrollView);
+}
+
+@end
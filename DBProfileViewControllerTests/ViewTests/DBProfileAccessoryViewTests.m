@@ -9,6 +9,19 @@
 #import <XCTest/XCTest.h>
 #import <DBProfileViewController/DBProfileViewController.h>
 
+@interface DBProfileTestAccessoryView : DBProfileAccessoryView
+@property (nonatomic) NSUInteger numberOfTransformWrites;
+@end
+
+@implementation DBProfileTestAccessoryView
+
+- (void)setTransform:(CGAffineTransform)transform {
+    self.numberOfTransformWrites++;
+    [super setTransform:transform];
+}
+
+@end
+
 @interface DBProfileAccessoryViewTests : XCTestCase
 
 @end
@@ -44,4 +57,20 @@
     XCTAssertTrue(accessoryView.hidden, @"accessoryView.hidden should be true");
 }
 
+- (void)testApplyingUnchangedLayoutAttributesDoesNotWriteToView {
+    
+    DBProfileTestAccessoryView *accessoryView = [[DBProfileTestAccessoryView alloc] init];
+    
+    DBProfileAccessoryViewLayoutAttributes *layoutAttributes = [DBProfileAccessoryViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:@"Test"];
+    
+    layoutAttributes.transform = CGAffineTransformMakeScale(0.5, 0.5);
+    
+    accessoryView.numberOfTransformWrites = 0;
+    [accessoryView applyLayoutAttributes:layoutAttributes];
+    [accessoryView applyLayoutAttributes:layoutAttributes];
+    
+    XCTAssertEqual(accessoryView.numberOfTransformWrites, 1, @"an unchanged transform should not be written again");
+    XCTAssertTrue(CGAffineTransformEqualToTransform(accessoryView.transform, layoutAttributes.transform), @"accessoryView.transform should be applied");
+}
+
 @end
@@ -0,0 +1,98 @@
+//
+//  DBProfileBackdropBlurViewTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileBackdropBlurView.h>
+#import <DBProfileViewController/DBProfileBackdropBlurView_Private.h>
+#import <DBProfileViewController/UIImage+DBProfileViewController.h>
+
+@interface DBProfileBackdropBlurViewTests : XCTestCase
+
+@property (nonatomic) DBProfileBackdropBlurView *blurView;
+
+@end
+
+@implementation DBProfileBackdropBlurViewTests
+
+- (void)setUp {
+    [super setUp];
+
+    self.blurView = [[DBProfileBackdropBlurView alloc] initWithFrame:CGRectMake(0, 0, 64, 96)];
+    self.blurView.blurAlgorithm = DBProfileBlurAlgorithmBox;
+    self.blurView.iterations = 3;
+    self.blurView.tintColor = [UIColor colorWithRed:0.2 green:0.4 blue:0.8 alpha:1.0];
+}
+
+// Draws a snapshot the way the view does, with the digests of its rows taken from the context when `recordsRowDigests` is YES
+- (UIImage *)snapshotWithBandInRows:(NSRange)rows recordsRowDigests:(BOOL)recordsRowDigests {
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(64, 96), NO, 1.0);
+    CGContextRef context = UIGraphicsGetCurrentContext();
+    for (NSUInteger column = 0; column < 8; column++) {
+        [[UIColor colorWithHue:column / 8.0 saturation:0.8 brightness:0.9 alpha:1.0] setFill];
+        UIRectFill(CGRectMake(column * 8, 0, 8, 96));
+    }
+    if (rows.length > 0) {
+        [[UIColor colorWithWhite:0.1 alpha:0.7] setFill];
+        UIRectFill(CGRectMake(4, rows.location, 40, rows.length));
+    }
+    NSData *rowDigests = recordsRowDigests ? [UIImage db_rowDigestsOfBitmapContext:context] : nil;
+    UIImage *snapshot = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    snapshot.db_rowDigests = rowDigests;
+    return snapshot;
+}
+
+- (NSUInteger)maximumDifferenceBetweenImage:(UIImage *)image andImage:(UIImage *)otherImage {
+    CGImageRef imageRef = image.CGImage, otherImageRef = otherImage.CGImage;
+    XCTAssertEqual(CGImageGetWidth(imageRef), CGImageGetWidth(otherImageRef));
+    XCTAssertEqual(CGImageGetHeight(imageRef), CGImageGetHeight(otherImageRef));
+
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    CFDataRef otherData = CGDataProviderCopyData(CGImageGetDataProvider(otherImageRef));
+    NSUInteger maximumDifference = 0;
+    for (size_t y = 0; y < CGImageGetHeight(imageRef); y++) {
+        const uint8_t *row = CFDataGetBytePtr(data) + y * CGImageGetBytesPerRow(imageRef);
+        const uint8_t *otherRow = CFDataGetBytePtr(otherData) + y * CGImageGetBytesPerRow(otherImageRef);
+        for (size_t x = 0; x < CGImageGetWidth(imageRef) * 4; x++) {
+            maximumDifference = MAX(maximumDifference, (NSUInteger)abs((int)row[x] - (int)otherRow[x]));
+        }
+    }
+    CFRelease(data);
+    CFRelease(otherData);
+    return maximumDifference;
+}
+
+- (void)assertBandedBlurOfBandInRows:(NSRange)rows recordsRowDigests:(BOOL)recordsRowDigests {
+    CGFloat blurRadius = 6.0;
+    UIImage *previousBlurredImage = [self.blurView blurredSnapshot:[self snapshotWithBandInRows:NSMakeRange(0, 0) recordsRowDigests:recordsRowDigests] radius:blurRadius];
+
+    UIImage *snapshot = [self snapshotWithBandInRows:rows recordsRowDigests:recordsRowDigests];
+    UIImage *blurredImage = [self.blurView blurredSnapshot:snapshot radius:blurRadius];
+    UIImage *expectedImage = [snapshot db_blurredImageWithRadius:blurRadius iterations:self.blurView.iterations algorithm:self.blurView.blurAlgorithm tintColor:self.blurView.tintColor];
+
+    // The band and its halo of `iterations * (boxSize / 2)` rows are blurred and tinted again, every other row is kept from the last result
+    XCTAssertNotEqual(blurredImage, previousBlurredImage);
+    XCTAssertLessThanOrEqual([self maximumDifferenceBetweenImage:blurredImage andImage:expectedImage], 1);
+
+    // The same pixels again reuse the last tinted result as it is
+    XCTAssertEqual([self.blurView blurredSnapshot:[self snapshotWithBandInRows:rows recordsRowDigests:recordsRowDigests] radius:blurRadius], blurredImage);
+}
+
+- (void)testChangedBandNearTopMatchesFullBlur {
+    [self assertBandedBlurOfBandInRows:NSMakeRange(6, 8) recordsRowDigests:YES];
+}
+
+- (void)testChangedBandNearBottomMatchesFullBlur {
+    [self assertBandedBlurOfBandInRows:NSMakeRange(72, 10) recordsRowDigests:YES];
+}
+
+- (void)testChangedBandOfSnapshotWithoutRowDigestsMatchesFullBlur {
+    [self assertBandedBlurOfBandInRows:NSMakeRange(40, 4) recordsRowDigests:NO];
+}
+
+@end
@@ -0,0 +1,255 @@
+//
+//  DBProfileBlurViewTests.m
+//  DBProfileViewController
+//
+//  Created by Devon Boyer on 2016-05-21.
+//  Copyright © 2016 Devon Boyer. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <DBProfileViewController/DBProfileViewController.h>
+#import <DBProfileViewController/DBProfileBlurView.h>
+#import <DBProfileViewController/DBProfileBlurStageCache.h>
+#import <DBProfileViewController/DBProfileBlurStageDiskCache.h>
+#import <DBProfileViewController/DBProfileHeaderViewLayoutAttributes_Private.h>
+
+@interface DBProfileBlurViewTests : XCTestCase
+
+@property (nonatomic) UIImage *image;
+
+@end
+
+@implementation DBProfileBlurViewTests
+
+- (void)setUp {
+    [super setUp];
+    
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(160, 60), YES, 2.0);
+    [[UIColor redColor] setFill];
+    UIRectFill(CGRectMake(0, 0, 80, 60));
+    self.image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    [[DBProfileBlurStageCache sharedCache] removeAllImages];
+}
+
+- (DBProfileBlurView *)scrolledBlurViewWithImage:(UIImage *)image {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.initialImage = image;
+    
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"hasFullFidelity == YES"] evaluatedWithObject:blurView handler:nil];
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    return blurView;
+}
+
+- (void)testSettingImageDoesNotRenderStagesUntilTheyAreNeeded {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.initialImage = self.image;
+    
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    XCTAssertEqual(blurView.stageMemoryFootprint, 0, @"no stages should be rendered before the view is scrolled");
+    
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"stageMemoryFootprint > 0"] evaluatedWithObject:blurView handler:nil];
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+}
+
+- (void)testCollapsedLayoutRendersStagesBeforeScrolling {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.frame = CGRectMake(0, 0, 320, 120);
+    blurView.initialImage = self.image;
+    
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"hasFullFidelity == YES"] evaluatedWithObject:blurView handler:nil];
+    
+    // The part of the header left on screen once collapsed is known from the layout, so the stages are ready before the first scroll
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.collapsedBounds = CGRectMake(0, 56, 320, 64);
+    layoutAttributes.percentTransitioned = 0.0;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+}
+
+- (void)testPullingDownCollapsedHeaderShowsBandStagesUntilReplaced {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.frame = CGRectMake(0, 0, 320, 120);
+    [blurView layoutIfNeeded];
+    blurView.initialImage = self.image;
+    
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"hasFullFidelity == YES"] evaluatedWithObject:blurView handler:nil];
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.collapsedBounds = CGRectMake(0, 56, 320, 64);
+    layoutAttributes.percentTransitioned = 0.0;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    NSUInteger bandMemoryFootprint = blurView.stageMemoryFootprint;
+    
+    // The first pull-down needs the whole image, the stages of the band are shown meanwhile instead of the initial image
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"hasFullFidelity == YES"] evaluatedWithObject:blurView handler:nil];
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    UIImage *bandImage = blurView.imageView.image;
+    XCTAssertFalse(blurView.hasFullFidelity);
+    XCTAssertNotEqual(bandImage, self.image);
+    XCTAssertEqual(blurView.stageMemoryFootprint, bandMemoryFootprint);
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertNotEqual(blurView.imageView.image, bandImage, @"the band should be replaced by the larger stage");
+    XCTAssertEqual(blurView.stageMemoryFootprint, [DBProfileBlurStageCache sharedCache].totalCost - bandMemoryFootprint, @"the band should be released once replaced");
+}
+
+- (void)testPreviewsAreShownUntilFullFidelity {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.initialImage = self.image;
+    
+    __block NSUInteger numberOfCalls = 0;
+    __block UIImage *shownImage = nil;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"full fidelity"];
+    blurView.fullFidelityHandler = ^(DBProfileBlurView *view) {
+        numberOfCalls++;
+        [expectation fulfill];
+    };
+    
+    // The first image shown once scrolled is a preview, an eighth of the width of the image
+    [self keyValueObservingExpectationForObject:blurView.imageView keyPath:@"image" handler:^BOOL(id observedObject, NSDictionary *change) {
+        if (!shownImage) shownImage = blurView.imageView.image;
+        return YES;
+    }];
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    XCTAssertFalse(blurView.hasFullFidelity);
+    
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual(CGImageGetWidth(shownImage.CGImage), CGImageGetWidth(self.image.CGImage) / 8);
+    XCTAssertTrue(blurView.hasFullFidelity);
+    XCTAssertEqual(numberOfCalls, 1);
+    XCTAssertEqual(CGImageGetWidth(blurView.imageView.image.CGImage), CGImageGetWidth(self.image.CGImage), @"the preview should be replaced by its stage");
+}
+
+- (void)testShowingTheSameImageAgainDoesNoBlurWork {
+    DBProfileBlurView *firstBlurView = [self scrolledBlurViewWithImage:self.image];
+    DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+    NSUInteger totalCost = cache.totalCost;
+    XCTAssertEqual(totalCost, firstBlurView.stageMemoryFootprint);
+    
+    // A new image instance with the same pixels, as when a profile is pushed again
+    UIImage *image = [UIImage imageWithCGImage:self.image.CGImage scale:self.image.scale orientation:self.image.imageOrientation];
+    [cache resetStatistics];
+    DBProfileBlurView *secondBlurView = [self scrolledBlurViewWithImage:image];
+    
+    XCTAssertEqual(cache.missCount, 0, @"every stage should be found in the shared cache");
+    XCTAssertGreaterThan(cache.hitCount, 0);
+    XCTAssertEqual(cache.totalCost, totalCost, @"no stages should be blurred again");
+    XCTAssertEqual(secondBlurView.stageMemoryFootprint, firstBlurView.stageMemoryFootprint);
+}
+
+- (void)testDiskCacheKeepsStagesAcrossLaunches {
+    XCTAssertFalse([DBProfileBlurView isDiskCacheEnabled]);
+    [DBProfileBlurView setDiskCacheEnabled:YES];
+    DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+    XCTAssertEqual(cache.diskCache, [DBProfileBlurStageDiskCache defaultDiskCache]);
+    [cache.diskCache removeAllImages];
+    
+    [self scrolledBlurViewWithImage:self.image];
+    [cache waitUntilDiskWritesFinish];
+    XCTAssertGreaterThan(cache.diskCache.totalSize, 0);
+    
+    // Emptying the memory tier stands in for a relaunch
+    [cache removeAllImages];
+    [cache resetStatistics];
+    [self scrolledBlurViewWithImage:self.image];
+    XCTAssertGreaterThan(cache.diskHitCount, 0, @"the stages should be read from disk");
+    
+    [cache.diskCache removeAllImages];
+    [DBProfileBlurView setDiskCacheEnabled:NO];
+    XCTAssertFalse([DBProfileBlurView isDiskCacheEnabled]);
+    XCTAssertNil(cache.diskCache);
+}
+
+- (void)testRenderJobDoesNotKeepViewAlive {
+    __weak DBProfileBlurView *weakBlurView;
+    @autoreleasepool {
+        DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+        blurView.initialImage = self.image;
+        
+        DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+        layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+        layoutAttributes.percentTransitioned = 0.5;
+        [blurView applyLayoutAttributes:layoutAttributes];
+        weakBlurView = blurView;
+    }
+    
+    XCTAssertNil(weakBlurView, @"a released view should not wait for its job");
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    XCTAssertEqual([DBProfileBlurView renderQueueDepth], 0);
+}
+
+- (void)testRemovingViewFromSuperviewCancelsItsJob {
+    UIView *superview = [[UIView alloc] init];
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    [superview addSubview:blurView];
+    blurView.initialImage = self.image;
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleNavigation;
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    [blurView removeFromSuperview];
+    
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    XCTAssertEqual(blurView.stageMemoryFootprint, 0, @"the stages of a removed view should not be shown");
+    XCTAssertFalse(blurView.hasFullFidelity);
+}
+
+- (void)testChangingTintColorDoesNoBlurWork {
+    DBProfileBlurView *blurView = [self scrolledBlurViewWithImage:self.image];
+    DBProfileBlurStageCache *cache = [DBProfileBlurStageCache sharedCache];
+    NSUInteger totalCost = cache.totalCost;
+    UIImage *untintedImage = blurView.imageView.image;
+    
+    blurView.tintColor = [UIColor colorWithWhite:1.0 alpha:0.5];
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    
+    // The tint is shown by a view above the stages, so the stage on screen is not redrawn
+    UIView *tintOverlayView = blurView.contentView.subviews.lastObject;
+    XCTAssertEqual(blurView.imageView.image, untintedImage);
+    XCTAssertFalse(tintOverlayView.hidden, @"the stage on screen should show the new tint");
+    XCTAssertGreaterThan(tintOverlayView.alpha, 0.0);
+    XCTAssertEqualWithAccuracy(CGColorGetAlpha(tintOverlayView.backgroundColor.CGColor), 0.25, 0.001);
+    XCTAssertEqual(cache.totalCost, totalCost, @"no stages should be blurred again");
+    XCTAssertEqual(blurView.stageMemoryFootprint, totalCost);
+}
+
+- (void)testDisabledBlurRendersNothing {
+    DBProfileBlurView *blurView = [[DBProfileBlurView alloc] init];
+    blurView.initialImage = self.image;
+    
+    DBProfileHeaderViewLayoutAttributes *layoutAttributes = [DBProfileHeaderViewLayoutAttributes layoutAttributesForAccessoryViewOfKind:DBProfileAccessoryKindHeader];
+    layoutAttributes.headerStyle = DBProfileHeaderStyleDefault;
+    layoutAttributes.percentTransitioned = 0.5;
+    [blurView applyLayoutAttributes:layoutAttributes];
+    
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    XCTAssertFalse(blurView.isBlurEnabled);
+    XCTAssertEqual(blurView.stageMemoryFootprint, 0, @"no stages should be rendered when blurring is disabled");
+}
+
+@end
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBackdropBlurView_Private.h
\ No newline at end of file
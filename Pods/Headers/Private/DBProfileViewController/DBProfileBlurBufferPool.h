@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurBufferPool.h
\ No newline at end of file
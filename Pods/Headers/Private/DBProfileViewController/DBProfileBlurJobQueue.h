@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurJobQueue.h
\ No newline at end of file
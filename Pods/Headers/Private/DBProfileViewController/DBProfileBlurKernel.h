@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurKernel.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurScheduler.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurScheduler_Private.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurSourceImage.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurStageAtlas.h
\ No newline at end of file
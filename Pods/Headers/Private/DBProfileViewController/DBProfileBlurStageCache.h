@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurStageCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurStageDiskCache.h
\ No newline at end of file
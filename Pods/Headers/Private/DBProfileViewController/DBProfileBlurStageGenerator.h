@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurStageGenerator.h
\ No newline at end of file
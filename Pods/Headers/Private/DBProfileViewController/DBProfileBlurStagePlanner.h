@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/DBProfileBlurStagePlanner.h
\ No newline at end of file
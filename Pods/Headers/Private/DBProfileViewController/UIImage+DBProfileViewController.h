@@ -0,0 +1 @@
+../../../../DBProfileViewController/Private/UIImage+DBProfileViewController.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../DBProfileViewController/DBProfileBackdropBlurView.h
\ No newline at end of file
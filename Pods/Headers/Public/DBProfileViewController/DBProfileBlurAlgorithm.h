@@ -0,0 +1 @@
+../../../../DBProfileViewController/DBProfileBlurAlgorithm.h
\ No newline at end of file